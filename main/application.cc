@@ -21,6 +21,8 @@
 
 #define TAG "Application"
 
+#define AUDIO_SENDER_STALL_WARN_MS 200
+
 static const char* const STATE_STRINGS[] = {
     "unknown",
     "starting",
@@ -190,7 +192,7 @@ void Application::CheckNewVersion(Ota& ota) {
 void Application::ShowActivationCode(const std::string& code, const std::string& message) {
     struct digit_sound {
         char digit;
-        const std::string_view& sound;
+        std::string_view sound;
     };
     static const std::array<digit_sound, 10> digit_sounds{{
         digit_sound{'0', Lang::Sounds::P3_0},
@@ -351,8 +353,15 @@ void Application::Start() {
 
     AudioServiceCallbacks callbacks;
     callbacks.on_send_queue_available = [this]() {
-        xEventGroupSetBits(event_group_, MAIN_EVENT_SEND_AUDIO);
+        if (audio_sender_task_handle_ != nullptr) {
+            xTaskNotifyGive(audio_sender_task_handle_);
+        }
+    };
+#if CONFIG_BT_NIMBLE_ENABLED
+    callbacks.on_decode_queue_available = [this]() {
+        BleProtocol::GrantRelayCredits(audio_service_.GetDecodeQueueSize());
     };
+#endif
     callbacks.on_wake_word_detected = [this](const std::string& wake_word) {
         xEventGroupSetBits(event_group_, MAIN_EVENT_WAKE_WORD_DETECTED);
     };
@@ -485,7 +494,7 @@ void Application::Start() {
                         ESP_LOGI(TAG, "Playing P3_TAHU for HEYSANTA");
                         audio_service_.PlaySound(Lang::Sounds::P3_TAHU);
                         ESP_LOGI(TAG, "P3_TAHU queued for HEYSANTA");
-                    });
+                    }, kTaskPriorityBackground);
                     
                     last_bell_time = now;
                 } else {
@@ -521,7 +530,7 @@ void Application::Start() {
                                 // Update MCP timestamp to suppress future bells
                                 static std::chrono::steady_clock::time_point last_mcp_time;
                                 last_mcp_time = std::chrono::steady_clock::now();
-                            });
+                            }, kTaskPriorityBackground);
                         } else {
                             ESP_LOGI(TAG, "Short TTS detected (%d ms), skipping stop shake [Web panel: %s]", (int)duration_ms, web_control_panel_active_ ? "active" : "inactive");
                         }
@@ -549,7 +558,7 @@ void Application::Start() {
                     ESP_LOGI(TAG, "<< %s", text->valuestring);
                     Schedule([this, display, message = std::string(text->valuestring)]() {
                         display->SetChatMessage("assistant", message.c_str());
-                    });
+                    }, kTaskPriorityUi);
                 }
             }
         } else if (strcmp(type->valuestring, "stt") == 0) {
@@ -583,7 +592,7 @@ void Application::Start() {
                         // Update MCP timestamp when sending MCP commands
                         static std::chrono::steady_clock::time_point last_mcp_time;
                         last_mcp_time = std::chrono::steady_clock::now();
-                    });
+                    }, kTaskPriorityBackground);
                 } else {
                     ESP_LOGI(TAG, "User input detected, no shake this time (chance: %d/%d) [Web panel: %s]", 
                             random_chance, SHAKE_PROBABILITY, web_control_panel_active_ ? "active" : "inactive");
@@ -591,14 +600,14 @@ void Application::Start() {
 #endif
                 Schedule([this, display, message = std::string(text->valuestring)]() {
                     display->SetChatMessage("user", message.c_str());
-                });
+                }, kTaskPriorityUi);
             }
         } else if (strcmp(type->valuestring, "llm") == 0) {
             auto emotion = cJSON_GetObjectItem(root, "emotion");
             if (cJSON_IsString(emotion)) {
                 Schedule([this, display, emotion_str = std::string(emotion->valuestring)]() {
                     display->SetEmotion(emotion_str.c_str());
-                });
+                }, kTaskPriorityUi, kTaskCoalesceEmotion);
             }
         } else if (strcmp(type->valuestring, "mcp") == 0) {
 #ifdef CONFIG_BOARD_TYPE_HEYSANTA
@@ -640,7 +649,7 @@ void Application::Start() {
             if (cJSON_IsObject(payload)) {
                 Schedule([this, display, payload_str = std::string(cJSON_PrintUnformatted(payload))]() {
                     display->SetChatMessage("system", payload_str.c_str());
-                });
+                }, kTaskPriorityUi);
             } else {
                 ESP_LOGW(TAG, "Invalid custom message format: missing payload");
             }
@@ -717,6 +726,50 @@ void Application::Start() {
         ESP_LOGI(TAG, "BLE connection state changed: %s", connected ? "connected" : "disconnected");
         SetBleConnectionState(connected);
     });
+
+    // A phone subscribed to the audio characteristic relays the conversation when Wi-Fi is unavailable
+    ble_protocol_->OnAudioChannelOpened([this]() {
+        ESP_LOGI(TAG, "BLE audio relay opened");
+        Schedule([this]() {
+            if (device_state_ == kDeviceStateIdle) {
+                SetDeviceState(kDeviceStateListening);
+            }
+        }, kTaskPriorityState);
+    });
+    ble_protocol_->OnAudioChannelClosed([this]() {
+        Schedule([this]() {
+            ESP_LOGI(TAG, "BLE audio relay closed, send queue=%u decode queue=%u",
+                     (unsigned int)audio_service_.GetSendQueueSize(), (unsigned int)audio_service_.GetDecodeQueueSize());
+            if (!protocol_->IsAudioChannelOpened()) {
+                SetDeviceState(kDeviceStateIdle);
+            }
+        }, kTaskPriorityState);
+    });
+    ble_protocol_->OnIncomingAudio([this](std::unique_ptr<AudioStreamPacket> packet) {
+        if (device_state_ != kDeviceStateSpeaking) {
+            Schedule([this]() {
+                if (device_state_ != kDeviceStateSpeaking) {
+                    SetDeviceState(kDeviceStateSpeaking);
+                }
+            }, kTaskPriorityState);
+        }
+        if (!audio_service_.PushPacketToDecodeQueue(std::move(packet))) {
+            ESP_LOGW(TAG, "Decode queue full, dropping relayed audio packet");
+        }
+    });
+    ble_protocol_->OnIncomingJson([this](const cJSON* root) {
+        // Only the end of a relayed utterance is handled here, commands arrive through OnCommand
+        auto type = cJSON_GetObjectItem(root, "type");
+        auto state = cJSON_GetObjectItem(root, "state");
+        if (cJSON_IsString(type) && cJSON_IsString(state) &&
+            strcmp(type->valuestring, "tts") == 0 && strcmp(state->valuestring, "stop") == 0) {
+            Schedule([this]() {
+                if (device_state_ == kDeviceStateSpeaking) {
+                    SetDeviceState(kDeviceStateListening);
+                }
+            }, kTaskPriorityState);
+        }
+    });
     
     if (!ble_protocol_->Start()) {
         ESP_LOGE(TAG, "Failed to start BLE protocol");
@@ -726,6 +779,14 @@ void Application::Start() {
     }
 #endif
 
+    /* Start the audio sender task, so a slow network never blocks the main event loop.
+       It is started after BLE init so ble_protocol_ no longer changes once the task reads it. */
+    xTaskCreate([](void* arg) {
+        Application* app = (Application*)arg;
+        app->AudioSenderTask();
+        vTaskDelete(NULL);
+    }, "audio_sender", 2048 * 3, this, 3, &audio_sender_task_handle_);
+
     SetDeviceState(kDeviceStateIdle);
 
     has_server_time_ = ota.HasServerTime();
@@ -814,15 +875,19 @@ void Application::OnClockTimer() {
         ESP_LOGI(TAG, "Memory: free=%d, min_free=%d, device_state=%d", 
                  (int)free_heap, (int)min_free_heap, (int)device_state_);
         SystemInfo::PrintHeapStats();
+        main_tasks_.PrintStatistics();
+        // Display statistics are read under the display lock, keep that off the esp_timer task
+        Schedule([]() {
+            Board::GetInstance().GetDisplay()->PrintStatistics();
+        }, kTaskPriorityBackground);
+        ESP_LOGI(TAG, "Audio uplink: pending=%u, dropped=%lu", audio_service_.GetSendQueueSize(),
+                 (unsigned long)audio_service_.GetSendDroppedCount());
     }
 }
 
 // Add a async task to MainLoop
-void Application::Schedule(std::function<void()> callback) {
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        main_tasks_.push_back(std::move(callback));
-    }
+void Application::Schedule(InlineTask callback, TaskPriority priority, TaskCoalesceKey coalesce_key) {
+    main_tasks_.Push(priority, std::move(callback), coalesce_key);
     xEventGroupSetBits(event_group_, MAIN_EVENT_SCHEDULE);
 }
 
@@ -835,7 +900,6 @@ void Application::MainEventLoop() {
 
     while (true) {
         auto bits = xEventGroupWaitBits(event_group_, MAIN_EVENT_SCHEDULE |
-            MAIN_EVENT_SEND_AUDIO |
             MAIN_EVENT_WAKE_WORD_DETECTED |
             MAIN_EVENT_VAD_CHANGE |
             MAIN_EVENT_ERROR, pdTRUE, pdFALSE, portMAX_DELAY);
@@ -844,14 +908,6 @@ void Application::MainEventLoop() {
             Alert(Lang::Strings::ERROR, last_error_message_.c_str(), "sad", Lang::Sounds::P3_EXCLAMATION);
         }
 
-        if (bits & MAIN_EVENT_SEND_AUDIO) {
-            while (auto packet = audio_service_.PopPacketFromSendQueue()) {
-                if (!protocol_->SendAudio(std::move(packet))) {
-                    break;
-                }
-            }
-        }
-
         if (bits & MAIN_EVENT_WAKE_WORD_DETECTED) {
             OnWakeWordDetected();
         }
@@ -864,11 +920,44 @@ void Application::MainEventLoop() {
         }
 
         if (bits & MAIN_EVENT_SCHEDULE) {
-            std::unique_lock<std::mutex> lock(mutex_);
-            auto tasks = std::move(main_tasks_);
-            lock.unlock();
-            for (auto& task : tasks) {
+            // Run the most urgent task first, and yield back to the event bits if
+            // a wake word was detected meanwhile
+            InlineTask task;
+            while (main_tasks_.Pop(task)) {
                 task();
+                task.Reset();
+                if (xEventGroupGetBits(event_group_) & MAIN_EVENT_WAKE_WORD_DETECTED) {
+                    if (!main_tasks_.IsEmpty()) {
+                        xEventGroupSetBits(event_group_, MAIN_EVENT_SCHEDULE);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// The uplink runs on its own task, a blocking socket only delays the audio frames,
+// which are dropped oldest-first by AudioService when the send queue is full
+void Application::AudioSenderTask() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (auto packet = audio_service_.PopPacketFromSendQueue()) {
+            int64_t start_time = esp_timer_get_time();
+            // The BLE relay takes the uplink while a phone is subscribed to it
+            Protocol* uplink = protocol_.get();
+#if CONFIG_BT_NIMBLE_ENABLED
+            if (ble_protocol_ && ble_protocol_->IsAudioChannelOpened()) {
+                uplink = ble_protocol_.get();
+            }
+#endif
+            if (!uplink->SendAudio(std::move(packet))) {
+                break;
+            }
+            int elapsed_ms = (esp_timer_get_time() - start_time) / 1000;
+            if (elapsed_ms > AUDIO_SENDER_STALL_WARN_MS) {
+                ESP_LOGW(TAG, "Audio send stalled for %d ms, %u packets pending", elapsed_ms,
+                         audio_service_.GetSendQueueSize());
             }
         }
     }
@@ -915,6 +1004,7 @@ void Application::OnWakeWordDetected() {
 void Application::AbortSpeaking(AbortReason reason) {
     ESP_LOGI(TAG, "Abort speaking");
     aborted_ = true;
+    McpServer::GetInstance().CancelPendingToolCalls();
     protocol_->SendAbortSpeaking(reason);
 }
 
@@ -972,6 +1062,8 @@ void Application::SetDeviceState(DeviceState state) {
             if (!audio_service_.IsAudioProcessorRunning()) {
                 // Send the start listening command
                 protocol_->SendStartListening(listening_mode_);
+                // In realtime mode the server takes turns from the continuous stream
+                audio_service_.EnableUplinkGate(listening_mode_ != kListeningModeRealtime);
                 audio_service_.EnableVoiceProcessing(true);
                 audio_service_.EnableWakeWordDetection(false);
             }
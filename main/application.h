@@ -17,13 +17,13 @@
 #include "ota.h"
 #include "audio_service.h"
 #include "device_state_event.h"
+#include "task_scheduler.h"
 
 #if CONFIG_BT_NIMBLE_ENABLED
 #include "protocols/ble_protocol.h"
 #endif
 
 #define MAIN_EVENT_SCHEDULE (1 << 0)
-#define MAIN_EVENT_SEND_AUDIO (1 << 1)
 #define MAIN_EVENT_WAKE_WORD_DETECTED (1 << 2)
 #define MAIN_EVENT_VAD_CHANGE (1 << 3)
 #define MAIN_EVENT_ERROR (1 << 4)
@@ -49,7 +49,8 @@ public:
     void MainEventLoop();
     DeviceState GetDeviceState() const { return device_state_; }
     bool IsVoiceDetected() const { return audio_service_.IsVoiceDetected(); }
-    void Schedule(std::function<void()> callback);
+    void Schedule(InlineTask callback, TaskPriority priority = kTaskPriorityState,
+        TaskCoalesceKey coalesce_key = kTaskCoalesceNone);
     void SetDeviceState(DeviceState state);
     void Alert(const char* status, const char* message, const char* emotion = "", const std::string_view& sound = "");
     void DismissAlert();
@@ -81,8 +82,7 @@ private:
     std::chrono::steady_clock::time_point last_stt_time_;
     bool stt_timeout_enabled_ = true;
     static const int STT_TIMEOUT_SECONDS = 95; // 1 minute timeout for normal mode
-    std::mutex mutex_;
-    std::deque<std::function<void()>> main_tasks_;
+    TaskScheduler main_tasks_;
     std::unique_ptr<Protocol> protocol_;
     EventGroupHandle_t event_group_ = nullptr;
     esp_timer_handle_t clock_timer_handle_ = nullptr;
@@ -102,11 +102,13 @@ private:
     bool aborted_ = false;
     int clock_ticks_ = 0;
     TaskHandle_t check_new_version_task_handle_ = nullptr;
+    TaskHandle_t audio_sender_task_handle_ = nullptr;
 
     void OnWakeWordDetected();
     void CheckNewVersion(Ota& ota);
     void ShowActivationCode(const std::string& code, const std::string& message);
     void OnClockTimer();
+    void AudioSenderTask();
     void SetListeningMode(ListeningMode mode);
     void ProcessBleMcpCommand(const cJSON* payload);
     void ProcessBlePluginCommand(const cJSON* payload);
@@ -0,0 +1,113 @@
+#include "asset_bundle.h"
+
+#include <esp_log.h>
+
+#include <cstring>
+
+#define TAG "AssetBundle"
+
+#define ASSET_BUNDLE_HEADER_SIZE 32
+#define ASSET_BUNDLE_ENTRY_SIZE 16
+
+static uint16_t ReadU16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t ReadU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t HashName(const char* name) {
+    // FNV-1a, must match scripts/build_assets.py
+    uint32_t hash = 0x811C9DC5;
+    for (auto p = reinterpret_cast<const uint8_t*>(name); *p; p++) {
+        hash = (hash ^ *p) * 0x01000193;
+    }
+    return hash;
+}
+
+AssetBundle::AssetBundle() {
+    if (!Load()) {
+        if (mmap_handle_ != 0) {
+            esp_partition_munmap(mmap_handle_);
+            mmap_handle_ = 0;
+        }
+        data_ = nullptr;
+    }
+}
+
+AssetBundle::~AssetBundle() {
+    if (mmap_handle_ != 0) {
+        esp_partition_munmap(mmap_handle_);
+    }
+}
+
+bool AssetBundle::Load() {
+    auto partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ASSET_BUNDLE_PARTITION);
+    if (partition == nullptr) {
+        ESP_LOGW(TAG, "No %s partition", ASSET_BUNDLE_PARTITION);
+        return false;
+    }
+
+    // Read the header first so only the used part of the partition is mapped
+    uint8_t header[ASSET_BUNDLE_HEADER_SIZE];
+    if (esp_partition_read(partition, 0, header, sizeof(header)) != ESP_OK || memcmp(header, "XZAB", 4) != 0) {
+        ESP_LOGW(TAG, "The %s partition holds no asset bundle", ASSET_BUNDLE_PARTITION);
+        return false;
+    }
+    if (ReadU16(header + 4) != ASSET_BUNDLE_VERSION || ReadU16(header + 6) != ASSET_BUNDLE_HEADER_SIZE) {
+        ESP_LOGE(TAG, "Unsupported asset bundle version %u", ReadU16(header + 4));
+        return false;
+    }
+    entry_count_ = ReadU32(header + 8);
+    bucket_count_ = ReadU32(header + 12);
+    size_ = ReadU32(header + 16);
+    uint64_t index_size = ASSET_BUNDLE_HEADER_SIZE + bucket_count_ * 2ULL + entry_count_ * (uint64_t)ASSET_BUNDLE_ENTRY_SIZE;
+    if (size_ > partition->size || index_size > size_ || bucket_count_ == 0 ||
+        (bucket_count_ & (bucket_count_ - 1)) != 0 || entry_count_ >= bucket_count_) {
+        ESP_LOGE(TAG, "Corrupted asset bundle header");
+        return false;
+    }
+
+    const void* mapped = nullptr;
+    esp_err_t err = esp_partition_mmap(partition, 0, size_, ESP_PARTITION_MMAP_DATA, &mapped, &mmap_handle_);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map the asset bundle: %s", esp_err_to_name(err));
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(mapped);
+    buckets_ = data_ + ASSET_BUNDLE_HEADER_SIZE;
+    entries_ = buckets_ + bucket_count_ * 2;
+
+    // Bounds only, the CRC is checked when the bundle is built and flashed
+    for (uint32_t i = 0; i < entry_count_; i++) {
+        const uint8_t* entry = entries_ + i * ASSET_BUNDLE_ENTRY_SIZE;
+        uint32_t name_offset = ReadU32(entry + 4);
+        uint64_t end = (uint64_t)ReadU32(entry + 8) + ReadU32(entry + 12);
+        if (name_offset >= size_ || memchr(data_ + name_offset, '\0', size_ - name_offset) == nullptr || end > size_) {
+            ESP_LOGE(TAG, "Asset %u is out of bounds", (unsigned)i);
+            return false;
+        }
+    }
+    ESP_LOGI(TAG, "Mapped %u assets, %u bytes", (unsigned)entry_count_, (unsigned)size_);
+    return true;
+}
+
+std::string_view AssetBundle::Get(const char* name) const {
+    if (data_ == nullptr) {
+        return {};
+    }
+    uint32_t hash = HashName(name);
+    uint32_t mask = bucket_count_ - 1;
+    for (uint32_t i = hash & mask, probes = 0; probes < bucket_count_; i = (i + 1) & mask, probes++) {
+        uint16_t number = ReadU16(buckets_ + i * 2);
+        if (number == 0 || number > entry_count_) {
+            break;
+        }
+        const uint8_t* entry = entries_ + (number - 1) * ASSET_BUNDLE_ENTRY_SIZE;
+        if (ReadU32(entry) == hash && strcmp(reinterpret_cast<const char*>(data_ + ReadU32(entry + 4)), name) == 0) {
+            return std::string_view(reinterpret_cast<const char*>(data_ + ReadU32(entry + 8)), ReadU32(entry + 12));
+        }
+    }
+    return {};
+}
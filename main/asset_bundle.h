@@ -0,0 +1,62 @@
+#ifndef _ASSET_BUNDLE_H_
+#define _ASSET_BUNDLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include <esp_partition.h>
+
+#define ASSET_BUNDLE_PARTITION "assets"
+#define ASSET_BUNDLE_VERSION 1
+
+/*
+ * Named assets packed by scripts/build_assets.py, all fields little endian:
+ *   header:  "XZAB", version (u16), header size (u16), entry count (u32), bucket count (u32),
+ *            total size (u32), CRC32 of everything after the header (u32), 8 reserved bytes
+ *   buckets: u16 entry number per bucket, 0 is empty, collisions probe the next bucket
+ *   entries: FNV-1a hash of the name (u32), name offset (u32), data offset (u32), data size (u32)
+ *   names, then the blobs aligned to 16 bytes
+ * The partition is memory mapped once and Get() returns views into the mapping,
+ * so sounds are played straight from flash without copying them to RAM.
+ */
+class AssetBundle {
+public:
+    static AssetBundle& GetInstance() {
+        static AssetBundle instance;
+        return instance;
+    }
+    // Delete copy constructor and assignment operator
+    AssetBundle(const AssetBundle&) = delete;
+    AssetBundle& operator=(const AssetBundle&) = delete;
+
+    bool IsLoaded() const { return data_ != nullptr; }
+    // Empty when the asset does not exist
+    std::string_view Get(const char* name) const;
+
+private:
+    AssetBundle();
+    ~AssetBundle();
+
+    bool Load();
+
+    esp_partition_mmap_handle_t mmap_handle_ = 0;
+    const uint8_t* data_ = nullptr;
+    uint32_t size_ = 0;
+    uint32_t entry_count_ = 0;
+    uint32_t bucket_count_ = 0;
+    const uint8_t* buckets_ = nullptr;
+    const uint8_t* entries_ = nullptr;
+};
+
+/*
+ * Stands in for embedded data when the build moves assets into the bundle,
+ * converts to the mapped bytes wherever a std::string_view is expected.
+ */
+struct AssetRef {
+    const char* name;
+
+    operator std::string_view() const { return AssetBundle::GetInstance().Get(name); }
+};
+
+#endif // _ASSET_BUNDLE_H_
@@ -38,6 +38,9 @@ void AudioService::Initialize(AudioCodec* codec) {
     opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
     opus_encoder_->SetComplexity(0);
 
+    output_level_meter_.Configure(codec->output_sample_rate());
+    input_level_meter_.Configure(16000);
+
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
         reference_resampler_.Configure(codec->input_sample_rate(), 16000);
@@ -59,10 +62,20 @@ void AudioService::Initialize(AudioCodec* codec) {
     wake_word_ = nullptr;
 #endif
 
-    audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
+#if CONFIG_USE_UPLINK_VAD_GATE
+    uplink_gate_.Configure(OPUS_FRAME_DURATION_MS, CONFIG_UPLINK_VAD_PRE_ROLL_MS,
+        CONFIG_UPLINK_VAD_HANGOVER_MS, CONFIG_UPLINK_VAD_KEEPALIVE_MS);
+#endif
+    uplink_gate_.OnOutput([this](std::vector<int16_t>&& data) {
         PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
     });
 
+    audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
+        input_level_meter_.Process(data.data(), data.size());
+        // The VAD callback runs on the same task just before the output, so voice_detected_ is current
+        uplink_gate_.Process(std::move(data), voice_detected_);
+    });
+
     audio_processor_->OnVadStateChange([this](bool speaking) {
         voice_detected_ = speaking;
         if (callbacks_.on_vad_change) {
@@ -70,6 +83,14 @@ void AudioService::Initialize(AudioCodec* codec) {
         }
     });
 
+#if CONFIG_USE_WAKE_WORD_PRE_VAD
+    pre_vad_.Configure(16000, codec->input_channels(), CONFIG_WAKE_WORD_PRE_VAD_THRESHOLD_DB,
+        WAKE_WORD_PRE_ROLL_MS, WAKE_WORD_HANGOVER_MS);
+    pre_vad_.OnOutput([this](std::vector<int16_t>&& data) {
+        wake_word_->Feed(data);
+    });
+#endif
+
     if (wake_word_) {
         wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
             if (callbacks_.on_wake_word_detected) {
@@ -249,7 +270,15 @@ void AudioService::AudioInputTask() {
             int samples = wake_word_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
+#if CONFIG_USE_WAKE_WORD_PRE_VAD
+                    if (pre_vad_need_reset_) {
+                        pre_vad_need_reset_ = false;
+                        pre_vad_.Reset();
+                    }
+                    pre_vad_.Process(std::move(data));
+#else
                     wake_word_->Feed(data);
+#endif
                     continue;
                 }
             }
@@ -292,7 +321,9 @@ void AudioService::AudioOutputTask() {
             esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
             codec_->EnableOutput(true);
         }
+        output_level_meter_.Process(task->pcm.data(), task->pcm.size());
         codec_->OutputData(task->pcm);
+        played_samples_.fetch_add(task->pcm.size(), std::memory_order_relaxed);
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
@@ -315,7 +346,7 @@ void AudioService::OpusCodecTask() {
         std::unique_lock<std::mutex> lock(audio_queue_mutex_);
         audio_queue_cv_.wait(lock, [this]() {
             return service_stopped_ ||
-                (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
+                !audio_encode_queue_.empty() ||
                 (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
         });
         if (service_stopped_) {
@@ -328,6 +359,9 @@ void AudioService::OpusCodecTask() {
             audio_decode_queue_.pop_front();
             audio_queue_cv_.notify_all();
             lock.unlock();
+            if (callbacks_.on_decode_queue_available) {
+                callbacks_.on_decode_queue_available();
+            }
 
             auto task = std::make_unique<AudioTask>();
             task->type = kAudioTaskTypeDecodeToPlaybackQueue;
@@ -354,7 +388,7 @@ void AudioService::OpusCodecTask() {
         }
         
         /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
+        if (!audio_encode_queue_.empty()) {
             auto task = std::move(audio_encode_queue_.front());
             audio_encode_queue_.pop_front();
             audio_queue_cv_.notify_all();
@@ -372,6 +406,11 @@ void AudioService::OpusCodecTask() {
             if (task->type == kAudioTaskTypeEncodeToSendQueue) {
                 {
                     std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+                    /* Never stall the encoder on a slow uplink, drop the stale frames and keep the latest */
+                    while (audio_send_queue_.size() >= MAX_SEND_PACKETS_IN_QUEUE) {
+                        audio_send_queue_.pop_front();
+                        send_dropped_count_++;
+                    }
                     audio_send_queue_.push_back(std::move(packet));
                 }
                 if (callbacks_.on_send_queue_available) {
@@ -452,6 +491,23 @@ std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
     return packet;
 }
 
+size_t AudioService::GetSendQueueSize() {
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    return audio_send_queue_.size();
+}
+
+uint32_t AudioService::GetPlaybackTime() const {
+    if (codec_ == nullptr) {
+        return 0;
+    }
+    return (uint64_t)played_samples_.load(std::memory_order_relaxed) * 1000 / codec_->output_sample_rate();
+}
+
+size_t AudioService::GetDecodeQueueSize() {
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    return audio_decode_queue_.size();
+}
+
 void AudioService::EncodeWakeWord() {
     if (wake_word_) {
         wake_word_->EncodeWakeWordData();
@@ -485,10 +541,16 @@ void AudioService::EnableWakeWordDetection(bool enable) {
             wake_word_initialized_ = true;
         }
         wake_word_->Start();
+        pre_vad_need_reset_ = true;
         xEventGroupSetBits(event_group_, AS_EVENT_WAKE_WORD_RUNNING);
     } else {
         wake_word_->Stop();
         xEventGroupClearBits(event_group_, AS_EVENT_WAKE_WORD_RUNNING);
+#if CONFIG_USE_WAKE_WORD_PRE_VAD
+        auto statistics = pre_vad_.GetStatistics();
+        ESP_LOGI(TAG, "Pre-VAD fed %lu of %lu chunks to the wake word, %lu wake-ups", statistics.passed_chunks,
+            statistics.chunks, statistics.wake_ups);
+#endif
     }
 }
 
@@ -508,9 +570,22 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     } else {
         audio_processor_->Stop();
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
+        if (uplink_gate_.enabled()) {
+            auto statistics = uplink_gate_.GetStatistics();
+            ESP_LOGI(TAG, "Uplink gate sent %lu of %lu frames, %lu keepalive", statistics.sent_frames,
+                statistics.frames, statistics.keepalive_frames);
+        }
     }
 }
 
+void AudioService::EnableUplinkGate(bool enable) {
+#if CONFIG_USE_UPLINK_VAD_GATE
+    uplink_gate_.Enable(enable);
+#else
+    uplink_gate_.Enable(false);
+#endif
+}
+
 void AudioService::EnableAudioTesting(bool enable) {
     ESP_LOGI(TAG, "%s audio testing", enable ? "Enabling" : "Disabling");
     if (enable) {
@@ -565,6 +640,7 @@ bool AudioService::IsIdle() {
 void AudioService::ResetDecoder() {
     std::lock_guard<std::mutex> lock(audio_queue_mutex_);
     opus_decoder_->ResetState();
+    played_samples_.store(0, std::memory_order_relaxed);
     timestamp_queue_.clear();
     audio_decode_queue_.clear();
     audio_playback_queue_.clear();
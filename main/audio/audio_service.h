@@ -1,6 +1,7 @@
 #ifndef AUDIO_SERVICE_H
 #define AUDIO_SERVICE_H
 
+#include <atomic>
 #include <memory>
 #include <deque>
 #include <condition_variable>
@@ -19,6 +20,9 @@
 #include "audio_codec.h"
 #include "audio_processor.h"
 #include "processors/audio_debugger.h"
+#include "processors/audio_level_meter.h"
+#include "processors/uplink_gate.h"
+#include "processors/pre_vad.h"
 #include "wake_word.h"
 #include "protocol.h"
 
@@ -38,10 +42,16 @@
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
 #define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+// When the uplink cannot keep up, the oldest voice frames beyond this duration are dropped
+#define MAX_SEND_QUEUE_DURATION_MS 2400
+#define MAX_SEND_PACKETS_IN_QUEUE (MAX_SEND_QUEUE_DURATION_MS / OPUS_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
 #define MAX_TIMESTAMPS_IN_QUEUE 3
 
+// Quiet input kept for the wake word when the pre-VAD wakes up, and how long it stays awake after sound
+#define WAKE_WORD_PRE_ROLL_MS 320
+#define WAKE_WORD_HANGOVER_MS 2000
+
 #define AUDIO_POWER_TIMEOUT_MS 15000
 #define AUDIO_POWER_CHECK_INTERVAL_MS 1000
 
@@ -53,6 +63,7 @@
 
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
+    std::function<void(void)> on_decode_queue_available;
     std::function<void(const std::string&)> on_wake_word_detected;
     std::function<void(bool)> on_vad_change;
     std::function<void(void)> on_audio_testing_queue_full;
@@ -96,6 +107,8 @@ public:
 
     void EnableWakeWordDetection(bool enable);
     void EnableVoiceProcessing(bool enable);
+    // Hold back silent frames while voice processing runs, call before EnableVoiceProcessing(true)
+    void EnableUplinkGate(bool enable);
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
     void SetAecMode(int mode);
@@ -104,8 +117,16 @@ public:
 
     bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
     std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
+    size_t GetSendQueueSize();
+    size_t GetDecodeQueueSize();
+    uint32_t GetSendDroppedCount() const { return send_dropped_count_.load(); }
     void PlaySound(const std::string_view& sound);
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
+    // Lock-free level streams of the speaker output and the processed microphone input
+    AudioLevel GetOutputLevel() const { return output_level_meter_.Read(); }
+    AudioLevel GetInputLevel() const { return input_level_meter_.Read(); }
+    // Milliseconds of audio handed to the codec since the decoder was last reset, i.e. since speaking started
+    uint32_t GetPlaybackTime() const;
     void ResetDecoder();
 
 private:
@@ -120,6 +141,13 @@ private:
     OpusResampler reference_resampler_;
     OpusResampler output_resampler_;
     DebugStatistics debug_statistics_;
+    // Read by the main loop for the periodic stats, written by the opus codec task
+    std::atomic<uint32_t> send_dropped_count_ = 0;
+    AudioLevelMeter output_level_meter_;
+    AudioLevelMeter input_level_meter_;
+    UplinkGate uplink_gate_;
+    PreVad pre_vad_;
+    std::atomic<uint32_t> played_samples_{0};
 
     EventGroupHandle_t event_group_;
 
@@ -142,6 +170,7 @@ private:
     bool voice_detected_ = false;
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
+    bool pre_vad_need_reset_ = false;
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
     std::chrono::steady_clock::time_point last_input_time_;
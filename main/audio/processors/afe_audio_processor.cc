@@ -16,8 +16,8 @@ void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms) {
     codec_ = codec;
     frame_samples_ = frame_duration_ms * 16000 / 1000;
 
-    // Pre-allocate output buffer capacity
-    output_buffer_.reserve(frame_samples_);
+    // AFE fetch chunks rarely line up with the Opus frames
+    reframer_.Configure(frame_samples_);
 
     int ref_num = codec_->input_reference() ? 1 : 0;
 
@@ -119,6 +119,8 @@ void AfeAudioProcessor::Stop() {
     if (afe_data_ != nullptr) {
         afe_iface_->reset_buffer(afe_data_);
     }
+    // Only the processor task pushes into the reframer, so it resets it too
+    reframer_need_reset_ = true;
 }
 
 bool AfeAudioProcessor::IsRunning() {
@@ -127,6 +129,7 @@ bool AfeAudioProcessor::IsRunning() {
 
 void AfeAudioProcessor::OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) {
     output_callback_ = callback;
+    reframer_.OnOutput(callback);
 }
 
 void AfeAudioProcessor::OnVadStateChange(std::function<void(bool speaking)> callback) {
@@ -173,25 +176,12 @@ void AfeAudioProcessor::AudioProcessorTask() {
             }
         }
 
+        if (reframer_need_reset_.exchange(false)) {
+            reframer_.Reset();
+        }
         if (output_callback_) {
-            size_t samples = res->data_size / sizeof(int16_t);
-            
-            // Add data to buffer
-            output_buffer_.insert(output_buffer_.end(), res->data, res->data + samples);
-            
-            // Output complete frames when buffer has enough data
-            while (output_buffer_.size() >= frame_samples_) {
-                if (output_buffer_.size() == frame_samples_) {
-                    // If buffer size equals frame size, move the entire buffer
-                    output_callback_(std::move(output_buffer_));
-                    output_buffer_.clear();
-                    output_buffer_.reserve(frame_samples_);
-                } else {
-                    // If buffer size exceeds frame size, copy one frame and remove it
-                    output_callback_(std::vector<int16_t>(output_buffer_.begin(), output_buffer_.begin() + frame_samples_));
-                    output_buffer_.erase(output_buffer_.begin(), output_buffer_.begin() + frame_samples_);
-                }
-            }
+            // Copied once into the frame being filled, full frames are handed off by move
+            reframer_.Push(res->data, res->data_size / sizeof(int16_t));
         }
     }
 }
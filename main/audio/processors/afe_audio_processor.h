@@ -8,10 +8,12 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
 #include <functional>
 
 #include "audio_processor.h"
 #include "audio_codec.h"
+#include "audio_reframer.h"
 
 class AfeAudioProcessor : public AudioProcessor {
 public:
@@ -50,7 +52,9 @@ private:
     AudioCodec* codec_ = nullptr;
     int frame_samples_ = 0;
     bool is_speaking_ = false;
-    std::vector<int16_t> output_buffer_;
+    AudioReframer reframer_;
+    // Set by Stop(), the processor task drops the partial frame before the next session
+    std::atomic<bool> reframer_need_reset_ = false;
 
 
     int current_aec_mode_ = 1;  
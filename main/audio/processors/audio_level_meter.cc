@@ -0,0 +1,97 @@
+#include "audio_level_meter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <esp_timer.h>
+
+#define AUDIO_LEVEL_UPDATE_HZ 30
+#define AUDIO_LEVEL_LOW_CUTOFF_HZ 400
+#define AUDIO_LEVEL_MID_CUTOFF_HZ 2000
+#define AUDIO_LEVEL_FLOOR_DB 60.0f
+#define AUDIO_LEVEL_STALE_MS 100
+
+static int32_t OnePoleAlpha(int cutoff_hz, int sample_rate) {
+    return (int32_t)lroundf(32768.0f * (1.0f - expf(-2.0f * (float)M_PI * cutoff_hz / sample_rate)));
+}
+
+// Map a mean square (full scale = 32768^2) to 0-255 over the -60..0 dBFS range
+static uint8_t ToLevel(float mean_square) {
+    if (mean_square < 1.0f) {
+        return 0;
+    }
+    float db = 10.0f * log10f(mean_square / (32768.0f * 32768.0f));
+    float level = (db + AUDIO_LEVEL_FLOOR_DB) * 255.0f / AUDIO_LEVEL_FLOOR_DB;
+    return (uint8_t)std::clamp(level, 0.0f, 255.0f);
+}
+
+void AudioLevelMeter::Configure(int sample_rate) {
+    samples_per_update_ = sample_rate / AUDIO_LEVEL_UPDATE_HZ;
+    low_alpha_ = OnePoleAlpha(AUDIO_LEVEL_LOW_CUTOFF_HZ, sample_rate);
+    mid_alpha_ = OnePoleAlpha(AUDIO_LEVEL_MID_CUTOFF_HZ, sample_rate);
+    low_state_[0] = low_state_[1] = 0;
+    mid_state_[0] = mid_state_[1] = 0;
+    count_ = 0;
+    peak_ = 0;
+    energy_ = low_energy_ = mid_energy_ = high_energy_ = 0;
+}
+
+void AudioLevelMeter::Process(const int16_t* samples, size_t count) {
+    if (samples_per_update_ == 0) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        int32_t x = samples[i];
+        // Two cascaded one-pole stages per split give 12 dB per octave
+        low_state_[0] += ((x - low_state_[0]) * low_alpha_) >> 15;
+        low_state_[1] += ((low_state_[0] - low_state_[1]) * low_alpha_) >> 15;
+        mid_state_[0] += ((x - mid_state_[0]) * mid_alpha_) >> 15;
+        mid_state_[1] += ((mid_state_[0] - mid_state_[1]) * mid_alpha_) >> 15;
+        int32_t low = low_state_[1];
+        int32_t mid = mid_state_[1] - low;
+        int32_t high = x - mid_state_[1];
+
+        peak_ = std::max(peak_, abs(x));
+        energy_ += x * x;
+        low_energy_ += low * low;
+        mid_energy_ += (int64_t)mid * mid;
+        high_energy_ += (int64_t)high * high;
+
+        if (++count_ == samples_per_update_) {
+            Publish();
+        }
+    }
+}
+
+void AudioLevelMeter::Publish() {
+    float scale = 1.0f / count_;
+    uint32_t rms = ToLevel(energy_ * scale);
+    uint32_t peak = ToLevel((float)peak_ * peak_);
+    uint32_t low = ToLevel(low_energy_ * scale);
+    uint32_t mid = ToLevel(mid_energy_ * scale);
+    uint32_t high = ToLevel(high_energy_ * scale);
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+
+    levels_.store(rms | peak << 8 | low << 16 | mid << 24, std::memory_order_relaxed);
+    stamp_.store(high | now_ms << 8, std::memory_order_release);
+
+    count_ = 0;
+    peak_ = 0;
+    energy_ = low_energy_ = mid_energy_ = high_energy_ = 0;
+}
+
+AudioLevel AudioLevelMeter::Read() const {
+    AudioLevel level;
+    uint32_t stamp = stamp_.load(std::memory_order_acquire);
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+    if (((now_ms - (stamp >> 8)) & 0xFFFFFF) > AUDIO_LEVEL_STALE_MS) {
+        return level;
+    }
+    uint32_t levels = levels_.load(std::memory_order_relaxed);
+    level.rms = levels & 0xFF;
+    level.peak = (levels >> 8) & 0xFF;
+    level.low = (levels >> 16) & 0xFF;
+    level.mid = levels >> 24;
+    level.high = stamp & 0xFF;
+    return level;
+}
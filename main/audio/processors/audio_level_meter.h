@@ -0,0 +1,54 @@
+#ifndef AUDIO_LEVEL_METER_H
+#define AUDIO_LEVEL_METER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Levels on a 0-255 scale covering -60 dBFS to 0 dBFS
+struct AudioLevel {
+    uint8_t rms = 0;
+    uint8_t peak = 0;
+    uint8_t low = 0;    // Below 400 Hz
+    uint8_t mid = 0;    // 400 Hz to 2 kHz
+    uint8_t high = 0;   // Above 2 kHz
+};
+
+/*
+ * Measures RMS, peak and three band energies of a PCM stream and publishes
+ * them about 30 times per second. Process() runs on the audio task with four
+ * one-pole stages and a few multiplies per sample, Read() is lock-free so
+ * LEDs and displays can poll it from their own timers.
+ */
+class AudioLevelMeter {
+public:
+    void Configure(int sample_rate);
+
+    // Single writer, the task that owns the PCM stream
+    void Process(const int16_t* samples, size_t count);
+
+    // Any task, returns silence if nothing was published in the last 100 ms
+    AudioLevel Read() const;
+
+private:
+    int samples_per_update_ = 0;
+    int32_t low_alpha_ = 0;         // Q15 one-pole coefficient at 400 Hz
+    int32_t mid_alpha_ = 0;         // Q15 one-pole coefficient at 2 kHz
+    int32_t low_state_[2] = {};
+    int32_t mid_state_[2] = {};
+
+    int count_ = 0;
+    int32_t peak_ = 0;
+    int64_t energy_ = 0;
+    int64_t low_energy_ = 0;
+    int64_t mid_energy_ = 0;
+    int64_t high_energy_ = 0;
+
+    // rms | peak << 8 | low << 16 | mid << 24, then high | publish time in ms << 8
+    std::atomic<uint32_t> levels_{0};
+    std::atomic<uint32_t> stamp_{0};
+
+    void Publish();
+};
+
+#endif // AUDIO_LEVEL_METER_H
@@ -0,0 +1,39 @@
+#include "audio_reframer.h"
+
+#include <algorithm>
+
+void AudioReframer::Configure(size_t frame_samples) {
+    frame_samples_ = frame_samples;
+    Reset();
+}
+
+void AudioReframer::Reset() {
+    frame_.clear();
+    frame_.reserve(frame_samples_);
+}
+
+void AudioReframer::OnOutput(std::function<void(std::vector<int16_t>&& frame)> callback) {
+    output_callback_ = callback;
+}
+
+void AudioReframer::Push(const int16_t* samples, size_t count) {
+    if (frame_samples_ == 0) {
+        return;
+    }
+    while (count > 0) {
+        size_t take = std::min(count, frame_samples_ - frame_.size());
+        frame_.insert(frame_.end(), samples, samples + take);
+        samples += take;
+        count -= take;
+
+        if (frame_.size() == frame_samples_) {
+            // The consumer owns the buffer from here on, start the next one at full size
+            auto frame = std::move(frame_);
+            frame_ = std::vector<int16_t>();
+            frame_.reserve(frame_samples_);
+            if (output_callback_) {
+                output_callback_(std::move(frame));
+            }
+        }
+    }
+}
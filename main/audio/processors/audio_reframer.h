@@ -0,0 +1,31 @@
+#ifndef AUDIO_REFRAMER_H
+#define AUDIO_REFRAMER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * Cuts a stream of arbitrarily sized chunks into frames of exactly frame_samples.
+ * Samples are copied once, straight from the source into the frame being filled,
+ * and a full frame is handed off by move. The next frame buffer is reserved at its
+ * final size, so nothing is ever erased from the front or reallocated while filling.
+ */
+class AudioReframer {
+public:
+    void Configure(size_t frame_samples);
+    // Drops the partially filled frame
+    void Reset();
+
+    // Single writer, the task that produces the chunks
+    void Push(const int16_t* samples, size_t count);
+    void OnOutput(std::function<void(std::vector<int16_t>&& frame)> callback);
+
+private:
+    size_t frame_samples_ = 0;
+    std::vector<int16_t> frame_;
+    std::function<void(std::vector<int16_t>&& frame)> output_callback_;
+};
+
+#endif // AUDIO_REFRAMER_H
@@ -0,0 +1,99 @@
+#include "pre_vad.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define PRE_VAD_FLOOR_MIN_DB -75.0f         // dBFS, keeps near digital silence from triggering on every click
+#define PRE_VAD_FLOOR_RISE_DB_PER_S 3.0f    // The floor creeps up through sustained sound, so a new fan is learned
+#define PRE_VAD_FLOOR_FALL 0.3f             // Share of the gap closed per chunk when the room gets quieter
+#define PRE_VAD_FRICATIVE_ZCR 0.3f          // Crossings per sample, about 2.4 kHz at 16 kHz
+
+void PreVad::Configure(int sample_rate, int channels, int threshold_db, int pre_roll_ms, int hangover_ms) {
+    sample_rate_ = sample_rate;
+    channels_ = std::max(1, channels);
+    threshold_db_ = threshold_db;
+    pre_roll_samples_ = pre_roll_ms * sample_rate / 1000;
+    hangover_samples_ = hangover_ms * sample_rate / 1000;
+    Reset();
+}
+
+void PreVad::Reset() {
+    // The noise floor is kept, the room rarely changes between two detections
+    hangover_left_ = hangover_samples_;
+    pre_roll_.clear();
+    pre_roll_size_ = 0;
+    statistics_ = PreVadStatistics();
+}
+
+void PreVad::OnOutput(std::function<void(std::vector<int16_t>&& chunk)> callback) {
+    output_callback_ = callback;
+}
+
+bool PreVad::IsLoud(const std::vector<int16_t>& chunk, int samples) {
+    int64_t energy = 0;
+    int crossings = 0;
+    int32_t previous = chunk[0];
+    for (int i = 0; i < samples; i++) {
+        int32_t sample = chunk[i * channels_];
+        energy += sample * sample;
+        crossings += (sample ^ previous) < 0;
+        previous = sample;
+    }
+
+    float db = 10.0f * log10f((float)energy / samples / (32768.0f * 32768.0f) + 1e-10f);
+    if (!floor_valid_) {
+        noise_floor_db_ = std::max(db, PRE_VAD_FLOOR_MIN_DB);
+        floor_valid_ = true;
+    }
+    float zcr = (float)crossings / samples;
+    bool loud = db > noise_floor_db_ + threshold_db_ ||
+        (zcr > PRE_VAD_FRICATIVE_ZCR && db > noise_floor_db_ + threshold_db_ / 2);
+
+    if (db < noise_floor_db_) {
+        noise_floor_db_ += (db - noise_floor_db_) * PRE_VAD_FLOOR_FALL;
+    } else {
+        noise_floor_db_ += std::min(db - noise_floor_db_, PRE_VAD_FLOOR_RISE_DB_PER_S * samples / sample_rate_);
+    }
+    noise_floor_db_ = std::max(noise_floor_db_, PRE_VAD_FLOOR_MIN_DB);
+    return loud;
+}
+
+void PreVad::Process(std::vector<int16_t>&& chunk) {
+    int samples = chunk.size() / channels_;
+    if (samples == 0) {
+        return;
+    }
+    statistics_.chunks++;
+
+    if (IsLoud(chunk, samples)) {
+        if (hangover_left_ <= 0) {
+            statistics_.wake_ups++;
+        }
+        hangover_left_ = hangover_samples_ + samples;
+    }
+
+    if (hangover_left_ > 0) {
+        hangover_left_ = std::max(0, hangover_left_ - samples);
+        while (!pre_roll_.empty()) {
+            statistics_.passed_chunks++;
+            if (output_callback_) {
+                output_callback_(std::move(pre_roll_.front()));
+            }
+            pre_roll_.pop_front();
+        }
+        pre_roll_size_ = 0;
+        statistics_.passed_chunks++;
+        if (output_callback_) {
+            output_callback_(std::move(chunk));
+        }
+        return;
+    }
+
+    // Keep just enough of the quiet chunks to cover the pre-roll
+    pre_roll_size_ += samples;
+    pre_roll_.push_back(std::move(chunk));
+    while (!pre_roll_.empty() && pre_roll_size_ - (int)pre_roll_.front().size() / channels_ >= pre_roll_samples_) {
+        pre_roll_size_ -= pre_roll_.front().size() / channels_;
+        pre_roll_.pop_front();
+    }
+}
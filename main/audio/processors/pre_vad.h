@@ -0,0 +1,56 @@
+#ifndef PRE_VAD_H
+#define PRE_VAD_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+struct PreVadStatistics {
+    uint32_t chunks = 0;
+    uint32_t passed_chunks = 0;
+    uint32_t wake_ups = 0;
+};
+
+/*
+ * Cheap first stage in front of the wake word models. Each chunk costs one pass
+ * of multiply-adds over the microphone channel: its energy is compared with an
+ * adaptive noise floor, and the zero-crossing rate helps catch quiet fricative
+ * onsets. While the room is quiet, chunks are held back as pre-roll and the
+ * models are not fed. When energy rises, the pre-roll is passed first, so the
+ * models still hear the whole wake word onset. They keep being fed until the
+ * hangover after the last loud chunk runs out.
+ */
+class PreVad {
+public:
+    // Interleaved chunks, only the first channel is analysed
+    void Configure(int sample_rate, int channels, int threshold_db, int pre_roll_ms, int hangover_ms);
+    // Starts active so the models see the room right after they are enabled
+    void Reset();
+
+    // Single writer, the audio input task
+    void Process(std::vector<int16_t>&& chunk);
+    void OnOutput(std::function<void(std::vector<int16_t>&& chunk)> callback);
+
+    bool active() const { return hangover_left_ > 0; }
+    PreVadStatistics GetStatistics() const { return statistics_; }
+
+private:
+    int sample_rate_ = 16000;
+    int channels_ = 1;
+    float threshold_db_ = 9.0f;
+    int pre_roll_samples_ = 0;
+    int hangover_samples_ = 0;
+
+    float noise_floor_db_ = 0.0f;
+    bool floor_valid_ = false;
+    int hangover_left_ = 0;
+    int pre_roll_size_ = 0;
+    std::deque<std::vector<int16_t>> pre_roll_;
+    PreVadStatistics statistics_;
+    std::function<void(std::vector<int16_t>&& chunk)> output_callback_;
+
+    bool IsLoud(const std::vector<int16_t>& chunk, int samples);
+};
+
+#endif // PRE_VAD_H
@@ -0,0 +1,71 @@
+#include "uplink_gate.h"
+
+static int FramesFor(int duration_ms, int frame_duration_ms) {
+    return duration_ms <= 0 ? 0 : (duration_ms + frame_duration_ms - 1) / frame_duration_ms;
+}
+
+void UplinkGate::Configure(int frame_duration_ms, int pre_roll_ms, int hangover_ms, int keepalive_ms) {
+    pre_roll_frames_ = FramesFor(pre_roll_ms, frame_duration_ms);
+    hangover_frames_ = FramesFor(hangover_ms, frame_duration_ms);
+    keepalive_frames_ = FramesFor(keepalive_ms, frame_duration_ms);
+}
+
+void UplinkGate::Enable(bool enable) {
+    enabled_ = enable;
+    pre_roll_.clear();
+    hangover_left_ = 0;
+    closed_frames_ = 0;
+    statistics_ = UplinkGateStatistics();
+}
+
+void UplinkGate::OnOutput(std::function<void(std::vector<int16_t>&& frame)> callback) {
+    output_callback_ = callback;
+}
+
+void UplinkGate::Send(std::vector<int16_t>&& frame) {
+    statistics_.sent_frames++;
+    if (output_callback_) {
+        output_callback_(std::move(frame));
+    }
+}
+
+void UplinkGate::Process(std::vector<int16_t>&& frame, bool speech) {
+    statistics_.frames++;
+    if (!enabled_) {
+        Send(std::move(frame));
+        return;
+    }
+
+    if (speech || hangover_left_ > 0) {
+        while (!pre_roll_.empty()) {
+            Send(std::move(pre_roll_.front()));
+            pre_roll_.pop_front();
+        }
+        hangover_left_ = speech ? hangover_frames_ : hangover_left_ - 1;
+        closed_frames_ = 0;
+        Send(std::move(frame));
+        return;
+    }
+
+    bool keepalive = keepalive_frames_ > 0 && ++closed_frames_ >= keepalive_frames_;
+    if (keepalive) {
+        closed_frames_ = 0;
+        statistics_.keepalive_frames++;
+    }
+    if (pre_roll_frames_ == 0 || (keepalive && pre_roll_.empty())) {
+        if (keepalive) {
+            Send(std::move(frame));
+        }
+        return;
+    }
+
+    // The keepalive is the oldest pre-roll frame, so the frames sent stay in capture order
+    // and the pre-roll still reaches back to before a speech onset right after it
+    if (pre_roll_.size() >= pre_roll_frames_ || keepalive) {
+        if (keepalive) {
+            Send(std::move(pre_roll_.front()));
+        }
+        pre_roll_.pop_front();
+    }
+    pre_roll_.push_back(std::move(frame));
+}
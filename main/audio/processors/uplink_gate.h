@@ -0,0 +1,52 @@
+#ifndef UPLINK_GATE_H
+#define UPLINK_GATE_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+struct UplinkGateStatistics {
+    uint32_t frames = 0;
+    uint32_t sent_frames = 0;
+    uint32_t keepalive_frames = 0;
+};
+
+/*
+ * Holds back the silent frames of a listening session so they are neither
+ * Opus-encoded nor sent. Speech frames open the gate, and it stays open for the
+ * hangover so word endings and short pauses pass. While closed, the last frames
+ * are kept as pre-roll and sent ahead of the next speech frame to cover the VAD
+ * onset latency, and one frame per keepalive interval is still sent so the server
+ * keeps hearing the room. Frames are always sent in capture order.
+ */
+class UplinkGate {
+public:
+    // Durations are rounded up to whole frames, a keepalive of 0 sends nothing while closed
+    void Configure(int frame_duration_ms, int pre_roll_ms, int hangover_ms, int keepalive_ms);
+    // Disabled gates pass every frame, enabling starts closed
+    void Enable(bool enable);
+    bool enabled() const { return enabled_; }
+
+    // Single writer, the task that produces the frames
+    void Process(std::vector<int16_t>&& frame, bool speech);
+    void OnOutput(std::function<void(std::vector<int16_t>&& frame)> callback);
+
+    UplinkGateStatistics GetStatistics() const { return statistics_; }
+
+private:
+    bool enabled_ = false;
+    size_t pre_roll_frames_ = 0;
+    int hangover_frames_ = 0;
+    int keepalive_frames_ = 0;
+
+    std::deque<std::vector<int16_t>> pre_roll_;
+    int hangover_left_ = 0;
+    int closed_frames_ = 0;
+    UplinkGateStatistics statistics_;
+    std::function<void(std::vector<int16_t>&& frame)> output_callback_;
+
+    void Send(std::vector<int16_t>&& frame);
+};
+
+#endif // UPLINK_GATE_H
@@ -5,16 +5,13 @@
 #include <functional>
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
-#include "anim_player.h"
+#include "aaf_player.h"
 #include "mmap_generate_emoji.h"
 
 namespace anim {
 
 class EmojiPlayer;
 
-using FlushIoReadyCallback = std::function<bool(esp_lcd_panel_io_handle_t, esp_lcd_panel_io_event_data_t*, void*)>;
-using FlushCallback = std::function<void(anim_player_handle_t, int, int, int, int, const void*)>;
-
 class EmojiPlayer {
 public:
     EmojiPlayer(esp_lcd_panel_handle_t panel, esp_lcd_panel_io_handle_t panel_io);
@@ -25,9 +22,8 @@ public:
 
 private:
     static bool OnFlushIoReady(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx);
-    static void OnFlush(anim_player_handle_t handle, int x_start, int y_start, int x_end, int y_end, const void *color_data);
 
-    anim_player_handle_t player_handle_;
+    std::unique_ptr<AafPlayer> player_;
     mmap_assets_handle_t assets_handle_;
 };
 
@@ -0,0 +1,499 @@
+#include "aaf_player.h"
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#define TAG "AafPlayer"
+
+#define AAF_HEADER_SIZE 12
+#define AAF_FRAME_HEADER_SIZE 20        // "ZZ" plus the split image header up to the split lengths
+#define AAF_PALETTE_SIZE (256 * 4)
+#define AAF_ENCODING_RLE 0
+
+static uint16_t ReadU16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t ReadU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void* AllocateLarge(size_t size) {
+    void* buffer = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (buffer == nullptr) {
+        buffer = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    return buffer;
+}
+
+bool AafAnimation::Load(const void* data, size_t size) {
+    data_ = nullptr;
+    frame_count_ = 0;
+    auto bytes = static_cast<const uint8_t*>(data);
+    if (bytes == nullptr || size < AAF_HEADER_SIZE) {
+        ESP_LOGE(TAG, "Invalid animation");
+        return false;
+    }
+    uint32_t count = ReadU32(bytes);
+    if (count == 0 || AAF_HEADER_SIZE + count * 8ULL > size) {
+        ESP_LOGE(TAG, "Invalid frame table, %u frames", (unsigned)count);
+        return false;
+    }
+    size_t payload = size - AAF_HEADER_SIZE - count * 8;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* entry = bytes + AAF_HEADER_SIZE + i * 8;
+        if ((uint64_t)ReadU32(entry + 4) + ReadU32(entry) > payload) {
+            ESP_LOGE(TAG, "Frame %u is out of bounds", (unsigned)i);
+            return false;
+        }
+    }
+    data_ = bytes;
+    size_ = size;
+    frame_count_ = count;
+    return true;
+}
+
+bool AafAnimation::GetFrame(int index, AafFrame* frame) const {
+    if (data_ == nullptr || index < 0 || index >= frame_count_) {
+        return false;
+    }
+    const uint8_t* entry = data_ + AAF_HEADER_SIZE + index * 8;
+    size_t length = ReadU32(entry);
+    const uint8_t* p = data_ + AAF_HEADER_SIZE + frame_count_ * 8 + ReadU32(entry + 4);
+    if (length < AAF_FRAME_HEADER_SIZE || memcmp(p, "ZZ_S", 4) != 0) {
+        ESP_LOGE(TAG, "Frame %d is not a split image", index);
+        return false;
+    }
+    if (p[11] != 8) {
+        ESP_LOGE(TAG, "Frame %d has unsupported bit depth %d", index, p[11]);
+        return false;
+    }
+    frame->width = ReadU16(p + 12);
+    frame->height = ReadU16(p + 14);
+    frame->splits = ReadU16(p + 16);
+    frame->split_height = ReadU16(p + 18);
+    if (frame->split_height == 0 || frame->splits * frame->split_height < frame->height) {
+        ESP_LOGE(TAG, "Frame %d splits do not cover the image", index);
+        return false;
+    }
+
+    size_t blocks_offset = AAF_FRAME_HEADER_SIZE + frame->splits * 2 + AAF_PALETTE_SIZE;
+    if (blocks_offset > length) {
+        ESP_LOGE(TAG, "Frame %d is truncated", index);
+        return false;
+    }
+    frame->split_lengths = p + AAF_FRAME_HEADER_SIZE;
+    frame->palette = frame->split_lengths + frame->splits * 2;
+    frame->blocks = p + blocks_offset;
+    size_t total = 0;
+    for (int i = 0; i < frame->splits; i++) {
+        total += ReadU16(frame->split_lengths + i * 2);
+    }
+    if (blocks_offset + total > length) {
+        ESP_LOGE(TAG, "Frame %d blocks are truncated", index);
+        return false;
+    }
+    return true;
+}
+
+bool AafAnimation::DecodeBlock(const uint8_t* block, size_t length, uint8_t* indices, size_t count) {
+    if (length < 1 || block[0] != AAF_ENCODING_RLE) {
+        ESP_LOGE(TAG, "Unsupported block encoding %d", length < 1 ? -1 : block[0]);
+        return false;
+    }
+    // Pairs of run length and palette index
+    size_t filled = 0;
+    for (size_t i = 1; i + 1 < length; i += 2) {
+        size_t run = block[i];
+        if (filled + run > count) {
+            return false;
+        }
+        memset(indices + filled, block[i + 1], run);
+        filled += run;
+    }
+    return filled == count;
+}
+
+AafPlayer::AafPlayer(int width, int height, int max_transfer_pixels, int cache_entries, FlushCallback flush)
+    : width_(width), height_(height), max_transfer_pixels_(std::max(max_transfer_pixels, width)), flush_(flush) {
+    screen_ = static_cast<uint16_t*>(AllocateLarge(width_ * height_ * sizeof(uint16_t)));
+    assert(screen_ != nullptr);
+    for (int i = 0; i < AAF_PLAYER_TRANSFER_BUFFERS; i++) {
+        transfer_[i] = static_cast<uint16_t*>(heap_caps_malloc(max_transfer_pixels_ * sizeof(uint16_t),
+            MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL));
+        assert(transfer_[i] != nullptr);
+    }
+
+    // Hot frames are only worth it in PSRAM, internal RAM is kept for the transfers
+    cache_.resize(cache_entries);
+    for (auto& entry : cache_) {
+        entry.indices = static_cast<uint8_t*>(heap_caps_malloc(width_ * height_, MALLOC_CAP_SPIRAM));
+        if (entry.indices == nullptr) {
+            ESP_LOGW(TAG, "No PSRAM for the frame cache");
+            cache_.resize(&entry - cache_.data());
+            break;
+        }
+    }
+
+    transfer_done_ = xSemaphoreCreateCounting(AAF_PLAYER_TRANSFER_BUFFERS, AAF_PLAYER_TRANSFER_BUFFERS);
+    xTaskCreate([](void* arg) {
+        auto self = static_cast<AafPlayer*>(arg);
+        self->PlayerTask();
+        vTaskDelete(NULL);
+    }, "aaf_player", 4096, this, 4, &task_);
+}
+
+AafPlayer::~AafPlayer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exit_ = true;
+    }
+    xTaskNotifyGive(task_);
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (task_ == nullptr) {
+                break;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    vSemaphoreDelete(transfer_done_);
+    for (auto& entry : cache_) {
+        heap_caps_free(entry.indices);
+    }
+    for (int i = 0; i < AAF_PLAYER_TRANSFER_BUFFERS; i++) {
+        heap_caps_free(transfer_[i]);
+    }
+    heap_caps_free(screen_);
+}
+
+void AafPlayer::Play(const void* data, size_t size, bool repeat, int fps, int start_frame, bool hot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    next_data_ = data;
+    next_size_ = size;
+    next_repeat_ = repeat;
+    next_fps_ = std::max(fps, 1);
+    next_start_frame_ = start_frame;
+    next_hot_ = hot;
+    command_pending_ = true;
+    xTaskNotifyGive(task_);
+}
+
+void AafPlayer::Stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    next_data_ = nullptr;
+    command_pending_ = true;
+    xTaskNotifyGive(task_);
+}
+
+bool AafPlayer::FlushReadyFromIsr() {
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(transfer_done_, &higher_priority_task_woken);
+    return higher_priority_task_woken == pdTRUE;
+}
+
+AafPlayerStatistics AafPlayer::GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+void AafPlayer::PlayerTask() {
+    while (true) {
+        TickType_t wait = portMAX_DELAY;
+        if (playing_) {
+            int64_t delay_us = next_time_ - esp_timer_get_time();
+            // Round up, waking a tick early would spin until the frame is due
+            int64_t tick_us = portTICK_PERIOD_MS * 1000;
+            wait = delay_us > 0 ? (delay_us + tick_us - 1) / tick_us : 0;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (exit_) {
+                break;
+            }
+            if (command_pending_) {
+                command_pending_ = false;
+                playing_ = next_data_ != nullptr && animation_.Load(next_data_, next_size_);
+                if (playing_) {
+                    repeat_ = next_repeat_;
+                    hot_ = next_hot_;
+                    start_frame_ = std::min(std::max(next_start_frame_, 0), animation_.frame_count() - 1);
+                    nominal_interval_us_ = 1000000 / next_fps_;
+                    interval_us_ = nominal_interval_us_;
+                    start_time_ = esp_timer_get_time();
+                    next_time_ = start_time_;
+                    last_tick_ = -1;
+                    last_frame_ = -1;
+                }
+            }
+        }
+        if (playing_ && esp_timer_get_time() >= next_time_) {
+            RenderNext();
+        }
+    }
+
+    WaitTransfers();
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = nullptr;
+}
+
+void AafPlayer::RenderNext() {
+    int64_t frame_start = esp_timer_get_time();
+    // The animation runs on the clock, a slow panel drops frames rather than slowing down
+    int64_t tick = (frame_start - start_time_) / nominal_interval_us_;
+    int frames = animation_.frame_count() - start_frame_;
+    int index;
+    if (tick < frames) {
+        index = start_frame_ + tick;
+    } else if (repeat_) {
+        index = start_frame_ + tick % frames;
+    } else {
+        index = animation_.frame_count() - 1;
+        playing_ = false;
+    }
+    if (last_tick_ >= 0 && tick > last_tick_ + 1) {
+        task_statistics_.dropped_frames += tick - last_tick_ - 1;
+    }
+    last_tick_ = tick;
+
+    if (index != last_frame_) {
+        uint64_t bytes = task_statistics_.bytes_flushed;
+        if (!RenderFrame(index)) {
+            playing_ = false;
+            screen_valid_ = false;
+            return;
+        }
+        last_frame_ = index;
+        task_statistics_.frames++;
+
+        // Stretch the interval while rendering and flushing take longer than a frame slot
+        WaitTransfers();
+        int64_t cost = esp_timer_get_time() - frame_start;
+        interval_us_ = std::max(nominal_interval_us_, (interval_us_ * 3 + cost) / 4);
+        bytes = task_statistics_.bytes_flushed - bytes;
+        if (bytes > 0 && cost > 0) {
+            task_statistics_.bandwidth = (task_statistics_.bandwidth * 3 + bytes * 1000000 / cost) / 4;
+        }
+        task_statistics_.frame_interval_us = interval_us_;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        statistics_ = task_statistics_;
+    }
+    // Stay on the nominal grid so wakeup latency does not accumulate into dropped frames
+    next_time_ = start_time_ + (tick + 1) * nominal_interval_us_;
+    if (interval_us_ > nominal_interval_us_) {
+        next_time_ = std::max(next_time_, frame_start + interval_us_);
+    }
+}
+
+bool AafPlayer::RenderFrame(int index) {
+    AafFrame frame;
+    if (!animation_.GetFrame(index, &frame)) {
+        return false;
+    }
+    if (frame.width != width_ || frame.height != height_) {
+        ESP_LOGE(TAG, "Frame size %dx%d does not match the panel %dx%d", frame.width, frame.height, width_, height_);
+        return false;
+    }
+    band_.resize(width_ * frame.split_height);
+    shown_blocks_.resize(frame.splits, nullptr);
+    shown_lengths_.resize(frame.splits, 0);
+
+    // Only the frame that opens a hot animation comes from the cache, later frames diff band by band
+    if (hot_ && last_frame_ < 0 && !cache_.empty()) {
+        CacheEntry* entry = FindCache(frame.split_lengths);
+        if (entry != nullptr) {
+            task_statistics_.cache_hits++;
+        } else {
+            task_statistics_.cache_misses++;
+            entry = EvictCache();
+            if (!DecodeToCache(*entry, frame)) {
+                entry->source = nullptr;
+                return false;
+            }
+        }
+        entry->last_used = ++cache_clock_;
+        return RenderCachedFrame(*entry, frame);
+    }
+
+    bool palette_changed = UpdatePalette(frame.palette);
+    bool can_skip = screen_valid_ && !palette_changed;
+    const uint8_t* block = frame.blocks;
+    for (int i = 0; i < frame.splits; i++) {
+        uint16_t length = ReadU16(frame.split_lengths + i * 2);
+        int y = i * frame.split_height;
+        int rows = std::min(frame.split_height, height_ - y);
+        if (rows <= 0) {
+            break;
+        }
+        if (can_skip && shown_lengths_[i] == length &&
+            (shown_blocks_[i] == block || memcmp(shown_blocks_[i], block, length) == 0)) {
+            task_statistics_.blocks_skipped++;
+        } else {
+            if (!AafAnimation::DecodeBlock(block, length, band_.data(), rows * width_)) {
+                ESP_LOGE(TAG, "Frame %d band %d is corrupted", index, i);
+                return false;
+            }
+            task_statistics_.blocks_decoded++;
+            CompareBand(band_.data(), palette_, y, rows);
+        }
+        shown_blocks_[i] = block;
+        shown_lengths_[i] = length;
+        block += length;
+    }
+    FlushPending();
+    screen_valid_ = true;
+    return true;
+}
+
+bool AafPlayer::RenderCachedFrame(const CacheEntry& entry, const AafFrame& frame) {
+    for (int y = 0; y < height_; y += frame.split_height) {
+        int rows = std::min(frame.split_height, height_ - y);
+        CompareBand(entry.indices + y * width_, entry.palette, y, rows);
+    }
+    FlushPending();
+    screen_valid_ = true;
+
+    // The next frame diffs against this one as if it had been decoded from flash
+    memcpy(palette_, entry.palette, sizeof(palette_));
+    palette_source_ = frame.palette;
+    const uint8_t* block = frame.blocks;
+    for (int i = 0; i < frame.splits; i++) {
+        shown_blocks_[i] = block;
+        shown_lengths_[i] = ReadU16(frame.split_lengths + i * 2);
+        block += shown_lengths_[i];
+    }
+    return true;
+}
+
+bool AafPlayer::DecodeToCache(CacheEntry& entry, const AafFrame& frame) {
+    const uint8_t* block = frame.blocks;
+    for (int i = 0; i < frame.splits; i++) {
+        uint16_t length = ReadU16(frame.split_lengths + i * 2);
+        int y = i * frame.split_height;
+        int rows = std::min(frame.split_height, height_ - y);
+        if (rows <= 0) {
+            break;
+        }
+        if (!AafAnimation::DecodeBlock(block, length, entry.indices + y * width_, rows * width_)) {
+            ESP_LOGE(TAG, "Band %d is corrupted", i);
+            return false;
+        }
+        task_statistics_.blocks_decoded++;
+        block += length;
+    }
+    UpdatePalette(frame.palette);
+    memcpy(entry.palette, palette_, sizeof(palette_));
+    entry.source = frame.split_lengths;
+    return true;
+}
+
+bool AafPlayer::UpdatePalette(const uint8_t* palette) {
+    if (palette_source_ != nullptr &&
+        (palette_source_ == palette || memcmp(palette_source_, palette, AAF_PALETTE_SIZE) == 0)) {
+        palette_source_ = palette;
+        return false;
+    }
+    for (int i = 0; i < 256; i++) {
+        const uint8_t* bgra = palette + i * 4;
+        uint16_t color = ((bgra[2] & 0xF8) << 8) | ((bgra[1] & 0xFC) << 3) | (bgra[0] >> 3);
+        // Panels take RGB565 big endian
+        palette_[i] = (color >> 8) | (color << 8);
+    }
+    palette_source_ = palette;
+    return true;
+}
+
+void AafPlayer::CompareBand(const uint8_t* indices, const uint16_t* palette, int y, int rows) {
+    int x_start = screen_valid_ ? width_ : 0;
+    int x_end = screen_valid_ ? -1 : width_ - 1;
+    for (int row = 0; row < rows; row++) {
+        uint16_t* pixels = screen_ + (y + row) * width_;
+        const uint8_t* source = indices + row * width_;
+        for (int x = 0; x < width_; x++) {
+            uint16_t color = palette[source[x]];
+            if (pixels[x] != color) {
+                pixels[x] = color;
+                x_start = std::min(x_start, x);
+                x_end = std::max(x_end, x);
+            }
+        }
+    }
+    if (x_end >= x_start) {
+        AddDirty({x_start, y, x_end, y + rows - 1});
+    }
+}
+
+void AafPlayer::AddDirty(const Rect& rect) {
+    if (has_pending_ && pending_.y_end + 1 == rect.y_start) {
+        // Grow the pending rectangle downwards while that wastes fewer pixels than a transaction costs
+        Rect merged = {std::min(pending_.x_start, rect.x_start), pending_.y_start,
+                       std::max(pending_.x_end, rect.x_end), rect.y_end};
+        auto area = [](const Rect& r) { return (r.x_end - r.x_start + 1) * (r.y_end - r.y_start + 1); };
+        if (area(merged) - area(pending_) - area(rect) <= AAF_PLAYER_MERGE_SLACK_PIXELS) {
+            pending_ = merged;
+            return;
+        }
+    }
+    FlushPending();
+    pending_ = rect;
+    has_pending_ = true;
+}
+
+void AafPlayer::FlushPending() {
+    if (has_pending_) {
+        has_pending_ = false;
+        FlushRect(pending_);
+    }
+}
+
+void AafPlayer::FlushRect(const Rect& rect) {
+    int width = rect.x_end - rect.x_start + 1;
+    int rows_per_transfer = max_transfer_pixels_ / width;
+    for (int y = rect.y_start; y <= rect.y_end; y += rows_per_transfer) {
+        int rows = std::min(rows_per_transfer, rect.y_end - y + 1);
+        // Buffers are reused round robin, wait until the oldest transfer released its buffer
+        xSemaphoreTake(transfer_done_, portMAX_DELAY);
+        uint16_t* buffer = transfer_[next_transfer_];
+        next_transfer_ = (next_transfer_ + 1) % AAF_PLAYER_TRANSFER_BUFFERS;
+        for (int row = 0; row < rows; row++) {
+            memcpy(buffer + row * width, screen_ + (y + row) * width_ + rect.x_start, width * sizeof(uint16_t));
+        }
+        flush_(rect.x_start, y, rect.x_end + 1, y + rows, buffer);
+        task_statistics_.flushes++;
+        task_statistics_.bytes_flushed += width * rows * sizeof(uint16_t);
+    }
+}
+
+void AafPlayer::WaitTransfers() {
+    for (int i = 0; i < AAF_PLAYER_TRANSFER_BUFFERS; i++) {
+        xSemaphoreTake(transfer_done_, portMAX_DELAY);
+    }
+    for (int i = 0; i < AAF_PLAYER_TRANSFER_BUFFERS; i++) {
+        xSemaphoreGive(transfer_done_);
+    }
+}
+
+AafPlayer::CacheEntry* AafPlayer::FindCache(const void* source) {
+    for (auto& entry : cache_) {
+        if (entry.source == source) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+AafPlayer::CacheEntry* AafPlayer::EvictCache() {
+    auto oldest = std::min_element(cache_.begin(), cache_.end(),
+        [](const CacheEntry& a, const CacheEntry& b) { return a.last_used < b.last_used; });
+    return &*oldest;
+}
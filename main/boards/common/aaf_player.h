@@ -0,0 +1,164 @@
+#ifndef _AAF_PLAYER_H_
+#define _AAF_PLAYER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#define AAF_PLAYER_MERGE_SLACK_PIXELS 512   // Unchanged pixels worth resending to save one LCD transaction
+#define AAF_PLAYER_TRANSFER_BUFFERS 2       // One buffer is filled while the other is on the SPI bus
+
+/*
+ * One frame of an .aaf animation: an 8 bit palette image stored as bands of
+ * split_height rows, every band RLE compressed on its own.
+ */
+struct AafFrame {
+    int width = 0;
+    int height = 0;
+    int splits = 0;
+    int split_height = 0;
+    const uint8_t* palette = nullptr;           // 256 entries of B, G, R, A
+    const uint8_t* split_lengths = nullptr;     // u16 per band
+    const uint8_t* blocks = nullptr;
+};
+
+/*
+ * .aaf container, all fields little endian:
+ *   header: frame count (u32), checksum (u32), payload length (u32)
+ *   table:  frame count entries of size (u32), offset into the payload (u32)
+ *   frame:  "ZZ" "_S" 0 "V1.00" 0, bit depth (u8), width, height, splits, split height (u16),
+ *           split lengths (u16 each), palette, then per split an encoding byte and its data
+ * Frames are referenced in place, so the file can stay in the mapped assets partition.
+ */
+class AafAnimation {
+public:
+    bool Load(const void* data, size_t size);
+
+    int frame_count() const { return frame_count_; }
+    bool GetFrame(int index, AafFrame* frame) const;
+
+    // Expands one band into width * split_height palette indices
+    static bool DecodeBlock(const uint8_t* block, size_t length, uint8_t* indices, size_t count);
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    int frame_count_ = 0;
+};
+
+struct AafPlayerStatistics {
+    uint32_t frames = 0;            // Frames rendered
+    uint32_t dropped_frames = 0;    // Frames skipped to keep up with the nominal fps
+    uint32_t blocks_decoded = 0;
+    uint32_t blocks_skipped = 0;    // Bands identical to the previous frame, neither decoded nor sent
+    uint32_t flushes = 0;           // LCD transactions
+    uint64_t bytes_flushed = 0;
+    uint32_t cache_hits = 0;
+    uint32_t cache_misses = 0;
+    uint32_t bandwidth = 0;         // Achieved LCD throughput in bytes per second
+    uint32_t frame_interval_us = 0; // Current frame interval after adapting to the bandwidth
+};
+
+/*
+ * Plays .aaf animations on an LCD panel. Only the rectangles that changed
+ * since the previous frame are flushed, bands whose compressed data did not
+ * change are not even decoded. The first frame of hot animations is kept
+ * decoded in a small LRU so switching back to them starts without touching
+ * flash. When a frame takes longer than its slot the interval stretches and
+ * frames are dropped instead of slowing the animation down.
+ */
+class AafPlayer {
+public:
+    // flush() must queue the transfer and later call FlushReadyFromIsr() once it completed
+    using FlushCallback = std::function<void(int x_start, int y_start, int x_end, int y_end, const void* pixels)>;
+
+    AafPlayer(int width, int height, int max_transfer_pixels, int cache_entries, FlushCallback flush);
+    ~AafPlayer();
+
+    void Play(const void* data, size_t size, bool repeat, int fps, int start_frame = 0, bool hot = false);
+    void Stop();
+    bool FlushReadyFromIsr();
+    AafPlayerStatistics GetStatistics();
+
+private:
+    struct CacheEntry {
+        const void* source = nullptr;
+        uint32_t last_used = 0;
+        uint16_t palette[256];
+        uint8_t* indices = nullptr;
+    };
+
+    struct Rect {
+        int x_start, y_start, x_end, y_end;     // Inclusive
+    };
+
+    int width_;
+    int height_;
+    int max_transfer_pixels_;
+    FlushCallback flush_;
+    TaskHandle_t task_ = nullptr;
+    SemaphoreHandle_t transfer_done_ = nullptr;
+
+    // Commands from other tasks
+    std::mutex mutex_;
+    bool command_pending_ = false;
+    bool exit_ = false;
+    const void* next_data_ = nullptr;
+    size_t next_size_ = 0;
+    bool next_repeat_ = false;
+    int next_fps_ = 0;
+    int next_start_frame_ = 0;
+    bool next_hot_ = false;
+    AafPlayerStatistics statistics_;    // Published copy of task_statistics_
+
+    // Player task state
+    AafAnimation animation_;
+    bool playing_ = false;
+    bool repeat_ = false;
+    bool hot_ = false;
+    int start_frame_ = 0;
+    int64_t start_time_ = 0;
+    int64_t nominal_interval_us_ = 0;
+    int64_t interval_us_ = 0;
+    int64_t next_time_ = 0;
+    int64_t last_tick_ = -1;
+    int last_frame_ = -1;
+    AafPlayerStatistics task_statistics_;
+
+    uint16_t* screen_ = nullptr;                // What the panel shows, RGB565 byte swapped
+    bool screen_valid_ = false;
+    uint16_t palette_[256];
+    const uint8_t* palette_source_ = nullptr;
+    std::vector<const uint8_t*> shown_blocks_;  // Compressed bands of the frame on screen
+    std::vector<uint16_t> shown_lengths_;
+    std::vector<uint8_t> band_;
+    uint16_t* transfer_[AAF_PLAYER_TRANSFER_BUFFERS] = {};
+    int next_transfer_ = 0;
+    bool has_pending_ = false;
+    Rect pending_;
+
+    std::vector<CacheEntry> cache_;
+    uint32_t cache_clock_ = 0;
+
+    void PlayerTask();
+    void RenderNext();
+    bool RenderFrame(int index);
+    bool RenderCachedFrame(const CacheEntry& entry, const AafFrame& frame);
+    bool DecodeToCache(CacheEntry& entry, const AafFrame& frame);
+    bool UpdatePalette(const uint8_t* palette);
+    void CompareBand(const uint8_t* indices, const uint16_t* palette, int y, int rows);
+    void AddDirty(const Rect& rect);
+    void FlushPending();
+    void FlushRect(const Rect& rect);
+    void WaitTransfers();
+    CacheEntry* FindCache(const void* source);
+    CacheEntry* EvictCache();
+};
+
+#endif // _AAF_PLAYER_H_
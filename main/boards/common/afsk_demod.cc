@@ -1,4 +1,5 @@
 #include "afsk_demod.h"
+#include "mfsk_demod.h"
 #include <cstring>
 #include <algorithm>
 #include "esp_log.h"
@@ -8,6 +9,13 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+// Twiddle factors are Q14 with 256 steps per turn, products are scaled down so that
+// a full-scale window of up to 1024 samples still fits the 32-bit accumulators
+#define TWIDDLE_TABLE_BITS 8
+#define TWIDDLE_TABLE_SIZE (1 << TWIDDLE_TABLE_BITS)
+#define TWIDDLE_ONE 16384
+#define PRODUCT_SHIFT 10
+
 namespace audio_wifi_config
 {
     static const char *kLogTag = "AUDIO_WIFI_CONFIG";
@@ -18,11 +26,18 @@ namespace audio_wifi_config
                                         size_t input_channels
                                     )
     {
-        const int kInputSampleRate = 16000;                                    // Input sampling rate
-        const float kDownsampleStep = static_cast<float>(kInputSampleRate) / static_cast<float>(kAudioSampleRate); // Downsampling step
-        std::vector<int16_t> audio_data;
+        const size_t kInputSampleRate = 16000;                                 // Input sampling rate
+#if CONFIG_ACOUSTIC_WIFI_PROVISIONING_NATIVE_RATE
+        // Demodulate the microphone samples directly, the window keeps the same duration
+        AudioSignalProcessor signal_processor(kInputSampleRate, kMarkFrequency, kSpaceFrequency, kBitRate,
+                                              kWindowSize * kInputSampleRate / kAudioSampleRate);
+#else
         AudioSignalProcessor signal_processor(kAudioSampleRate, kMarkFrequency, kSpaceFrequency, kBitRate, kWindowSize);
+#endif
+        std::vector<int16_t> audio_data;
+        std::vector<float> probabilities;
         AudioDataBuffer data_buffer;
+        MfskDemodulator mfsk_demodulator;
 
         while (true)
         {
@@ -40,63 +55,68 @@ namespace audio_wifi_config
                 continue;
             }
 
-            if (input_channels == 2) { // If stereo input, convert to mono
-                auto mono_data = std::vector<int16_t>(audio_data.size() / 2);
-                for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                    mono_data[i] = audio_data[j];
+            // Convert to mono and downsample in place, the buffer is reused for the next read
+            size_t sample_count = audio_data.size() / input_channels;
+            if (input_channels == 2) { // If stereo input, keep the first channel
+                for (size_t i = 0; i < sample_count; ++i) {
+                    audio_data[i] = audio_data[i * 2];
                 }
-                audio_data = std::move(mono_data);
             }
-            
-            // Downsample the audio data
-            std::vector<float> downsampled_data;
-            size_t last_index = 0;
-
-            if (kDownsampleStep > 1.0f) {
-                downsampled_data.reserve(audio_data.size() / static_cast<size_t>(kDownsampleStep));
-                for (size_t i = 0; i < audio_data.size(); ++i) {
-                    size_t sample_index = static_cast<size_t>(i / kDownsampleStep);
+
+            // The v2 decoder works on the full 16kHz signal, so it runs before downsampling
+            std::optional<std::string> received_text;
+            if (mfsk_demodulator.ProcessAudioSamples(audio_data.data(), sample_count)) {
+                received_text = std::move(mfsk_demodulator.decoded_text);
+                mfsk_demodulator.decoded_text.reset();
+            }
+
+#if !CONFIG_ACOUSTIC_WIFI_PROVISIONING_NATIVE_RATE
+            if (kInputSampleRate > kAudioSampleRate) {
+                size_t output_count = 0;
+                size_t last_index = 0;
+                for (size_t i = 0; i < sample_count; ++i) {
+                    size_t sample_index = i * kAudioSampleRate / kInputSampleRate;
                     if ((sample_index + 1) > last_index) {
-                        downsampled_data.push_back(static_cast<float>(audio_data[i]));
+                        audio_data[output_count++] = audio_data[i];
                         last_index = sample_index + 1;
                     }
                 }
-            } else {
-                downsampled_data.reserve(audio_data.size());
-                for (int16_t sample : audio_data) {
-                    downsampled_data.push_back(static_cast<float>(sample));
-                }
+                sample_count = output_count;
             }
-            
+#endif
+
             // Process audio samples to get probability data
-            auto probabilities = signal_processor.ProcessAudioSamples(downsampled_data);
+            probabilities.clear();
+            signal_processor.ProcessAudioSamples(audio_data.data(), sample_count, probabilities);
             
             // Feed probability data to the data buffer
-            if (data_buffer.ProcessProbabilityData(probabilities, 0.5f)) {
-                // If complete data was received, extract WiFi credentials
-                if (data_buffer.decoded_text.has_value()) {
-                    ESP_LOGI(kLogTag, "Received text data: %s", data_buffer.decoded_text->c_str());
-                    display->SetChatMessage("system", data_buffer.decoded_text->c_str());
-                    
-                    // Split SSID and password by newline character
-                    std::string wifi_ssid, wifi_password;
-                    size_t newline_position = data_buffer.decoded_text->find('\n');
-                    if (newline_position != std::string::npos) {
-                        wifi_ssid = data_buffer.decoded_text->substr(0, newline_position);
-                        wifi_password = data_buffer.decoded_text->substr(newline_position + 1);
-                        ESP_LOGI(kLogTag, "WiFi SSID: %s, Password: %s", wifi_ssid.c_str(), wifi_password.c_str());
-                    } else {
-                        ESP_LOGE(kLogTag, "Invalid data format, no newline character found");
-                        continue;
-                    }
-                    
-                    if (wifi_ap->ConnectToWifi(wifi_ssid, wifi_password)) {
-                        wifi_ap->Save(wifi_ssid, wifi_password);  // Save WiFi credentials
-                        esp_restart();                            // Restart device to apply new WiFi configuration
-                    } else {
-                        ESP_LOGE(kLogTag, "Failed to connect to WiFi with received credentials");
-                    }
-                    data_buffer.decoded_text.reset();  // Clear processed data
+            if (data_buffer.ProcessProbabilityData(probabilities, 0.5f) && data_buffer.decoded_text.has_value()) {
+                received_text = std::move(data_buffer.decoded_text);
+                data_buffer.decoded_text.reset();  // Clear processed data
+            }
+
+            // If complete data was received by either decoder, extract WiFi credentials
+            if (received_text.has_value()) {
+                ESP_LOGI(kLogTag, "Received text data: %s", received_text->c_str());
+                display->SetChatMessage("system", received_text->c_str());
+                
+                // Split SSID and password by newline character
+                std::string wifi_ssid, wifi_password;
+                size_t newline_position = received_text->find('\n');
+                if (newline_position != std::string::npos) {
+                    wifi_ssid = received_text->substr(0, newline_position);
+                    wifi_password = received_text->substr(newline_position + 1);
+                    ESP_LOGI(kLogTag, "WiFi SSID: %s, Password: %s", wifi_ssid.c_str(), wifi_password.c_str());
+                } else {
+                    ESP_LOGE(kLogTag, "Invalid data format, no newline character found");
+                    continue;
+                }
+                
+                if (wifi_ap->ConnectToWifi(wifi_ssid, wifi_password)) {
+                    wifi_ap->Save(wifi_ssid, wifi_password);  // Save WiFi credentials
+                    esp_restart();                            // Restart device to apply new WiFi configuration
+                } else {
+                    ESP_LOGE(kLogTag, "Failed to connect to WiFi with received credentials");
                 }
             }
             vTaskDelay(pdMS_TO_TICKS(1));  // 1ms delay
@@ -112,110 +132,106 @@ namespace audio_wifi_config
     const std::vector<uint8_t> kDefaultEndTransmissionPattern = {
         0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 1, 0, 0};
 
+    // Shared cosine table, the sine is read a quarter turn earlier
+    static const int16_t *GetTwiddleTable() {
+        static int16_t table[TWIDDLE_TABLE_SIZE];
+        static bool initialized = false;
+        if (!initialized) {
+            for (int i = 0; i < TWIDDLE_TABLE_SIZE; ++i) {
+                table[i] = static_cast<int16_t>(std::lround(TWIDDLE_ONE * std::cos(2.0 * M_PI * i / TWIDDLE_TABLE_SIZE)));
+            }
+            initialized = true;
+        }
+        return table;
+    }
+
     // FrequencyDetector implementation
     FrequencyDetector::FrequencyDetector(float frequency, size_t window_size)
-        : frequency_(frequency), window_size_(window_size) {
-        frequency_bin_ = std::floor(frequency_ * static_cast<float>(window_size_));
-        angular_frequency_ = 2.0f * M_PI * frequency_;
-        cos_coefficient_ = std::cos(angular_frequency_);
-        sin_coefficient_ = std::sin(angular_frequency_);
-        filter_coefficient_ = 2.0f * cos_coefficient_;
-
-        // Initialize state buffer
-        state_buffer_.push_back(0.0f);
-        state_buffer_.push_back(0.0f);
+        : window_size_(window_size) {
+        phase_step_ = static_cast<uint32_t>(std::llround(static_cast<double>(frequency) * 4294967296.0));
+        window_phase_ = phase_step_ * static_cast<uint32_t>(window_size_);
+        GetTwiddleTable();
+        Reset();
     }
 
     void FrequencyDetector::Reset() {
-        state_buffer_.clear();
-        state_buffer_.push_back(0.0f);
-        state_buffer_.push_back(0.0f);
+        phase_ = 0;
+        real_accumulator_ = 0;
+        imaginary_accumulator_ = 0;
     }
 
-    void FrequencyDetector::ProcessSample(float sample) {
-        if (state_buffer_.size() < 2) {
-            return;
-        }
-
-        float s_minus_2 = state_buffer_.front();  // S[-2]
-        state_buffer_.pop_front();
-        float s_minus_1 = state_buffer_.front();  // S[-1]
-        state_buffer_.pop_front();
-
-        float s_current = sample + filter_coefficient_ * s_minus_1 - s_minus_2;
-
-        state_buffer_.push_back(s_minus_1);  // Put S[-1] back
-        state_buffer_.push_back(s_current);  // Add new S[0]
+    void FrequencyDetector::ProcessSample(int16_t sample, int16_t outgoing) {
+        static const int16_t *table = GetTwiddleTable();
+        const uint32_t quarter = TWIDDLE_TABLE_SIZE / 4;
+        const uint32_t mask = TWIDDLE_TABLE_SIZE - 1;
+
+        // The outgoing sample entered exactly one window ago, so subtracting the product it
+        // added back then is exact and the fixed point accumulators never drift
+        uint32_t in_index = phase_ >> (32 - TWIDDLE_TABLE_BITS);
+        uint32_t out_index = (phase_ - window_phase_) >> (32 - TWIDDLE_TABLE_BITS);
+        real_accumulator_ += ((sample * table[in_index]) >> PRODUCT_SHIFT) -
+                             ((outgoing * table[out_index]) >> PRODUCT_SHIFT);
+        imaginary_accumulator_ += ((sample * table[(in_index - quarter) & mask]) >> PRODUCT_SHIFT) -
+                                  ((outgoing * table[(out_index - quarter) & mask]) >> PRODUCT_SHIFT);
+        phase_ += phase_step_;
     }
 
     float FrequencyDetector::GetAmplitude() const {
-        if (state_buffer_.size() < 2) {
-            return 0.0f;
-        }
+        float real_part = static_cast<float>(real_accumulator_);
+        float imaginary_part = static_cast<float>(imaginary_accumulator_);
+        const float scale = static_cast<float>(TWIDDLE_ONE >> PRODUCT_SHIFT);
 
-        float s_minus_1 = state_buffer_[1];                      // S[-1]
-        float s_minus_2 = state_buffer_[0];                      // S[-2]
-        float real_part = cos_coefficient_ * s_minus_1 - s_minus_2;  // Real part
-        float imaginary_part = sin_coefficient_ * s_minus_1;         // Imaginary part
-
-        return std::sqrt(real_part * real_part + imaginary_part * imaginary_part) / 
+        return std::sqrt(real_part * real_part + imaginary_part * imaginary_part) / scale /
                (static_cast<float>(window_size_) / 2.0f);
     }
 
+    int64_t FrequencyDetector::GetPower() const {
+        return static_cast<int64_t>(real_accumulator_) * real_accumulator_ +
+               static_cast<int64_t>(imaginary_accumulator_) * imaginary_accumulator_;
+    }
+
     // AudioSignalProcessor implementation
     AudioSignalProcessor::AudioSignalProcessor(size_t sample_rate, size_t mark_frequency, size_t space_frequency,
                                              size_t bit_rate, size_t window_size)
-        : input_buffer_size_(window_size), output_sample_count_(0) {
+        : window_(window_size, 0), window_position_(0), window_fill_(0), output_sample_count_(0),
+          mark_detector_(static_cast<float>(mark_frequency) / static_cast<float>(sample_rate), window_size),
+          space_detector_(static_cast<float>(space_frequency) / static_cast<float>(sample_rate), window_size) {
         if (sample_rate % bit_rate != 0) {
             // On ESP32 we can continue execution, but log the error
             ESP_LOGW(kLogTag, "Sample rate %zu is not divisible by bit rate %zu", sample_rate, bit_rate);
         }
 
-        float normalized_mark_freq = static_cast<float>(mark_frequency) / static_cast<float>(sample_rate);
-        float normalized_space_freq = static_cast<float>(space_frequency) / static_cast<float>(sample_rate);
-
-        mark_detector_ = std::make_unique<FrequencyDetector>(normalized_mark_freq, window_size);
-        space_detector_ = std::make_unique<FrequencyDetector>(normalized_space_freq, window_size);
-
         samples_per_bit_ = sample_rate / bit_rate;  // Number of samples per bit
     }
 
-    std::vector<float> AudioSignalProcessor::ProcessAudioSamples(const std::vector<float> &samples) {
-        std::vector<float> result;
-
-        for (float sample : samples) {
-            if (input_buffer_.size() < input_buffer_size_) {
-                input_buffer_.push_back(sample);  // Just add, don't process yet
-            } else {
-                // Input buffer is full, process the data
-                input_buffer_.pop_front();   // Remove oldest sample
-                input_buffer_.push_back(sample);  // Add new sample
-                output_sample_count_++;
-
-                if (output_sample_count_ >= samples_per_bit_) {
-                    // Process all samples in the window using Goertzel algorithm
-                    for (float window_sample : input_buffer_) {
-                        mark_detector_->ProcessSample(window_sample);
-                        space_detector_->ProcessSample(window_sample);
-                    }
+    void AudioSignalProcessor::ProcessAudioSamples(const int16_t *samples, size_t count, std::vector<float> &probabilities) {
+        for (size_t i = 0; i < count; ++i) {
+            int16_t sample = samples[i];
+            int16_t outgoing = window_[window_position_];
+            window_[window_position_] = sample;
+            if (++window_position_ == window_.size()) {
+                window_position_ = 0;
+            }
+            mark_detector_.ProcessSample(sample, outgoing);
+            space_detector_.ProcessSample(sample, outgoing);
 
-                    float mark_amplitude = mark_detector_->GetAmplitude();   // Mark amplitude
-                    float space_amplitude = space_detector_->GetAmplitude(); // Space amplitude
+            if (window_fill_ < window_.size()) {
+                window_fill_++;  // Window not full yet, don't output
+                continue;
+            }
 
-                    // Avoid division by zero
-                    float mark_probability = mark_amplitude / 
-                                           (space_amplitude + mark_amplitude + std::numeric_limits<float>::epsilon());
-                    result.push_back(mark_probability);
+            output_sample_count_++;
+            if (output_sample_count_ >= samples_per_bit_) {
+                float mark_amplitude = mark_detector_.GetAmplitude();   // Mark amplitude
+                float space_amplitude = space_detector_.GetAmplitude(); // Space amplitude
 
-                    // Reset detector windows
-                    mark_detector_->Reset();
-                    space_detector_->Reset();
-                    output_sample_count_ = 0;  // Reset output counter
-                }
+                // Avoid division by zero
+                float mark_probability = mark_amplitude / 
+                                       (space_amplitude + mark_amplitude + std::numeric_limits<float>::epsilon());
+                probabilities.push_back(mark_probability);
+                output_sample_count_ = 0;  // Reset output counter
             }
         }
-
-        return result;
     }
 
     // AudioDataBuffer implementation
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <deque>
 #include <string>
@@ -23,20 +24,19 @@ namespace audio_wifi_config
                                          size_t input_channels = 1);
 
     /**
-     * Goertzel algorithm implementation for single frequency detection
-     * Used to detect specific audio frequencies in the AFSK demodulation process
+     * Sliding DFT for single frequency detection
+     * Tracks the spectrum of the last window_size samples in fixed point, each sample costs
+     * two table lookups and four multiplies no matter how often the amplitude is read
      */
     class FrequencyDetector
     {
     private:
-        float frequency_;              // Target frequency (normalized, i.e., f / fs)
         size_t window_size_;           // Window size for analysis
-        float frequency_bin_;          // Frequency bin
-        float angular_frequency_;      // Angular frequency
-        float cos_coefficient_;        // cos(w)
-        float sin_coefficient_;        // sin(w)
-        float filter_coefficient_;     // 2 * cos(w)
-        std::deque<float> state_buffer_;  // Circular buffer for storing S[-1] and S[-2]
+        uint32_t phase_step_;          // Phase increment per sample, 2^32 is one full turn
+        uint32_t window_phase_;        // Phase advance over one window
+        uint32_t phase_;               // Phase of the next incoming sample
+        int32_t real_accumulator_;     // Real part of the windowed DFT bin
+        int32_t imaginary_accumulator_; // Imaginary part of the windowed DFT bin
 
     public:
         /**
@@ -52,16 +52,23 @@ namespace audio_wifi_config
         void Reset();
 
         /**
-         * Process one audio sample
-         * @param sample Input audio sample
+         * Slide the window by one sample
+         * @param sample Sample entering the window
+         * @param outgoing Sample leaving the window (0 while the window is filling)
          */
-        void ProcessSample(float sample);
+        void ProcessSample(int16_t sample, int16_t outgoing);
 
         /**
          * Calculate current amplitude
          * @return Amplitude value
          */
         float GetAmplitude() const;
+
+        /**
+         * Calculate current power in accumulator units
+         * @return Squared magnitude, cheaper than GetAmplitude when only comparing detectors
+         */
+        int64_t GetPower() const;
     };
 
     /**
@@ -71,12 +78,13 @@ namespace audio_wifi_config
     class AudioSignalProcessor
     {
     private:
-        std::deque<float> input_buffer_;             // Input sample buffer
-        size_t input_buffer_size_;                   // Input buffer size = window size
+        std::vector<int16_t> window_;                // Ring buffer of the last window_size samples
+        size_t window_position_;                     // Next slot to overwrite in the ring buffer
+        size_t window_fill_;                         // Samples received until the window is full
         size_t output_sample_count_;                 // Output sample counter
         size_t samples_per_bit_;                     // Samples per bit threshold
-        std::unique_ptr<FrequencyDetector> mark_detector_;   // Mark frequency detector
-        std::unique_ptr<FrequencyDetector> space_detector_;  // Space frequency detector
+        FrequencyDetector mark_detector_;            // Mark frequency detector
+        FrequencyDetector space_detector_;           // Space frequency detector
 
     public:
         /**
@@ -92,10 +100,11 @@ namespace audio_wifi_config
 
         /**
          * Process input audio samples
-         * @param samples Input audio sample vector
-         * @return Vector of Mark probability values (0.0 to 1.0)
+         * @param samples Input audio samples
+         * @param count Number of samples
+         * @param probabilities Receives one Mark probability (0.0 to 1.0) per completed bit
          */
-        std::vector<float> ProcessAudioSamples(const std::vector<float> &samples);
+        void ProcessAudioSamples(const int16_t *samples, size_t count, std::vector<float> &probabilities);
     };
 
     /**
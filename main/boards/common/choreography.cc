@@ -0,0 +1,240 @@
+#include "choreography.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+#include <cstring>
+
+#define TAG "Choreography"
+
+#define CHOREOGRAPHY_TICK_MS 20
+#define CHOREOGRAPHY_STALL_TIMEOUT_MS 10000  // Give up when the clock stops, e.g. speech never started
+#define CHOREOGRAPHY_ENTRY_RAMP_MS 300       // The clock may start mid-choreography, ramp into it instead of jumping
+
+static uint16_t ReadU16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static int CountChannels(uint8_t mask) {
+    return __builtin_popcount(mask & ~CHOREOGRAPHY_MASK_STEP);
+}
+
+bool Choreography::Load(const uint8_t* data, size_t size) {
+    data_ = nullptr;
+    if (size < CHOREOGRAPHY_HEADER_SIZE || memcmp(data, "CHR1", 4) != 0) {
+        ESP_LOGE(TAG, "Invalid choreography header");
+        return false;
+    }
+    int channels = data[4];
+    if (channels < 1 || channels > CHOREOGRAPHY_MAX_CHANNELS) {
+        ESP_LOGE(TAG, "Unsupported channel count: %d", channels);
+        return false;
+    }
+
+    // Validate the whole stream once so playback never reads past the end
+    uint16_t count = ReadU16(data + 6);
+    uint32_t duration = 0;
+    size_t offset = CHOREOGRAPHY_HEADER_SIZE;
+    for (int i = 0; i < count; i++) {
+        if (offset + 3 > size) {
+            ESP_LOGE(TAG, "Keyframe %d is truncated", i);
+            return false;
+        }
+        uint8_t mask = data[offset + 2];
+        if ((mask & ~CHOREOGRAPHY_MASK_STEP) >> channels) {
+            ESP_LOGE(TAG, "Keyframe %d uses channels beyond %d", i, channels);
+            return false;
+        }
+        duration += ReadU16(data + offset);
+        offset += 3 + CountChannels(mask);
+    }
+    if (offset > size) {
+        ESP_LOGE(TAG, "Choreography is truncated");
+        return false;
+    }
+
+    data_ = data;
+    size_ = size;
+    channels_ = channels;
+    flags_ = data[5];
+    count_ = count;
+    duration_ = duration;
+    return true;
+}
+
+void Choreography::Rewind(const int* pose) {
+    offset_ = CHOREOGRAPHY_HEADER_SIZE;
+    index_ = 0;
+    loop_start_ = 0;
+    next_time_ = 0;
+    for (int i = 0; i < channels_; i++) {
+        next_[i] = pose[i];
+    }
+    Advance();
+}
+
+bool Choreography::Advance() {
+    previous_time_ = next_time_;
+    memcpy(previous_, next_, sizeof(previous_));
+    next_step_ = false;
+    if (data_ == nullptr || index_ >= count_) {
+        return false;
+    }
+
+    const uint8_t* keyframe = data_ + offset_;
+    uint8_t mask = keyframe[2];
+    next_time_ += ReadU16(keyframe);
+    next_step_ = (mask & CHOREOGRAPHY_MASK_STEP) != 0;
+    const uint8_t* value = keyframe + 3;
+    for (int i = 0; i < channels_; i++) {
+        if (mask & (1 << i)) {
+            next_[i] = *value++;
+        }
+    }
+    offset_ = value - data_;
+    index_++;
+    return true;
+}
+
+bool Choreography::Evaluate(uint32_t time_ms, int* values) {
+    uint32_t time = time_ms - loop_start_;
+    while (time >= next_time_) {
+        if (Advance()) {
+            continue;
+        }
+        if (!loops() || duration_ == 0) {
+            memcpy(values, next_, channels_ * sizeof(int));
+            return false;
+        }
+        // Wrap around, the first keyframe ramps from the final pose
+        loop_start_ += duration_;
+        time -= duration_;
+        offset_ = CHOREOGRAPHY_HEADER_SIZE;
+        index_ = 0;
+        next_time_ = 0;
+        Advance();
+    }
+
+    uint32_t span = next_time_ - previous_time_;
+    for (int i = 0; i < channels_; i++) {
+        if (next_step_ || span == 0) {
+            values[i] = previous_[i];
+        } else {
+            values[i] = previous_[i] + (next_[i] - previous_[i]) * (int)(time - previous_time_) / (int)span;
+        }
+    }
+    return true;
+}
+
+ChoreographyPlayer::ChoreographyPlayer(int channels, std::function<void(const int* values)> output)
+    : channels_(std::min(channels, CHOREOGRAPHY_MAX_CHANNELS)), output_(output) {
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            auto self = static_cast<ChoreographyPlayer*>(arg);
+            self->OnTick();
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "choreography",
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer_));
+}
+
+ChoreographyPlayer::~ChoreographyPlayer() {
+    esp_timer_stop(timer_);
+    esp_timer_delete(timer_);
+}
+
+bool ChoreographyPlayer::Play(std::vector<uint8_t>&& data, const int* start_pose, std::function<uint32_t()> clock) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (playing_) {
+        esp_timer_stop(timer_);
+        playing_ = false;
+    }
+    data_ = std::move(data);
+    if (!choreography_.Load(data_.data(), data_.size())) {
+        return false;
+    }
+    if (choreography_.channels() > channels_) {
+        ESP_LOGE(TAG, "Choreography has %d channels, only %d available", choreography_.channels(), channels_);
+        return false;
+    }
+
+    // Channels the choreography does not drive stay where they are
+    for (int i = 0; i < CHOREOGRAPHY_MAX_CHANNELS; i++) {
+        applied_pose_[i] = i < channels_ ? start_pose[i] : 0;
+    }
+    memcpy(pose_, applied_pose_, sizeof(pose_));
+    choreography_.Rewind(applied_pose_);
+    clock_ = clock;
+    clock_started_ = false;
+    last_clock_ = clock_();
+    last_progress_time_ = esp_timer_get_time();
+    playing_ = true;
+    ESP_ERROR_CHECK(esp_timer_start_periodic(timer_, CHOREOGRAPHY_TICK_MS * 1000));
+    ESP_LOGI(TAG, "Playing %u ms over %d channels%s", (unsigned)choreography_.duration(),
+        choreography_.channels(), choreography_.loops() ? ", looping" : "");
+    return true;
+}
+
+void ChoreographyPlayer::Stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (playing_) {
+        esp_timer_stop(timer_);
+        playing_ = false;
+    }
+}
+
+bool ChoreographyPlayer::IsPlaying() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return playing_;
+}
+
+void ChoreographyPlayer::OnTick() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!playing_) {
+        return;
+    }
+
+    uint32_t time = clock_();
+    int64_t now = esp_timer_get_time();
+    bool moved = time != last_clock_;
+    if (moved) {
+        if (time < last_clock_) {
+            // The clock restarted, e.g. a new sentence reset the playback position
+            choreography_.Rewind(applied_pose_);
+        }
+        last_clock_ = time;
+        last_progress_time_ = now;
+    } else if (now - last_progress_time_ > CHOREOGRAPHY_STALL_TIMEOUT_MS * 1000LL) {
+        ESP_LOGW(TAG, "Clock stalled at %u ms, stopping", (unsigned)time);
+        esp_timer_stop(timer_);
+        playing_ = false;
+        return;
+    }
+
+    // The first reading may be stale from the previous sentence, hold the start pose until the clock runs
+    if (!clock_started_) {
+        if (!moved) {
+            return;
+        }
+        clock_started_ = true;
+        memcpy(ramp_from_, applied_pose_, sizeof(ramp_from_));
+        ramp_start_time_ = now;
+    }
+
+    bool more = choreography_.Evaluate(time, pose_);
+    int64_t ramp_elapsed_ms = (now - ramp_start_time_) / 1000;
+    bool ramping = ramp_elapsed_ms < CHOREOGRAPHY_ENTRY_RAMP_MS;
+    for (int i = 0; i < channels_; i++) {
+        applied_pose_[i] = ramping ? ramp_from_[i] + (pose_[i] - ramp_from_[i]) * (int)ramp_elapsed_ms / CHOREOGRAPHY_ENTRY_RAMP_MS
+                                   : pose_[i];
+    }
+    output_(applied_pose_);
+    if (!more && !ramping) {
+        esp_timer_stop(timer_);
+        playing_ = false;
+        ESP_LOGI(TAG, "Finished at %u ms", (unsigned)time);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef _CHOREOGRAPHY_H_
+#define _CHOREOGRAPHY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <esp_timer.h>
+
+#define CHOREOGRAPHY_MAX_CHANNELS 7
+#define CHOREOGRAPHY_HEADER_SIZE 8
+#define CHOREOGRAPHY_FLAG_LOOP 0x01
+#define CHOREOGRAPHY_MASK_STEP 0x80     // Values jump at the keyframe instead of ramping to it
+
+/*
+ * Compact servo / motor choreography, all fields little endian:
+ *   header:   "CHR1", channel count, flags, keyframe count (u16)
+ *   keyframe: delay since the previous keyframe in ms (u16), channel mask (u8),
+ *             one value byte per channel set in the mask
+ * Channels missing from a keyframe keep their value. Values are board defined,
+ * servo angles in degrees for the robots. Evaluate() walks the stream with a
+ * cursor and never copies it, so the data can live in a mapped partition.
+ */
+class Choreography {
+public:
+    bool Load(const uint8_t* data, size_t size);
+
+    int channels() const { return channels_; }
+    bool loops() const { return (flags_ & CHOREOGRAPHY_FLAG_LOOP) != 0; }
+    uint32_t duration() const { return duration_; }
+
+    // Restart from the given pose, the first keyframe ramps from it
+    void Rewind(const int* pose);
+    // Time must not go backwards between calls, returns false once a non-looping stream ended
+    bool Evaluate(uint32_t time_ms, int* values);
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    int channels_ = 0;
+    uint8_t flags_ = 0;
+    uint16_t count_ = 0;
+    uint32_t duration_ = 0;
+
+    // Cursor between the keyframe behind and the keyframe ahead of the current time
+    size_t offset_ = 0;
+    uint16_t index_ = 0;
+    uint32_t loop_start_ = 0;
+    uint32_t previous_time_ = 0;
+    uint32_t next_time_ = 0;
+    bool next_step_ = false;
+    int previous_[CHOREOGRAPHY_MAX_CHANNELS] = {};
+    int next_[CHOREOGRAPHY_MAX_CHANNELS] = {};
+
+    bool Advance();
+};
+
+/*
+ * Plays a choreography from one periodic timer. The clock decides where in the
+ * choreography we are, so following the speaker playback position keeps moves
+ * on the words even when the audio stalls or starts late.
+ */
+class ChoreographyPlayer {
+public:
+    ChoreographyPlayer(int channels, std::function<void(const int* values)> output);
+    ~ChoreographyPlayer();
+
+    bool Play(std::vector<uint8_t>&& data, const int* start_pose, std::function<uint32_t()> clock);
+    void Stop();
+    bool IsPlaying();
+
+private:
+    int channels_;
+    std::function<void(const int* values)> output_;
+    std::function<uint32_t()> clock_;
+    esp_timer_handle_t timer_ = nullptr;
+    std::mutex mutex_;
+    std::vector<uint8_t> data_;
+    Choreography choreography_;
+    bool playing_ = false;
+    bool clock_started_ = false;
+    int pose_[CHOREOGRAPHY_MAX_CHANNELS] = {};          // Evaluated from the choreography
+    int applied_pose_[CHOREOGRAPHY_MAX_CHANNELS] = {};  // Last pose sent to the output
+    int ramp_from_[CHOREOGRAPHY_MAX_CHANNELS] = {};
+    int64_t ramp_start_time_ = 0;
+    uint32_t last_clock_ = 0;
+    int64_t last_progress_time_ = 0;
+
+    void OnTick();
+};
+
+#endif // _CHOREOGRAPHY_H_
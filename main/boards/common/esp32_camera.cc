@@ -6,12 +6,61 @@
 
 #include <esp_log.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
 #include <img_converters.h>
 #include <cstring>
+#include <algorithm>
 
 #define TAG "Esp32Camera"
 
-Esp32Camera::Esp32Camera(const camera_config_t& config) {
+// One frame being filled plus the image bubbles that may still be on screen
+#define PREVIEW_RING_SIZE 3
+
+// Upload chunks span a couple of TCP segments so every http->Write fills whole packets
+#ifdef CONFIG_LWIP_TCP_MSS
+#define JPEG_TCP_MSS CONFIG_LWIP_TCP_MSS
+#else
+#define JPEG_TCP_MSS 1440
+#endif
+#define JPEG_CHUNK_SIZE ((size_t)JPEG_TCP_MSS * 4)
+#define JPEG_CHUNK_QUEUE_LENGTH 16
+
+// Quality is adapted so that one image stays within the upload budget
+#define JPEG_UPLOAD_BUDGET_BYTES (48 * 1024)
+#define JPEG_MAX_QUALITY 80
+#define JPEG_MIN_QUALITY 40
+#define JPEG_QUALITY_STEP 10
+// Frames larger than VGA are halved before encoding
+#define JPEG_MAX_PIXELS (640 * 480)
+
+// Copies RGB565 pixels while swapping the bytes of each pixel, two pixels per 32-bit word
+static void CopySwapRgb565(const uint8_t* src, uint8_t* dst, size_t len) {
+    size_t i = 0;
+    if ((((uintptr_t)src | (uintptr_t)dst) & 3) == 0) {
+        auto src32 = reinterpret_cast<const uint32_t*>(src);
+        auto dst32 = reinterpret_cast<uint32_t*>(dst);
+        size_t words = len / 4;
+        size_t w = 0;
+        for (; w + 4 <= words; w += 4) {
+            uint32_t a = src32[w], b = src32[w + 1], c = src32[w + 2], d = src32[w + 3];
+            dst32[w] = ((a & 0xFF00FF00) >> 8) | ((a & 0x00FF00FF) << 8);
+            dst32[w + 1] = ((b & 0xFF00FF00) >> 8) | ((b & 0x00FF00FF) << 8);
+            dst32[w + 2] = ((c & 0xFF00FF00) >> 8) | ((c & 0x00FF00FF) << 8);
+            dst32[w + 3] = ((d & 0xFF00FF00) >> 8) | ((d & 0x00FF00FF) << 8);
+        }
+        for (; w < words; w++) {
+            uint32_t a = src32[w];
+            dst32[w] = ((a & 0xFF00FF00) >> 8) | ((a & 0x00FF00FF) << 8);
+        }
+        i = words * 4;
+    }
+    for (; i + 1 < len; i += 2) {
+        dst[i] = src[i + 1];
+        dst[i + 1] = src[i];
+    }
+}
+
+Esp32Camera::Esp32Camera(const camera_config_t& config) : jpeg_quality_(JPEG_MAX_QUALITY) {
     // camera init
     esp_err_t err = esp_camera_init(&config); // Configure parameters defined above
     if (err != ESP_OK) {
@@ -24,47 +73,41 @@ Esp32Camera::Esp32Camera(const camera_config_t& config) {
         s->set_hmirror(s, 0);  // Control camera mirror: 1 for mirror, 0 for no mirror
     }
 
-    // Initialize preview image memory
-    memset(&preview_image_, 0, sizeof(preview_image_));
-    preview_image_.header.magic = LV_IMAGE_HEADER_MAGIC;
-    preview_image_.header.cf = LV_COLOR_FORMAT_RGB565;
-    preview_image_.header.flags = LV_IMAGE_FLAGS_ALLOCATED | LV_IMAGE_FLAGS_MODIFIABLE;
+    // Initialize preview image header, frames are allocated on the first capture
+    memset(&preview_header_, 0, sizeof(preview_header_));
+    preview_header_.magic = LV_IMAGE_HEADER_MAGIC;
+    preview_header_.cf = LV_COLOR_FORMAT_RGB565;
+    preview_header_.flags = LV_IMAGE_FLAGS_ALLOCATED | LV_IMAGE_FLAGS_MODIFIABLE;
 
     switch (config.frame_size) {
         case FRAMESIZE_SVGA:
-            preview_image_.header.w = 800;
-            preview_image_.header.h = 600;
+            preview_header_.w = 800;
+            preview_header_.h = 600;
             break;
         case FRAMESIZE_VGA:
-            preview_image_.header.w = 640;
-            preview_image_.header.h = 480;
+            preview_header_.w = 640;
+            preview_header_.h = 480;
             break;
         case FRAMESIZE_QVGA:
-            preview_image_.header.w = 320;
-            preview_image_.header.h = 240;
+            preview_header_.w = 320;
+            preview_header_.h = 240;
             break;
         case FRAMESIZE_128X128:
-            preview_image_.header.w = 128;
-            preview_image_.header.h = 128;
+            preview_header_.w = 128;
+            preview_header_.h = 128;
             break;
         case FRAMESIZE_240X240:
-            preview_image_.header.w = 240;
-            preview_image_.header.h = 240;
+            preview_header_.w = 240;
+            preview_header_.h = 240;
             break;
         default:
             ESP_LOGE(TAG, "Unsupported frame size: %d, image preview will not be shown", config.frame_size);
-            preview_image_.data_size = 0;
-            preview_image_.data = nullptr;
+            preview_data_size_ = 0;
             return;
     }
 
-    preview_image_.header.stride = preview_image_.header.w * 2;
-    preview_image_.data_size = preview_image_.header.w * preview_image_.header.h * 2;
-    preview_image_.data = (uint8_t*)heap_caps_malloc(preview_image_.data_size, MALLOC_CAP_SPIRAM);
-    if (preview_image_.data == nullptr) {
-        ESP_LOGE(TAG, "Failed to allocate memory for preview image");
-        return;
-    }
+    preview_header_.stride = preview_header_.w * 2;
+    preview_data_size_ = preview_header_.w * preview_header_.h * 2;
 }
 
 Esp32Camera::~Esp32Camera() {
@@ -72,13 +115,44 @@ Esp32Camera::~Esp32Camera() {
         esp_camera_fb_return(fb_);
         fb_ = nullptr;
     }
-    if (preview_image_.data) {
-        heap_caps_free((void*)preview_image_.data);
-        preview_image_.data = nullptr;
+    // Frames still shown by the display are released together with their widgets
+    preview_ring_.clear();
+    for (auto& chunk : jpeg_chunks_) {
+        heap_caps_free(chunk.data);
     }
     esp_camera_deinit();
 }
 
+std::shared_ptr<lv_img_dsc_t> Esp32Camera::AcquirePreviewFrame() {
+    for (auto& frame : preview_ring_) {
+        if (frame.use_count() == 1) {
+            return frame;
+        }
+    }
+    if (preview_ring_.size() >= PREVIEW_RING_SIZE) {
+        // Frames come back once the chat image bubbles holding them are pruned
+        preview_skipped_++;
+        ESP_LOGW(TAG, "All %d preview frames are still in use, previews skipped: %lu",
+            PREVIEW_RING_SIZE, (unsigned long)preview_skipped_);
+        return nullptr;
+    }
+
+    auto data = (uint8_t*)heap_caps_malloc(preview_data_size_, MALLOC_CAP_SPIRAM);
+    if (data == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate memory for preview image");
+        return nullptr;
+    }
+    auto frame = std::shared_ptr<lv_img_dsc_t>(new lv_img_dsc_t(), [](lv_img_dsc_t* image) {
+        heap_caps_free((void*)image->data);
+        delete image;
+    });
+    frame->header = preview_header_;
+    frame->data_size = preview_data_size_;
+    frame->data = data;
+    preview_ring_.push_back(frame);
+    return frame;
+}
+
 void Esp32Camera::SetExplainUrl(const std::string& url, const std::string& token) {
     explain_url_ = url;
     explain_token_ = token;
@@ -88,6 +162,7 @@ bool Esp32Camera::Capture() {
     if (encoder_thread_.joinable()) {
         encoder_thread_.join();
     }
+    jpeg_cache_valid_ = false;
 
     int frames_to_get = 2;
     // Try to get a stable frame
@@ -104,28 +179,24 @@ bool Esp32Camera::Capture() {
 
     // If preview image buffer is empty, skip preview
     // But still return true as the image can be uploaded to server
-    if (preview_image_.data_size == 0) {
+    if (preview_data_size_ == 0) {
         ESP_LOGW(TAG, "Skip preview because of unsupported frame size");
         return true;
     }
-    if (preview_image_.data == nullptr) {
-        ESP_LOGE(TAG, "Preview image data is not initialized");
-        return true;
-    }
     // Display preview image
     auto display = Board::GetInstance().GetDisplay();
     if (display != nullptr) {
-        auto src = (uint16_t*)fb_->buf;
-        auto dst = (uint16_t*)preview_image_.data;
-        size_t pixel_count = fb_->len / 2;
-        for (size_t i = 0; i < pixel_count; i++) {
-            // Swap bytes within each 16-bit word
-            dst[i] = __builtin_bswap16(src[i]);
+        auto frame = AcquirePreviewFrame();
+        if (frame == nullptr) {
+            // The capture itself succeeded, Explain still works without the preview
+            return true;
         }
-        display->SetPreviewImage(&preview_image_);
+        CopySwapRgb565(fb_->buf, (uint8_t*)frame->data, std::min(fb_->len, preview_data_size_));
+        display->SetSharedPreviewImage(std::move(frame));
     }
     return true;
 }
+
 bool Esp32Camera::SetHMirror(bool enabled) {
     sensor_t *s = esp_camera_sensor_get();
     if (s == nullptr) {
@@ -160,6 +231,124 @@ bool Esp32Camera::SetVFlip(bool enabled) {
     return true;
 }
 
+size_t Esp32Camera::AppendJpegData(const uint8_t* data, size_t len) {
+    size_t written = 0;
+    while (written < len) {
+        if (jpeg_chunk_count_ == 0 || jpeg_chunks_[jpeg_chunk_count_ - 1].len == JPEG_CHUNK_SIZE) {
+            if (jpeg_chunk_count_ == jpeg_chunks_.size()) {
+                // The pool only grows when a frame encodes larger than any frame before
+                JpegChunk chunk = {
+                    .data = (uint8_t*)heap_caps_malloc(JPEG_CHUNK_SIZE, MALLOC_CAP_SPIRAM),
+                    .len = 0
+                };
+                if (chunk.data == nullptr) {
+                    ESP_LOGE(TAG, "Failed to allocate JPEG chunk");
+                    return written;
+                }
+                jpeg_chunks_.push_back(chunk);
+            }
+            jpeg_chunks_[jpeg_chunk_count_++].len = 0;
+        }
+
+        JpegChunk& chunk = jpeg_chunks_[jpeg_chunk_count_ - 1];
+        size_t n = std::min(len - written, JPEG_CHUNK_SIZE - chunk.len);
+        memcpy(chunk.data + chunk.len, data + written, n);
+        chunk.len += n;
+        written += n;
+    }
+    return written;
+}
+
+bool Esp32Camera::ShouldDownscale() const {
+    return fb_->format == PIXFORMAT_RGB565 && (jpeg_downscale_ || fb_->width * fb_->height > JPEG_MAX_PIXELS);
+}
+
+bool Esp32Camera::EncodeJpegOnce() {
+    jpeg_chunk_count_ = 0;
+
+    // Halve large frames by keeping every other pixel of every other line
+    camera_fb_t* frame = fb_;
+    camera_fb_t scaled_frame;
+    uint8_t* scaled_buffer = nullptr;
+    if (ShouldDownscale()) {
+        size_t width = fb_->width / 2;
+        size_t height = fb_->height / 2;
+        scaled_buffer = (uint8_t*)heap_caps_malloc(width * height * 2, MALLOC_CAP_SPIRAM);
+        if (scaled_buffer != nullptr) {
+            auto src = (const uint16_t*)fb_->buf;
+            auto dst = (uint16_t*)scaled_buffer;
+            for (size_t y = 0; y < height; y++) {
+                const uint16_t* row = src + (y * 2) * fb_->width;
+                for (size_t x = 0; x < width; x++) {
+                    *dst++ = row[x * 2];
+                }
+            }
+            scaled_frame = *fb_;
+            scaled_frame.buf = scaled_buffer;
+            scaled_frame.len = width * height * 2;
+            scaled_frame.width = width;
+            scaled_frame.height = height;
+            frame = &scaled_frame;
+        }
+    }
+
+    // A short write from the callback makes the encoder stop and report failure
+    bool encoded = frame2jpg_cb(frame, jpeg_quality_, [](void* arg, size_t index, const void* data, size_t len) -> unsigned int {
+        return static_cast<Esp32Camera*>(arg)->AppendJpegData((const uint8_t*)data, len);
+    }, this);
+    heap_caps_free(scaled_buffer);
+    return encoded;
+}
+
+void Esp32Camera::EncodeJpeg(QueueHandle_t queue) {
+    jpeg_complete_ = false;
+    while (true) {
+        if (!EncodeJpegOnce()) {
+            ESP_LOGE(TAG, "Failed to encode JPEG, the image is incomplete");
+            break;
+        }
+        size_t jpeg_size = 0;
+        for (size_t i = 0; i < jpeg_chunk_count_; i++) {
+            jpeg_size += jpeg_chunks_[i].len;
+        }
+        jpeg_complete_ = true;
+
+        // Over the budget, encode again right away if a lower setting is left
+        int quality = jpeg_quality_;
+        bool downscale = ShouldDownscale();
+        AdaptJpegQuality(jpeg_size);
+        if (jpeg_size <= JPEG_UPLOAD_BUDGET_BYTES || (jpeg_quality_ == quality && ShouldDownscale() == downscale)) {
+            break;
+        }
+        ESP_LOGI(TAG, "JPEG size %u over budget, encoding again at quality %d%s",
+            (unsigned)jpeg_size, jpeg_quality_, ShouldDownscale() ? " downscaled" : "");
+    }
+
+    // Only the final image is handed to the uploader, the pool keeps owning the chunks
+    for (size_t i = 0; i < jpeg_chunk_count_; i++) {
+        xQueueSend(queue, &jpeg_chunks_[i], portMAX_DELAY);
+    }
+    // An empty chunk marks the end of the image
+    JpegChunk end = { .data = nullptr, .len = 0 };
+    xQueueSend(queue, &end, portMAX_DELAY);
+}
+
+void Esp32Camera::AdaptJpegQuality(size_t jpeg_size) {
+    if (jpeg_size > JPEG_UPLOAD_BUDGET_BYTES) {
+        if (jpeg_quality_ > JPEG_MIN_QUALITY) {
+            jpeg_quality_ = std::max(JPEG_MIN_QUALITY, jpeg_quality_ - JPEG_QUALITY_STEP);
+        } else {
+            jpeg_downscale_ = true;
+        }
+    } else if (jpeg_size < JPEG_UPLOAD_BUDGET_BYTES / 2) {
+        if (jpeg_downscale_ && jpeg_size < JPEG_UPLOAD_BUDGET_BYTES / 4) {
+            jpeg_downscale_ = false;
+        } else if (jpeg_quality_ < JPEG_MAX_QUALITY) {
+            jpeg_quality_ = std::min(JPEG_MAX_QUALITY, jpeg_quality_ + JPEG_QUALITY_STEP);
+        }
+    }
+}
+
 /**
  * @brief Send captured camera image to remote server for AI analysis and interpretation
  * 
@@ -171,6 +360,10 @@ bool Esp32Camera::SetVFlip(bool enabled) {
  * - Uses separate thread for JPEG encoding, independent from main thread
  * - Uses chunked transfer encoding to optimize memory usage
  * - Implements data synchronization between encoding and sending threads via queue mechanism
+ * - JPEG data is written into pooled MSS-sized chunks that are reused across uploads
+ * - The JPEG of the current frame is cached, asking again about the same frame skips encoding
+ * - JPEG quality (and downscaling) adapts to keep the image within the upload budget, an
+ *   image over the budget is encoded again at the lower setting before it is uploaded
  * - Supports HTTP header configuration for device ID, client ID, and authentication token
  * 
  * @param question The question to ask AI about the image, sent as a form field
@@ -187,27 +380,26 @@ std::string Esp32Camera::Explain(const std::string& question) {
     if (explain_url_.empty()) {
         return "{\"success\": false, \"message\": \"Image explain URL or token is not set\"}";
     }
+    if (fb_ == nullptr) {
+        return "{\"success\": false, \"message\": \"No image captured\"}";
+    }
+    int64_t start_time = esp_timer_get_time();
 
-    // Create a local JPEG queue, 40 entries is about to store 512 * 40 = 20480 bytes of JPEG data
-    QueueHandle_t jpeg_queue = xQueueCreate(40, sizeof(JpegChunk));
+    // Chunks are only handed over by pointer, the pool keeps owning them
+    QueueHandle_t jpeg_queue = xQueueCreate(JPEG_CHUNK_QUEUE_LENGTH, sizeof(JpegChunk));
     if (jpeg_queue == nullptr) {
         ESP_LOGE(TAG, "Failed to create JPEG queue");
         return "{\"success\": false, \"message\": \"Failed to create JPEG queue\"}";
     }
 
-    // We spawn a thread to encode the image to JPEG
-    encoder_thread_ = std::thread([this, jpeg_queue]() {
-        frame2jpg_cb(fb_, 80, [](void* arg, size_t index, const void* data, size_t len) -> unsigned int {
-            auto jpeg_queue = (QueueHandle_t)arg;
-            JpegChunk chunk = {
-                .data = (uint8_t*)heap_caps_aligned_alloc(16, len, MALLOC_CAP_SPIRAM),
-                .len = len
-            };
-            memcpy(chunk.data, data, len);
-            xQueueSend(jpeg_queue, &chunk, portMAX_DELAY);
-            return len;
-        }, jpeg_queue);
-    });
+    // Repeated questions about the same frame reuse the JPEG from the previous upload
+    bool cached = jpeg_cache_valid_;
+    if (!cached) {
+        // We spawn a thread to encode the image to JPEG
+        encoder_thread_ = std::thread([this, jpeg_queue]() {
+            EncodeJpeg(jpeg_queue);
+        });
+    }
 
     auto network = Board::GetInstance().GetNetwork();
     auto http = network->CreateHttp(3);
@@ -224,15 +416,13 @@ std::string Esp32Camera::Explain(const std::string& question) {
     http->SetHeader("Transfer-Encoding", "chunked");
     if (!http->Open("POST", explain_url_)) {
         ESP_LOGE(TAG, "Failed to connect to explain URL");
-        // Clear the queue
-        encoder_thread_.join();
-        JpegChunk chunk;
-        while (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) == pdPASS) {
-            if (chunk.data != nullptr) {
-                heap_caps_free(chunk.data);
-            } else {
-                break;
+        // Let the encoder finish so the JPEG is cached for a retry
+        if (!cached) {
+            JpegChunk chunk;
+            while (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) == pdPASS && chunk.data != nullptr) {
             }
+            encoder_thread_.join();
+            jpeg_cache_valid_ = jpeg_complete_;
         }
         vQueueDelete(jpeg_queue);
         return "{\"success\": false, \"message\": \"Failed to connect to explain URL\"}";
@@ -259,23 +449,31 @@ std::string Esp32Camera::Explain(const std::string& question) {
 
     // Third part: JPEG data
     size_t total_sent = 0;
-    while (true) {
-        JpegChunk chunk;
-        if (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) != pdPASS) {
-            ESP_LOGE(TAG, "Failed to receive JPEG chunk");
-            break;
+    if (cached) {
+        for (size_t i = 0; i < jpeg_chunk_count_; i++) {
+            http->Write((const char*)jpeg_chunks_[i].data, jpeg_chunks_[i].len);
+            total_sent += jpeg_chunks_[i].len;
         }
-        if (chunk.data == nullptr) {
-            break; // The last chunk
+    } else {
+        while (true) {
+            JpegChunk chunk;
+            if (xQueueReceive(jpeg_queue, &chunk, portMAX_DELAY) != pdPASS) {
+                ESP_LOGE(TAG, "Failed to receive JPEG chunk");
+                break;
+            }
+            if (chunk.data == nullptr) {
+                break; // The last chunk
+            }
+            http->Write((const char*)chunk.data, chunk.len);
+            total_sent += chunk.len;
         }
-        http->Write((const char*)chunk.data, chunk.len);
-        total_sent += chunk.len;
-        heap_caps_free(chunk.data);
+        // Wait for the encoder thread to finish, a truncated image is never reused
+        encoder_thread_.join();
+        jpeg_cache_valid_ = jpeg_complete_;
     }
-    // Wait for the encoder thread to finish
-    encoder_thread_.join();
     // clear queue
     vQueueDelete(jpeg_queue);
+    int64_t upload_time = esp_timer_get_time();
 
     {
         // Fourth part: multipart footer
@@ -296,7 +494,9 @@ std::string Esp32Camera::Explain(const std::string& question) {
 
     // Get remain task stack size
     size_t remain_stack_size = uxTaskGetStackHighWaterMark(nullptr);
-    ESP_LOGI(TAG, "Explain image size=%dx%d, compressed size=%d, remain stack size=%d, question=%s\n%s",
-        fb_->width, fb_->height, total_sent, remain_stack_size, question.c_str(), result.c_str());
+    ESP_LOGI(TAG, "Explain image size=%dx%d, compressed size=%d%s, next quality=%d, upload=%lldms, total=%lldms, remain stack size=%d, question=%s\n%s",
+        fb_->width, fb_->height, total_sent, cached ? " (cached)" : "", jpeg_quality_,
+        (long long)(upload_time - start_time) / 1000, (long long)(esp_timer_get_time() - start_time) / 1000,
+        remain_stack_size, question.c_str(), result.c_str());
     return result;
 }
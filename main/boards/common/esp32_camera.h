@@ -5,6 +5,7 @@
 #include <lvgl.h>
 #include <thread>
 #include <memory>
+#include <vector>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
@@ -19,11 +20,30 @@ struct JpegChunk {
 class Esp32Camera : public Camera {
 private:
     camera_fb_t* fb_ = nullptr;
-    lv_img_dsc_t preview_image_;
+    // Preview frames are shared with the display, a frame is reused once no widget holds it anymore
+    lv_image_header_t preview_header_;
+    size_t preview_data_size_ = 0;
+    std::vector<std::shared_ptr<lv_img_dsc_t>> preview_ring_;
+    uint32_t preview_skipped_ = 0;
     std::string explain_url_;
     std::string explain_token_;
     std::thread encoder_thread_;
 
+    // JPEG chunks are pooled across Explain calls and double as a cache of the last encoded frame
+    std::vector<JpegChunk> jpeg_chunks_;
+    size_t jpeg_chunk_count_ = 0;
+    bool jpeg_cache_valid_ = false;
+    bool jpeg_complete_ = false;    // Set by the encoder thread, read after it is joined
+    int jpeg_quality_;
+    bool jpeg_downscale_ = false;
+
+    std::shared_ptr<lv_img_dsc_t> AcquirePreviewFrame();
+    size_t AppendJpegData(const uint8_t* data, size_t len);
+    bool ShouldDownscale() const;
+    bool EncodeJpegOnce();
+    void EncodeJpeg(QueueHandle_t queue);
+    void AdaptJpegQuality(size_t jpeg_size);
+
 public:
     Esp32Camera(const camera_config_t& config);
     ~Esp32Camera();
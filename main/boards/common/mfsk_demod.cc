@@ -0,0 +1,404 @@
+#include "mfsk_demod.h"
+#include <cstring>
+#include <algorithm>
+#include "esp_log.h"
+
+// A window counts as a clean tone when one tone holds this share of the total power
+#define PREAMBLE_TONE_PURITY 0.6f
+// Roughly an amplitude of 16 at full window alignment, below that it is silence
+#define MIN_TONE_POWER 100000000LL
+// Alternating preamble symbols needed before the symbol clock is locked
+#define PREAMBLE_LOCK_SYMBOLS 3
+// Symbols to wait for the sync word after locking
+#define MAX_HUNT_SYMBOLS 32
+// Purity difference needed to move the symbol clock
+#define TIMING_DEADBAND 0.05f
+#define HEADER_COPIES 3
+// Largest parity length the decoder keeps working buffers for
+#define RS_MAX_PARITY_BYTES 32
+
+namespace audio_wifi_config
+{
+    static const char *kLogTag = "AUDIO_WIFI_CONFIG";
+
+    // GF(256) tables, exponent table is doubled so products never need a modulo
+    static uint8_t gf_exp[512];
+    static uint8_t gf_log[256];
+
+    static void InitGaloisTables() {
+        static bool initialized = false;
+        if (initialized) {
+            return;
+        }
+        int x = 1;
+        for (int i = 0; i < 255; ++i) {
+            gf_exp[i] = static_cast<uint8_t>(x);
+            gf_log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11D;
+            }
+        }
+        for (int i = 255; i < 512; ++i) {
+            gf_exp[i] = gf_exp[i - 255];
+        }
+        initialized = true;
+    }
+
+    static inline uint8_t GfMul(uint8_t a, uint8_t b) {
+        if (a == 0 || b == 0) {
+            return 0;
+        }
+        return gf_exp[gf_log[a] + gf_log[b]];
+    }
+
+    static inline uint8_t GfDiv(uint8_t a, uint8_t b) {
+        if (a == 0) {
+            return 0;
+        }
+        return gf_exp[gf_log[a] + 255 - gf_log[b]];
+    }
+
+    // Evaluates a polynomial stored lowest degree first
+    static uint8_t GfEvaluate(const uint8_t *poly, size_t length, uint8_t x) {
+        uint8_t result = 0;
+        for (size_t i = length; i > 0; --i) {
+            result = GfMul(result, x) ^ poly[i - 1];
+        }
+        return result;
+    }
+
+    // ReedSolomon implementation
+    ReedSolomon::ReedSolomon(size_t parity_bytes) : parity_bytes_(parity_bytes) {
+        InitGaloisTables();
+    }
+
+    bool ReedSolomon::Decode(uint8_t *codeword, size_t length, int *corrected) const {
+        if (corrected != nullptr) {
+            *corrected = 0;
+        }
+        if (length > 255 || length <= parity_bytes_ || parity_bytes_ > RS_MAX_PARITY_BYTES) {
+            return false;
+        }
+
+        // Syndromes, codeword[0] is the highest degree coefficient
+        uint8_t syndromes[RS_MAX_PARITY_BYTES];
+        bool has_errors = false;
+        for (size_t i = 0; i < parity_bytes_; ++i) {
+            uint8_t root = gf_exp[i];
+            uint8_t s = 0;
+            for (size_t j = 0; j < length; ++j) {
+                s = GfMul(s, root) ^ codeword[j];
+            }
+            syndromes[i] = s;
+            has_errors |= (s != 0);
+        }
+        if (!has_errors) {
+            return true;
+        }
+
+        // Berlekamp-Massey, locator polynomials are stored lowest degree first
+        uint8_t locator[RS_MAX_PARITY_BYTES + 1] = {};
+        uint8_t previous[RS_MAX_PARITY_BYTES + 1] = {};
+        uint8_t temp[RS_MAX_PARITY_BYTES + 1];
+        locator[0] = 1;
+        previous[0] = 1;
+        size_t errors = 0;
+        size_t shift = 1;
+        uint8_t previous_discrepancy = 1;
+        for (size_t n = 0; n < parity_bytes_; ++n) {
+            uint8_t discrepancy = syndromes[n];
+            for (size_t i = 1; i <= errors; ++i) {
+                discrepancy ^= GfMul(locator[i], syndromes[n - i]);
+            }
+            if (discrepancy == 0) {
+                shift++;
+                continue;
+            }
+            uint8_t scale = GfDiv(discrepancy, previous_discrepancy);
+            memcpy(temp, locator, sizeof(temp));
+            for (size_t i = 0; i + shift <= parity_bytes_; ++i) {
+                locator[i + shift] ^= GfMul(scale, previous[i]);
+            }
+            if (2 * errors <= n) {
+                errors = n + 1 - errors;
+                memcpy(previous, temp, sizeof(temp));
+                previous_discrepancy = discrepancy;
+                shift = 1;
+            } else {
+                shift++;
+            }
+        }
+        if (errors == 0 || errors > parity_bytes_ / 2) {
+            return false;
+        }
+
+        // Error evaluator = syndromes * locator mod x^parity_bytes
+        uint8_t evaluator[RS_MAX_PARITY_BYTES] = {};
+        for (size_t i = 0; i < parity_bytes_; ++i) {
+            for (size_t j = 0; j <= std::min(i, errors); ++j) {
+                evaluator[i] ^= GfMul(syndromes[i - j], locator[j]);
+            }
+        }
+
+        // Chien search and Forney, only positions inside the shortened codeword are valid
+        size_t found = 0;
+        for (size_t j = 0; j < length; ++j) {
+            size_t power = length - 1 - j;
+            uint8_t x = gf_exp[power];
+            uint8_t x_inverse = gf_exp[(255 - power) % 255];
+            if (GfEvaluate(locator, errors + 1, x_inverse) != 0) {
+                continue;
+            }
+            // Formal derivative keeps the odd terms
+            uint8_t derivative = 0;
+            for (size_t i = 1; i <= errors; i += 2) {
+                derivative ^= GfMul(locator[i], gf_exp[(gf_log[x_inverse] * (i - 1)) % 255]);
+            }
+            if (derivative == 0) {
+                return false;
+            }
+            uint8_t magnitude = GfMul(x, GfDiv(GfEvaluate(evaluator, parity_bytes_, x_inverse), derivative));
+            codeword[j] ^= magnitude;
+            found++;
+        }
+        if (found != errors) {
+            return false;   // More errors than the code can locate
+        }
+        if (corrected != nullptr) {
+            *corrected = static_cast<int>(found);
+        }
+        return true;
+    }
+
+    // MfskDemodulator implementation
+    MfskDemodulator::MfskDemodulator()
+        : window_position_(0), window_fill_(0), reed_solomon_(kMfskParityBytes) {
+        samples_per_symbol_ = kMfskSampleRate / kMfskSymbolRate;
+        timing_offset_ = samples_per_symbol_ / 8;
+        window_.assign(samples_per_symbol_, 0);
+        detectors_.reserve(kMfskToneGroups * kMfskTonesPerGroup);
+        for (size_t i = 0; i < kMfskToneGroups * kMfskTonesPerGroup; ++i) {
+            float frequency = static_cast<float>(kMfskBaseFrequency + i * kMfskToneSpacing) / kMfskSampleRate;
+            detectors_.emplace_back(frequency, samples_per_symbol_);
+        }
+        header_.reserve(HEADER_COPIES);
+        frame_.reserve(kMfskMaxDataBytes + kMfskParityBytes);
+        ResetSearch();
+    }
+
+    void MfskDemodulator::ResetSearch() {
+        state_ = State::kSearching;
+        span_position_ = 0;
+        span_peak_ = 0.0f;
+        span_peak_age_ = 0;
+        span_peak_group_ = -1;
+        preamble_count_ = 0;
+    }
+
+    bool MfskDemodulator::ProcessAudioSamples(const int16_t *samples, size_t count) {
+        bool decoded = false;
+        for (size_t n = 0; n < count; ++n) {
+            int16_t sample = samples[n];
+            int16_t outgoing = window_[window_position_];
+            window_[window_position_] = sample;
+            if (++window_position_ == window_.size()) {
+                window_position_ = 0;
+            }
+            for (auto &detector : detectors_) {
+                detector.ProcessSample(sample, outgoing);
+            }
+            if (window_fill_ < window_.size()) {
+                window_fill_++;
+                continue;
+            }
+
+            if (state_ == State::kSearching) {
+                // Track the cleanest tone 0 window of every span of one symbol length
+                int64_t total = 0;
+                int64_t best = 0;
+                size_t best_index = 0;
+                for (size_t i = 0; i < detectors_.size(); ++i) {
+                    int64_t power = detectors_[i].GetPower();
+                    total += power;
+                    if (power > best) {
+                        best = power;
+                        best_index = i;
+                    }
+                }
+                span_peak_age_++;
+                if (total > MIN_TONE_POWER && best_index % kMfskTonesPerGroup == 0) {
+                    float purity = static_cast<float>(best) / static_cast<float>(total);
+                    if (purity > span_peak_) {
+                        span_peak_ = purity;
+                        span_peak_age_ = 0;
+                        span_peak_group_ = best_index / kMfskTonesPerGroup;
+                    }
+                }
+                if (++span_position_ < samples_per_symbol_) {
+                    continue;
+                }
+
+                // Spans are not aligned to symbols, so a span may catch either neighbour of the
+                // previous peak and the tone group is not required to alternate here
+                if (span_peak_ > PREAMBLE_TONE_PURITY) {
+                    preamble_count_++;
+                } else {
+                    preamble_count_ = 0;
+                }
+
+                if (preamble_count_ >= PREAMBLE_LOCK_SYMBOLS) {
+                    // The peak marks the end of a preamble symbol, lock the clock onto it
+                    state_ = State::kHunting;
+                    samples_to_decision_ = samples_per_symbol_ - span_peak_age_;
+                    expected_group_ = span_peak_group_ ^ 1;
+                    early_valid_ = false;
+                    symbol_count_ = 0;
+                    sync_register_ = 0;
+                }
+                span_position_ = 0;
+                span_peak_ = 0.0f;
+                continue;
+            }
+
+            samples_to_decision_--;
+            if (samples_to_decision_ == timing_offset_) {
+                size_t base = expected_group_ * kMfskTonesPerGroup;
+                for (size_t i = 0; i < kMfskTonesPerGroup; ++i) {
+                    early_powers_[i] = detectors_[base + i].GetPower();
+                }
+                early_valid_ = true;
+            } else if (samples_to_decision_ == 0) {
+                samples_to_decision_ = samples_per_symbol_;
+                if (ProcessSymbolDecision()) {
+                    decoded = true;
+                }
+            } else if (samples_to_decision_ == samples_per_symbol_ - timing_offset_) {
+                ProcessLateTiming();
+            }
+        }
+        return decoded;
+    }
+
+    bool MfskDemodulator::ProcessSymbolDecision() {
+        size_t base = expected_group_ * kMfskTonesPerGroup;
+        int64_t best = -1;
+        for (size_t i = 0; i < kMfskTonesPerGroup; ++i) {
+            int64_t power = detectors_[base + i].GetPower();
+            if (power > best) {
+                best = power;
+                last_tone_ = static_cast<int>(i);
+            }
+        }
+        expected_group_ ^= 1;
+        symbol_count_++;
+        return ProcessSymbol(last_tone_);
+    }
+
+    void MfskDemodulator::ProcessLateTiming() {
+        if (!early_valid_) {
+            return;
+        }
+        early_valid_ = false;
+
+        // Neighbouring symbols never share a tone group, so whichever side of the symbol end
+        // holds the decided tone more cleanly tells the direction of the clock error
+        size_t base = (expected_group_ ^ 1) * kMfskTonesPerGroup;
+        int64_t early_total = 0;
+        int64_t late_total = 0;
+        for (size_t i = 0; i < kMfskTonesPerGroup; ++i) {
+            early_total += early_powers_[i];
+            late_total += detectors_[base + i].GetPower();
+        }
+        if (early_total <= 0 || late_total <= 0) {
+            return;
+        }
+        float early = static_cast<float>(early_powers_[last_tone_]) / static_cast<float>(early_total);
+        float late = static_cast<float>(detectors_[base + last_tone_].GetPower()) / static_cast<float>(late_total);
+        // Large errors move the clock by two samples so a 1% clock skew can still be followed
+        float error = late - early;
+        if (error > TIMING_DEADBAND) {
+            samples_to_decision_ += (error > 4 * TIMING_DEADBAND) ? 2 : 1;
+        } else if (error < -TIMING_DEADBAND) {
+            samples_to_decision_ -= (error < -4 * TIMING_DEADBAND) ? 2 : 1;
+        }
+    }
+
+    bool MfskDemodulator::ProcessSymbol(int value) {
+        if (state_ == State::kHunting) {
+            sync_register_ = static_cast<uint16_t>((sync_register_ << 2) | value);
+            if (sync_register_ == kMfskSyncWord) {
+                state_ = State::kHeader;
+                current_byte_ = 0;
+                symbols_in_byte_ = 0;
+                header_.clear();
+            } else if (symbol_count_ > MAX_HUNT_SYMBOLS) {
+                ResetSearch();
+            }
+            return false;
+        }
+
+        current_byte_ = static_cast<uint8_t>((current_byte_ << 2) | value);
+        if (++symbols_in_byte_ < 4) {
+            return false;
+        }
+        symbols_in_byte_ = 0;
+
+        if (state_ == State::kHeader) {
+            header_.push_back(current_byte_);
+            if (header_.size() < HEADER_COPIES) {
+                return false;
+            }
+            // Bitwise majority of the three copies
+            uint8_t length = (header_[0] & header_[1]) | (header_[0] & header_[2]) | (header_[1] & header_[2]);
+            if (length < 3 || length > kMfskMaxDataBytes) {
+                ESP_LOGW(kLogTag, "Invalid v2 frame length %u", length);
+                ResetSearch();
+                return false;
+            }
+            frame_length_ = length + kMfskParityBytes;
+            frame_.clear();
+            state_ = State::kPayload;
+            return false;
+        }
+
+        frame_.push_back(current_byte_);
+        if (frame_.size() < frame_length_) {
+            return false;
+        }
+        bool result = ProcessFrame();
+        ResetSearch();
+        return result;
+    }
+
+    bool MfskDemodulator::ProcessFrame() {
+        int corrected = 0;
+        if (!reed_solomon_.Decode(frame_.data(), frame_.size(), &corrected)) {
+            ESP_LOGW(kLogTag, "Uncorrectable v2 frame");
+            return false;
+        }
+
+        size_t text_length = frame_.size() - kMfskParityBytes - 2;
+        uint16_t received_crc = (frame_[text_length] << 8) | frame_[text_length + 1];
+        uint16_t calculated_crc = CalculateCrc16(frame_.data(), text_length);
+        if (received_crc != calculated_crc) {
+            ESP_LOGW(kLogTag, "CRC mismatch: expected %04x, got %04x", received_crc, calculated_crc);
+            return false;
+        }
+
+        ESP_LOGI(kLogTag, "Received v2 frame, %d bytes corrected", corrected);
+        decoded_text = std::string(frame_.begin(), frame_.begin() + text_length);
+        return true;
+    }
+
+    uint16_t MfskDemodulator::CalculateCrc16(const uint8_t *data, size_t length) {
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < length; ++i) {
+            crc ^= static_cast<uint16_t>(data[i]) << 8;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+            }
+        }
+        return crc;
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <optional>
+#include "afsk_demod.h"
+
+// Sonic provisioning v2: 4-FSK at 200 symbols per second (400 bps) on the 16kHz input.
+// Even and odd symbols use two disjoint tone groups, so reverberation of the previous
+// symbol never lands on a tone that is being compared.
+const size_t kMfskSampleRate = 16000;
+const size_t kMfskSymbolRate = 200;
+const size_t kMfskBaseFrequency = 2000;
+const size_t kMfskToneSpacing = 200;
+const size_t kMfskTonesPerGroup = 4;
+const size_t kMfskToneGroups = 2;
+const size_t kMfskParityBytes = 16;     // Corrects up to 8 byte errors per frame
+const size_t kMfskMaxDataBytes = 128;   // Text plus CRC-16
+const uint16_t kMfskSyncWord = 0x2DD4;
+
+namespace audio_wifi_config
+{
+    /**
+     * Reed-Solomon decoder over GF(256) (polynomial 0x11D, first consecutive root 1)
+     * Works on shortened codewords: data bytes followed by parity bytes
+     */
+    class ReedSolomon
+    {
+    private:
+        size_t parity_bytes_;   // Number of parity bytes, corrects parity_bytes_ / 2 errors
+
+    public:
+        explicit ReedSolomon(size_t parity_bytes);
+
+        /**
+         * Correct a codeword in place
+         * @param codeword Data bytes followed by parity bytes
+         * @param length Codeword length, at most 255
+         * @param corrected Receives the number of corrected bytes
+         * @return true if the codeword is valid or was corrected
+         */
+        bool Decode(uint8_t *codeword, size_t length, int *corrected = nullptr) const;
+    };
+
+    /**
+     * Frame layout (two bits per symbol, most significant bits first):
+     * 16 preamble symbols of tone 0, sync word, data length sent three times,
+     * then data (text + CRC-16/CCITT) followed by Reed-Solomon parity
+     */
+    class MfskDemodulator
+    {
+    private:
+        enum class State
+        {
+            kSearching, // Looking for preamble symbols
+            kHunting,   // Symbol clock locked, waiting for the sync word
+            kHeader,    // Receiving the length bytes
+            kPayload    // Receiving data and parity
+        };
+
+        State state_;
+        std::vector<int16_t> window_;                // Ring buffer of the last symbol
+        size_t window_position_;                     // Next slot to overwrite in the ring buffer
+        size_t window_fill_;                         // Samples received until the window is full
+        size_t samples_per_symbol_;                  // Window and symbol length
+        size_t timing_offset_;                       // Early/late gate distance from the symbol end
+        std::vector<FrequencyDetector> detectors_;   // kMfskToneGroups * kMfskTonesPerGroup tones
+
+        // Preamble search
+        size_t span_position_;                       // Samples into the current search span
+        float span_peak_;                            // Best tone purity in the current span
+        size_t span_peak_age_;                       // Samples since the peak
+        int span_peak_group_;                        // Tone group of the peak, -1 if no tone 0 peak
+        size_t preamble_count_;                      // Consecutive spans holding a clean tone 0
+
+        // Symbol clock
+        size_t samples_to_decision_;                 // Countdown to the next symbol end
+        int expected_group_;                         // Tone group of the next symbol
+        int64_t early_powers_[kMfskTonesPerGroup];   // Group powers a little before the symbol end
+        bool early_valid_;
+        int last_tone_;                              // Tone decided at the last symbol end
+        size_t symbol_count_;                        // Symbols since the clock was locked
+
+        // Frame assembly
+        uint16_t sync_register_;
+        uint8_t current_byte_;
+        size_t symbols_in_byte_;
+        std::vector<uint8_t> header_;
+        std::vector<uint8_t> frame_;
+        size_t frame_length_;
+        ReedSolomon reed_solomon_;
+
+        void ResetSearch();
+        bool ProcessSymbolDecision();
+        void ProcessLateTiming();
+        bool ProcessSymbol(int value);
+        bool ProcessFrame();
+
+    public:
+        std::optional<std::string> decoded_text; // Successfully decoded text data
+
+        MfskDemodulator();
+
+        /**
+         * Process 16kHz mono audio samples
+         * @param samples Input audio samples
+         * @param count Number of samples
+         * @return true if a complete frame was received and decoded
+         */
+        bool ProcessAudioSamples(const int16_t *samples, size_t count);
+
+        /**
+         * Calculate CRC-16/CCITT-FALSE
+         * @param data Input bytes
+         * @param length Number of bytes
+         * @return CRC value
+         */
+        static uint16_t CalculateCrc16(const uint8_t *data, size_t length);
+    };
+}
@@ -32,6 +32,7 @@ void Ml307Board::StartNetwork() {
     }
 
     modem_->OnNetworkStateChanged([this, &application](bool network_ready) {
+        Board::GetInstance().GetDisplay()->NotifyNetworkChanged();
         if (network_ready) {
             ESP_LOGI(TAG, "Network is ready");
         } else {
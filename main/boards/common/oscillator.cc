@@ -6,11 +6,30 @@
 #include <algorithm>
 #include <cmath>
 
-static const char* TAG = "Oscillator";
+// 正弦表和角度到占空比表只在第一次使用时生成一次，之后全部是整数查表
+struct OscillatorTables {
+    int16_t sine[(1 << OSCILLATOR_SINE_BITS) + 1];
+    uint16_t duty[181];
+
+    OscillatorTables() {
+        for (int i = 0; i <= (1 << OSCILLATOR_SINE_BITS); i++) {
+            sine[i] = (int16_t)std::lround(32767 * std::sin(2 * M_PI * i / (1 << OSCILLATOR_SINE_BITS)));
+        }
+        // 0.5ms~2.5ms 脉宽对应 0~180 度，20ms 周期，13 位分辨率
+        for (int angle = 0; angle <= 180; angle++) {
+            duty[angle] = (uint16_t)(((angle / 180.0) * 2.0 + 0.5) * 8191 / 20.0);
+        }
+    }
+};
 
-extern unsigned long IRAM_ATTR millis();
+static const OscillatorTables& Tables() {
+    static const OscillatorTables tables;
+    return tables;
+}
 
-static ledc_channel_t next_free_channel = LEDC_CHANNEL_0;
+static long millis() {
+    return (long)(esp_timer_get_time() / 1000);
+}
 
 Oscillator::Oscillator(int trim) {
     trim_ = trim;
@@ -19,8 +38,7 @@ Oscillator::Oscillator(int trim) {
 
     sampling_period_ = 30;
     period_ = 2000;
-    number_samples_ = period_ / sampling_period_;
-    inc_ = 2 * M_PI / number_samples_;
+    inc_ = OSCILLATOR_PHASE(1, period_ / sampling_period_);
 
     amplitude_ = 45;
     phase_ = 0;
@@ -37,10 +55,15 @@ Oscillator::~Oscillator() {
     Detach();
 }
 
-uint32_t Oscillator::AngleToCompare(int angle) {
-    return (angle - SERVO_MIN_DEGREE) * (SERVO_MAX_PULSEWIDTH_US - SERVO_MIN_PULSEWIDTH_US) /
-               (SERVO_MAX_DEGREE - SERVO_MIN_DEGREE) +
-           SERVO_MIN_PULSEWIDTH_US;
+int32_t Oscillator::Sine(oscillator_phase_t phase) {
+    const auto& sine = Tables().sine;
+    uint32_t index = phase >> (32 - OSCILLATOR_SINE_BITS);
+    int32_t fraction = (phase >> (16 - OSCILLATOR_SINE_BITS)) & 0xFFFF;
+    return sine[index] + (((sine[index + 1] - sine[index]) * fraction) >> 16);
+}
+
+uint32_t Oscillator::AngleToDuty(int angle) {
+    return Tables().duty[std::min(std::max(angle, 0), 180)];
 }
 
 bool Oscillator::NextSample() {
@@ -100,24 +123,34 @@ void Oscillator::Detach() {
     is_attached_ = false;
 }
 
+void Oscillator::SetPh(double Ph) {
+    // 弧度换算成整周期的定点小数，负相位和多圈相位按 2^32 回绕
+    phase0_ = (oscillator_phase_t)std::llround(Ph / (2 * M_PI) * 4294967296.0);
+}
+
 void Oscillator::SetT(unsigned int T) {
     period_ = T;
 
-    number_samples_ = period_ / sampling_period_;
-    inc_ = 2 * M_PI / number_samples_;
+    unsigned int number_samples = period_ / sampling_period_;
+    inc_ = number_samples > 0 ? OSCILLATOR_PHASE(1, number_samples) : 0;
 }
 
 void Oscillator::SetPosition(int position) {
     Write(position);
 }
 
+int Oscillator::Sample(oscillator_phase_t phase) {
+    int32_t value = (int32_t)amplitude_ * Sine(phase + phase0_) + (offset_ << 15);
+    int pos = (value + (1 << 14)) >> 15;
+    if (rev_)
+        pos = -pos;
+    return pos + 90;
+}
+
 void Oscillator::Refresh() {
     if (NextSample()) {
         if (!stop_) {
-            int pos = std::round(amplitude_ * std::sin(phase_ + phase0_) + offset_);
-            if (rev_)
-                pos = -pos;
-            Write(pos + 90);
+            Write(Sample(phase_));
         }
 
         phase_ = phase_ + inc_;
@@ -142,11 +175,7 @@ void Oscillator::Write(int position) {
     }
     previous_servo_command_millis_ = currentMillis;
 
-    int angle = pos_ + trim_;
-
-    angle = std::min(std::max(angle, 0), 180);
-
-    uint32_t duty = (uint32_t)(((angle / 180.0) * 2.0 + 0.5) * 8191 / 20.0);
+    uint32_t duty = AngleToDuty(pos_ + trim_);
 
     ESP_ERROR_CHECK(ledc_set_duty(ledc_speed_mode_, ledc_channel_, duty));
     ESP_ERROR_CHECK(ledc_update_duty(ledc_speed_mode_, ledc_channel_));
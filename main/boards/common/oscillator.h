@@ -1,12 +1,16 @@
 #ifndef __OSCILLATOR_H__
 #define __OSCILLATOR_H__
 
+#include <cstdint>
+
 #include "driver/ledc.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#ifndef M_PI
 #define M_PI 3.14159265358979323846
+#endif
 
 #ifndef DEG2RAD
 #define DEG2RAD(g) ((g) * M_PI) / 180
@@ -19,6 +23,17 @@
 #define SERVO_TIMEBASE_RESOLUTION_HZ 1000000  // 1MHz, 1us per tick
 #define SERVO_TIMEBASE_PERIOD 20000           // 20000 ticks, 20ms
 
+#define OSCILLATOR_SINE_BITS 8  // 256 点正弦表，表项之间线性插值
+
+// 相位用 32 位定点数表示，2^32 对应一个完整周期，溢出即自然回绕
+typedef uint32_t oscillator_phase_t;
+#define OSCILLATOR_PHASE(numerator, denominator) \
+    ((oscillator_phase_t)(((uint64_t)(numerator) << 32) / (denominator)))
+
+/*
+ * 舵机振荡器。相位累加、正弦查表和角度到占空比的换算全部使用整数运算，
+ * 在没有双精度 FPU 的芯片上每个采样只需几次乘法和查表。
+ */
 class Oscillator {
 public:
     Oscillator(int trim = 0);
@@ -28,7 +43,7 @@ public:
 
     void SetA(unsigned int amplitude) { amplitude_ = amplitude; };
     void SetO(int offset) { offset_ = offset; };
-    void SetPh(double Ph) { phase0_ = Ph; };
+    void SetPh(double Ph);
     void SetT(unsigned int period);
     void SetTrim(int trim) { trim_ = trim; };
     void SetLimiter(int diff_limit) { diff_limit_ = diff_limit; };
@@ -40,28 +55,30 @@ public:
     void Reset() { phase_ = 0; };
     void Refresh();
     int GetPosition() { return pos_; }
+    int Sample(oscillator_phase_t phase);
+
+    static int32_t Sine(oscillator_phase_t phase);  // Q15
+    static uint32_t AngleToDuty(int angle);
 
 private:
     bool NextSample();
     void Write(int position);
-    uint32_t AngleToCompare(int angle);
 
 private:
     bool is_attached_;
 
     //-- Oscillators parameters
-    unsigned int amplitude_;  //-- Amplitude (degrees)
-    int offset_;              //-- Offset (degrees)
-    unsigned int period_;     //-- Period (miliseconds)
-    double phase0_;           //-- Phase (radians)
+    unsigned int amplitude_;      //-- Amplitude (degrees)
+    int offset_;                  //-- Offset (degrees)
+    unsigned int period_;         //-- Period (miliseconds)
+    oscillator_phase_t phase0_;   //-- Phase (fraction of a turn)
 
     //-- Internal variables
     int pos_;                       //-- Current servo pos
     int pin_;                       //-- Pin where the servo is connected
     int trim_;                      //-- Calibration offset
-    double phase_;                  //-- Current phase
-    double inc_;                    //-- Increment of phase
-    double number_samples_;         //-- Number of samples
+    oscillator_phase_t phase_;      //-- Current phase
+    oscillator_phase_t inc_;        //-- Increment of phase
     unsigned int sampling_period_;  //-- sampling period (ms)
 
     long previous_millis_;
@@ -80,4 +97,4 @@ private:
     ledc_mode_t ledc_speed_mode_;
 };
 
-#endif  // __OSCILLATOR_H__
\ No newline at end of file
+#endif  // __OSCILLATOR_H__
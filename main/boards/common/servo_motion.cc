@@ -0,0 +1,196 @@
+#include "servo_motion.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+#include <climits>
+
+#define TAG "ServoMotion"
+
+ServoMotion::ServoMotion(int servo_count, std::function<void(int servo, int position)> write)
+    : servo_count_(std::min(servo_count, SERVO_MOTION_MAX_SERVOS)), write_(write) {
+    for (int i = 0; i < SERVO_MOTION_MAX_SERVOS; i++) {
+        position_[i] = 90 << 8;
+        step_[i] = 0;
+        segment_target_[i] = 90;
+        written_[i] = INT_MIN;
+        target_[i] = 90;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            auto self = static_cast<ServoMotion*>(arg);
+            self->OnTick();
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "servo_motion",
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer_));
+}
+
+ServoMotion::~ServoMotion() {
+    esp_timer_stop(timer_);
+    esp_timer_delete(timer_);
+}
+
+void ServoMotion::Begin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    producer_generation_ = generation_;
+}
+
+bool ServoMotion::MoveTo(const int* positions, int duration_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return count_ < SERVO_MOTION_BUFFER_SIZE || IsPreempted(); });
+    if (IsPreempted()) {
+        return false;
+    }
+
+    // Carry the rounding remainder so long sequences do not drift from their nominal time
+    int total_ms = producer_remainder_ms_ + std::max(duration_ms, 0);
+    auto& keyframe = buffer_[(head_ + count_) % SERVO_MOTION_BUFFER_SIZE];
+    for (int i = 0; i < servo_count_; i++) {
+        keyframe.position[i] = positions[i];
+        target_[i] = positions[i];
+    }
+    keyframe.ticks = std::min(total_ms / SERVO_MOTION_TICK_MS, (int)UINT16_MAX);
+    producer_remainder_ms_ = total_ms % SERVO_MOTION_TICK_MS;
+    count_++;
+
+    if (!running_) {
+        ESP_ERROR_CHECK(esp_timer_start_periodic(timer_, SERVO_MOTION_TICK_MS * 1000));
+        running_ = true;
+    }
+    return true;
+}
+
+bool ServoMotion::Hold(int duration_ms) {
+    int positions[SERVO_MOTION_MAX_SERVOS];
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::copy(target_, target_ + servo_count_, positions);
+    }
+    return MoveTo(positions, duration_ms);
+}
+
+bool ServoMotion::Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return !running_ || IsPreempted(); });
+    return !IsPreempted();
+}
+
+int ServoMotion::GetTarget(int servo) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return target_[servo];
+}
+
+void ServoMotion::Stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    if (count_ > 0 || remaining_ > 0) {
+        statistics_.preemptions++;
+        ESP_LOGI(TAG, "Preempted, dropped %d keyframes", count_);
+    }
+    // Drop the queue and hold the pose reached so far, the next command starts from it
+    count_ = 0;
+    remaining_ = 0;
+    producer_remainder_ms_ = 0;
+    for (int i = 0; i < servo_count_; i++) {
+        target_[i] = (position_[i] + 128) >> 8;
+        position_[i] = target_[i] << 8;
+    }
+    condition_.notify_all();
+}
+
+void ServoMotion::SetPose(const int* positions) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    count_ = 0;
+    remaining_ = 0;
+    producer_remainder_ms_ = 0;
+    for (int i = 0; i < servo_count_; i++) {
+        target_[i] = positions[i];
+        position_[i] = positions[i] << 8;
+    }
+    WriteChanged();
+    condition_.notify_all();
+}
+
+bool ServoMotion::IsMoving() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+int ServoMotion::GetPosition(int servo) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (position_[servo] + 128) >> 8;
+}
+
+ServoMotionStatistics ServoMotion::GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+bool ServoMotion::LoadKeyframe() {
+    while (count_ > 0) {
+        const auto& keyframe = buffer_[head_];
+        head_ = (head_ + 1) % SERVO_MOTION_BUFFER_SIZE;
+        count_--;
+        statistics_.keyframes++;
+        condition_.notify_all();
+
+        if (keyframe.ticks == 0) {
+            for (int i = 0; i < servo_count_; i++) {
+                position_[i] = keyframe.position[i] << 8;
+            }
+            WriteChanged();
+            continue;
+        }
+        for (int i = 0; i < servo_count_; i++) {
+            segment_target_[i] = keyframe.position[i];
+            step_[i] = ((keyframe.position[i] << 8) - position_[i]) / keyframe.ticks;
+        }
+        remaining_ = keyframe.ticks;
+        return true;
+    }
+    return false;
+}
+
+void ServoMotion::WriteChanged() {
+    for (int i = 0; i < servo_count_; i++) {
+        int position = (position_[i] + 128) >> 8;
+        if (position != written_[i]) {
+            write_(i, position);
+            written_[i] = position;
+            statistics_.writes++;
+        }
+    }
+}
+
+void ServoMotion::OnTick() {
+    int64_t start_time = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (remaining_ == 0 && !LoadKeyframe()) {
+        esp_timer_stop(timer_);
+        running_ = false;
+        condition_.notify_all();
+        return;
+    }
+
+    remaining_--;
+    for (int i = 0; i < servo_count_; i++) {
+        if (remaining_ == 0) {
+            // Land exactly on the keyframe, the Q8 steps truncate
+            position_[i] = segment_target_[i] << 8;
+        } else {
+            position_[i] += step_[i];
+        }
+    }
+    WriteChanged();
+
+    int64_t elapsed = esp_timer_get_time() - start_time;
+    statistics_.ticks++;
+    statistics_.busy_us += elapsed;
+    statistics_.max_tick_us = std::max(statistics_.max_tick_us, elapsed);
+}
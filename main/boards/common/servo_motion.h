@@ -0,0 +1,85 @@
+#ifndef _SERVO_MOTION_H_
+#define _SERVO_MOTION_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include <esp_timer.h>
+
+#define SERVO_MOTION_MAX_SERVOS 8
+#define SERVO_MOTION_TICK_MS 20         // One step per 50 Hz servo PWM frame
+#define SERVO_MOTION_BUFFER_SIZE 32     // Keyframes queued ahead of the timer
+
+struct ServoKeyframe {
+    int16_t position[SERVO_MOTION_MAX_SERVOS];  // Target angle of every servo
+    uint16_t ticks;                             // Ticks to travel there from the previous keyframe, 0 jumps
+};
+
+struct ServoMotionStatistics {
+    uint32_t ticks = 0;             // Timer callbacks that stepped a trajectory
+    uint32_t writes = 0;            // Servo positions written
+    uint32_t keyframes = 0;         // Keyframes played
+    uint32_t preemptions = 0;       // Stop() calls that dropped queued keyframes
+    int64_t busy_us = 0;            // Time spent in the timer callback
+    int64_t max_tick_us = 0;        // Longest timer callback
+};
+
+/*
+ * Plays servo trajectories from a keyframe buffer with one periodic timer.
+ * Moves are precomputed into keyframes by a low priority task, the timer
+ * interpolates all servos in Q8 fixed point and writes only the positions
+ * that changed. Every segment starts from where the servos actually are, so
+ * a new command after Stop() blends from the interrupted pose.
+ */
+class ServoMotion {
+public:
+    ServoMotion(int servo_count, std::function<void(int servo, int position)> write);
+    ~ServoMotion();
+
+    // Producer side, one task at a time. Begin() starts a command, the others
+    // block while the buffer is full and return false once it was preempted
+    void Begin();
+    bool MoveTo(const int* positions, int duration_ms);
+    bool Hold(int duration_ms);
+    bool Wait();
+    int GetTarget(int servo);
+
+    // Any task. SetPose() preempts like Stop() and jumps to the pose, for external sequencers
+    void Stop();
+    void SetPose(const int* positions);
+    bool IsMoving();
+    int GetPosition(int servo);
+    ServoMotionStatistics GetStatistics();
+
+private:
+    int servo_count_;
+    std::function<void(int servo, int position)> write_;
+    esp_timer_handle_t timer_ = nullptr;
+    bool running_ = false;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    ServoKeyframe buffer_[SERVO_MOTION_BUFFER_SIZE];
+    int head_ = 0;
+    int count_ = 0;
+    uint32_t generation_ = 0;
+    uint32_t producer_generation_ = 0;
+    int producer_remainder_ms_ = 0;
+
+    int32_t position_[SERVO_MOTION_MAX_SERVOS];     // Q8 degrees
+    int32_t step_[SERVO_MOTION_MAX_SERVOS];         // Q8 degrees per tick
+    int16_t segment_target_[SERVO_MOTION_MAX_SERVOS];
+    int written_[SERVO_MOTION_MAX_SERVOS];
+    int target_[SERVO_MOTION_MAX_SERVOS];           // End of everything queued
+    int remaining_ = 0;
+    ServoMotionStatistics statistics_;
+
+    void OnTick();
+    bool LoadKeyframe();
+    void WriteChanged();
+    bool IsPreempted() const { return producer_generation_ != generation_; }
+};
+
+#endif // _SERVO_MOTION_H_
@@ -4,11 +4,14 @@
 
 #include <cJSON.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <mbedtls/base64.h>
 
 #include <cstring>
 
 #include "application.h"
 #include "board.h"
+#include "choreography.h"
 #include "config.h"
 #include "mcp_server.h"
 #include "movements.h"
@@ -28,6 +31,8 @@ struct ElectronBotActionParams {
 class ElectronBotController {
 private:
     Otto electron_bot_;
+    ChoreographyPlayer choreography_{SERVO_COUNT,
+                                     [this](const int* pose) { electron_bot_.SetPose(pose); }};
     TaskHandle_t action_task_handle_ = nullptr;
     QueueHandle_t action_queue_;
     bool is_action_in_progress_ = false;
@@ -72,6 +77,7 @@ private:
             if (xQueueReceive(controller->action_queue_, &params, pdMS_TO_TICKS(1000)) == pdTRUE) {
                 ESP_LOGI(TAG, "执行动作: %d", params.action_type);
                 controller->is_action_in_progress_ = true;  // 开始执行动作
+                controller->electron_bot_.Begin();
 
                 // 执行相应的动作
                 if (params.action_type >= ACTION_HAND_LEFT_UP &&
@@ -102,6 +108,8 @@ private:
     }
 
     void QueueAction(int action_type, int steps, int speed, int direction, int amount) {
+        choreography_.Stop();
+
         ESP_LOGI(TAG, "动作控制: 类型=%d, 步数=%d, 速度=%d, 方向=%d, 幅度=%d", action_type, steps,
                  speed, direction, amount);
 
@@ -110,10 +118,39 @@ private:
         StartActionTaskIfNeeded();
     }
 
+    ReturnValue PlayChoreography(const std::string& payload, bool sync_to_speech) {
+        std::vector<uint8_t> data(payload.size() * 3 / 4 + 3);
+        size_t length = 0;
+        if (mbedtls_base64_decode(data.data(), data.size(), &length,
+                                  (const unsigned char*)payload.data(), payload.size()) != 0) {
+            return "错误：舞蹈数据不是有效的 base64";
+        }
+        data.resize(length);
+
+        // 打断排队中的动作，舞蹈从当前姿态开始
+        xQueueReset(action_queue_);
+        electron_bot_.Stop();
+        int pose[SERVO_COUNT];
+        electron_bot_.GetPose(pose);
+
+        std::function<uint32_t()> clock;
+        if (sync_to_speech) {
+            // 时间轴从本轮说话开始，语音卡顿或迟到时舞蹈一起等待
+            clock = []() { return Application::GetInstance().GetAudioService().GetPlaybackTime(); };
+        } else {
+            int64_t start_time = esp_timer_get_time();
+            clock = [start_time]() { return (uint32_t)((esp_timer_get_time() - start_time) / 1000); };
+        }
+        if (!choreography_.Play(std::move(data), pose, clock)) {
+            return "错误：舞蹈数据格式无效";
+        }
+        return true;
+    }
+
     void StartActionTaskIfNeeded() {
         if (action_task_handle_ == nullptr) {
-            xTaskCreate(ActionTask, "electron_bot_action", 1024 * 4, this, configMAX_PRIORITIES - 1,
-                        &action_task_handle_);
+            // 动作任务只负责生成关键帧，舵机由运动引擎的定时器驱动，低优先级即可
+            xTaskCreate(ActionTask, "electron_bot_action", 1024 * 4, this, 1, &action_task_handle_);
         }
     }
 
@@ -246,11 +283,24 @@ public:
                                return true;
                            });
 
+        mcp_server.AddTool(
+            "self.electron.dance",
+            "播放编排好的舞蹈。choreography: base64 编码的 CHR1 舞蹈数据(由 scripts/choreography.py 生成)，"
+            "通道依次为 right_pitch/right_roll/left_pitch/left_roll/body/head 的角度; "
+            "sync_to_speech: 为 true 时按语音播放进度对齐，时间从本轮开始说话算起",
+            PropertyList({Property("choreography", kPropertyTypeString),
+                          Property("sync_to_speech", kPropertyTypeBoolean, true)}),
+            [this](const PropertyList& properties) -> ReturnValue {
+                return PlayChoreography(properties["choreography"].value<std::string>(),
+                                        properties["sync_to_speech"].value<bool>());
+            });
+
         // 系统工具
         mcp_server.AddTool("self.electron.stop", "立即停止", PropertyList(),
                            [this](const PropertyList& properties) -> ReturnValue {
-                               // 清空队列但保持任务常驻
+                               // 清空队列并打断当前动作，复位从当前姿态平滑过渡
                                xQueueReset(action_queue_);
+                               electron_bot_.Stop();
                                is_action_in_progress_ = false;
                                QueueAction(ACTION_HOME, 1, 1000, 0, 0);
                                return true;
@@ -258,7 +308,10 @@ public:
 
         mcp_server.AddTool("self.electron.get_status", "获取机器人状态，返回 moving 或 idle",
                            PropertyList(), [this](const PropertyList& properties) -> ReturnValue {
-                               return is_action_in_progress_ ? "moving" : "idle";
+                               return is_action_in_progress_ || electron_bot_.IsMoving() ||
+                                              choreography_.IsPlaying()
+                                          ? "moving"
+                                          : "idle";
                            });
 
         // 单个舵机校准工具
@@ -358,6 +411,8 @@ public:
     }
 
     ~ElectronBotController() {
+        choreography_.Stop();
+        electron_bot_.Stop();
         if (action_task_handle_ != nullptr) {
             vTaskDelete(action_task_handle_);
             action_task_handle_ = nullptr;
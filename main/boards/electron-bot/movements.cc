@@ -1,13 +1,23 @@
 #include "movements.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 
 #include "oscillator.h"
 
 static const char* TAG = "Movements";
 
-Otto::Otto() {
+#define OSCILLATION_SAMPLE_MS 40  // Oscillators are sampled into keyframes at this interval
+#define OSCILLATION_MIN_SAMPLES 8
+#define OSCILLATION_BLEND_MS 200  // Cross-fade from the current pose into an oscillation
+
+Otto::Otto()
+    : motion_(SERVO_COUNT, [this](int servo, int position) {
+          if (servo_pins_[servo] != -1) {
+              servo_[servo].SetPosition(position);
+          }
+      }) {
     is_otto_resting_ = false;
     for (int i = 0; i < SERVO_COUNT; i++) {
         servo_pins_[i] = -1;
@@ -19,10 +29,6 @@ Otto::~Otto() {
     DetachServos();
 }
 
-unsigned long IRAM_ATTR millis() {
-    return (unsigned long)(esp_timer_get_time() / 1000ULL);
-}
-
 void Otto::Init(int right_pitch, int right_roll, int left_pitch, int left_roll, int body,
                 int head) {
     servo_pins_[RIGHT_PITCH] = right_pitch;
@@ -77,58 +83,36 @@ void Otto::SetTrims(int right_pitch, int right_roll, int left_pitch, int left_ro
 ///////////////////////////////////////////////////////////////////
 //-- BASIC MOTION FUNCTIONS -------------------------------------//
 ///////////////////////////////////////////////////////////////////
+void Otto::Begin() {
+    motion_.Begin();
+}
+
+void Otto::Stop() {
+    motion_.Stop();
+    is_otto_resting_ = false;
+}
+
+bool Otto::IsMoving() {
+    return motion_.IsMoving();
+}
+
+void Otto::SetPose(const int* positions) {
+    is_otto_resting_ = false;
+    motion_.SetPose(positions);
+}
+
+void Otto::GetPose(int* positions) {
+    for (int i = 0; i < SERVO_COUNT; i++) {
+        positions[i] = motion_.GetPosition(i);
+    }
+}
+
 void Otto::MoveServos(int time, int servo_target[]) {
     if (GetRestState() == true) {
         SetRestState(false);
     }
 
-    final_time_ = millis() + time;
-    if (time > 10) {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                increment_[i] = (servo_target[i] - servo_[i].GetPosition()) / (time / 10.0);
-            }
-        }
-
-        for (int iteration = 1; millis() < final_time_; iteration++) {
-            partial_time_ = millis() + 10;
-            for (int i = 0; i < SERVO_COUNT; i++) {
-                if (servo_pins_[i] != -1) {
-                    servo_[i].SetPosition(servo_[i].GetPosition() + increment_[i]);
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
-    } else {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                servo_[i].SetPosition(servo_target[i]);
-            }
-        }
-        vTaskDelay(pdMS_TO_TICKS(time));
-    }
-
-    // final adjustment to the target.
-    bool f = true;
-    int adjustment_count = 0;
-    while (f && adjustment_count < 10) {
-        f = false;
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1 && servo_target[i] != servo_[i].GetPosition()) {
-                f = true;
-                break;
-            }
-        }
-        if (f) {
-            for (int i = 0; i < SERVO_COUNT; i++) {
-                if (servo_pins_[i] != -1) {
-                    servo_[i].SetPosition(servo_target[i]);
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(10));
-            adjustment_count++;
-        }
-    };
+    motion_.MoveTo(servo_target, time);
 }
 
 void Otto::MoveSingle(int position, int servo_number) {
@@ -142,7 +126,12 @@ void Otto::MoveSingle(int position, int servo_number) {
     }
 
     if (servo_number >= 0 && servo_number < SERVO_COUNT && servo_pins_[servo_number] != -1) {
-        servo_[servo_number].SetPosition(position);
+        int positions[SERVO_COUNT];
+        for (int i = 0; i < SERVO_COUNT; i++) {
+            positions[i] = motion_.GetTarget(i);
+        }
+        positions[servo_number] = position;
+        motion_.MoveTo(positions, 0);
     }
 }
 
@@ -157,18 +146,32 @@ void Otto::OscillateServos(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT],
         }
     }
 
-    double ref = millis();
-    double end_time = period * cycle + ref;
-
-    while (millis() < end_time) {
+    //-- Sample the whole oscillation into keyframes, the motion engine interpolates between
+    //-- samples. The first samples are cross-faded from the pose the previous move ended in
+    int samples = std::max(OSCILLATION_MIN_SAMPLES, period / OSCILLATION_SAMPLE_MS);
+    int total = (int)std::lround(samples * cycle);
+    int start[SERVO_COUNT];
+    int positions[SERVO_COUNT];
+    for (int i = 0; i < SERVO_COUNT; i++) {
+        start[i] = motion_.GetTarget(i);
+    }
+    int elapsed = 0;
+    for (int k = 1; k <= total; k++) {
+        int time = (int)((int64_t)period * k / samples);
         for (int i = 0; i < SERVO_COUNT; i++) {
+            positions[i] = start[i];
             if (servo_pins_[i] != -1) {
-                servo_[i].Refresh();
+                int sample = servo_[i].Sample(OSCILLATOR_PHASE(k, samples));
+                positions[i] = time < OSCILLATION_BLEND_MS
+                                   ? start[i] + (sample - start[i]) * time / OSCILLATION_BLEND_MS
+                                   : sample;
             }
         }
-        vTaskDelay(5);
+        if (!motion_.MoveTo(positions, time - elapsed)) {
+            return;
+        }
+        elapsed = time;
     }
-    vTaskDelay(pdMS_TO_TICKS(10));
 }
 
 void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
@@ -177,16 +180,8 @@ void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int peri
         SetRestState(false);
     }
 
-    int cycles = (int)steps;
-
-    //-- Execute complete cycles
-    if (cycles >= 1)
-        for (int i = 0; i < cycles; i++)
-            OscillateServos(amplitude, offset, period, phase_diff);
-
-    //-- Execute the final not complete cycle
-    OscillateServos(amplitude, offset, period, phase_diff, (float)steps - cycles);
-    vTaskDelay(pdMS_TO_TICKS(10));
+    //-- Complete cycles and the final not complete cycle in one continuous trajectory
+    OscillateServos(amplitude, offset, period, phase_diff, steps);
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -194,11 +189,12 @@ void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int peri
 ///////////////////////////////////////////////////////////////////
 void Otto::Home(bool hands_down) {
     if (is_otto_resting_ == false) {  // Go to rest position only if necessary
-        MoveServos(1000, servo_initial_);
-        is_otto_resting_ = true;
+        if (motion_.MoveTo(servo_initial_, 1000)) {
+            is_otto_resting_ = true;
+        }
     }
 
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    motion_.Hold(1000);
 }
 
 bool Otto::GetRestState() {
@@ -230,7 +226,7 @@ void Otto::HandAction(int action, int times, int amount, int period) {
 
     int current_positions[SERVO_COUNT];
     for (int i = 0; i < SERVO_COUNT; i++) {
-        current_positions[i] = (servo_pins_[i] != -1) ? servo_[i].GetPosition() : servo_initial_[i];
+        current_positions[i] = (servo_pins_[i] != -1) ? motion_.GetTarget(i) : servo_initial_[i];
     }
 
     switch (action) {
@@ -264,7 +260,7 @@ void Otto::HandAction(int action, int times, int amount, int period) {
             for (int i = 0; i < times; i++) {
                 current_positions[LEFT_PITCH] = 150 + (i % 2 == 0 ? -30 : 30);
                 MoveServos(period / 10, current_positions);
-                vTaskDelay(pdMS_TO_TICKS(period / 10));
+                motion_.Hold(period / 10);
             }
             memcpy(current_positions, servo_initial_, sizeof(current_positions));
             MoveServos(period, current_positions);
@@ -276,7 +272,7 @@ void Otto::HandAction(int action, int times, int amount, int period) {
             for (int i = 0; i < times; i++) {
                 current_positions[RIGHT_PITCH] = 30 + (i % 2 == 0 ? 30 : -30);
                 MoveServos(period / 10, current_positions);
-                vTaskDelay(pdMS_TO_TICKS(period / 10));
+                motion_.Hold(period / 10);
             }
             memcpy(current_positions, servo_initial_, sizeof(current_positions));
             MoveServos(period, current_positions);
@@ -290,7 +286,7 @@ void Otto::HandAction(int action, int times, int amount, int period) {
                 current_positions[LEFT_PITCH] = 150 + (i % 2 == 0 ? -30 : 30);
                 current_positions[RIGHT_PITCH] = 30 + (i % 2 == 0 ? 30 : -30);
                 MoveServos(period / 10, current_positions);
-                vTaskDelay(pdMS_TO_TICKS(period / 10));
+                motion_.Hold(period / 10);
             }
             memcpy(current_positions, servo_initial_, sizeof(current_positions));
             MoveServos(period, current_positions);
@@ -357,11 +353,7 @@ void Otto::BodyAction(int action, int times, int amount, int period) {
 
     int current_positions[SERVO_COUNT];
     for (int i = 0; i < SERVO_COUNT; i++) {
-        if (servo_pins_[i] != -1) {
-            current_positions[i] = servo_[i].GetPosition();
-        } else {
-            current_positions[i] = servo_initial_[i];
-        }
+        current_positions[i] = (servo_pins_[i] != -1) ? motion_.GetTarget(i) : servo_initial_[i];
     }
 
     int body_center = servo_initial_[BODY];
@@ -385,7 +377,7 @@ void Otto::BodyAction(int action, int times, int amount, int period) {
 
     current_positions[BODY] = target_angle;
     MoveServos(period, current_positions);
-    vTaskDelay(pdMS_TO_TICKS(100));
+    motion_.Hold(100);
 }
 
 //---------------------------------------------------------
@@ -404,11 +396,7 @@ void Otto::HeadAction(int action, int times, int amount, int period) {
 
     int current_positions[SERVO_COUNT];
     for (int i = 0; i < SERVO_COUNT; i++) {
-        if (servo_pins_[i] != -1) {
-            current_positions[i] = servo_[i].GetPosition();
-        } else {
-            current_positions[i] = servo_initial_[i];
-        }
+        current_positions[i] = (servo_pins_[i] != -1) ? motion_.GetTarget(i) : servo_initial_[i];
     }
 
     int head_center = 90;  // 头部中心位置
@@ -428,12 +416,12 @@ void Otto::HeadAction(int action, int times, int amount, int period) {
             // 先抬头
             current_positions[HEAD] = head_center + amount;
             MoveServos(period / 3, current_positions);
-            vTaskDelay(pdMS_TO_TICKS(period / 6));
+            motion_.Hold(period / 6);
 
             // 再低头
             current_positions[HEAD] = head_center - amount;
             MoveServos(period / 3, current_positions);
-            vTaskDelay(pdMS_TO_TICKS(period / 6));
+            motion_.Hold(period / 6);
 
             // 回到中心
             current_positions[HEAD] = head_center;
@@ -455,7 +443,7 @@ void Otto::HeadAction(int action, int times, int amount, int period) {
                 current_positions[HEAD] = head_center - amount;
                 MoveServos(period / 2, current_positions);
 
-                vTaskDelay(pdMS_TO_TICKS(50));  // 短暂停顿
+                motion_.Hold(50);  // 短暂停顿
             }
 
             // 回到中心
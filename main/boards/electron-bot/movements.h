@@ -7,6 +7,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "oscillator.h"
+#include "servo_motion.h"
 
 //-- Constants
 #define FORWARD 1
@@ -45,6 +46,15 @@ public:
     void SetTrims(int right_pitch, int right_roll, int left_pitch, int left_roll, int body,
                   int head);
 
+    //-- Motion engine. Moves below queue keyframes and return once they are buffered,
+    //-- Begin() starts a new command and Stop() preempts whatever is still playing
+    void Begin();
+    void Stop();
+    bool IsMoving();
+    //-- Pose setters for external sequencers, SetPose() preempts queued moves
+    void SetPose(const int* positions);
+    void GetPose(int* positions);
+
     //-- Predetermined Motion Functions
     void MoveServos(int time, int servo_target[]);
     void MoveSingle(int position, int servo_number);
@@ -71,15 +81,12 @@ public:
 
 private:
     Oscillator servo_[SERVO_COUNT];
+    ServoMotion motion_;
 
     int servo_pins_[SERVO_COUNT];
     int servo_trim_[SERVO_COUNT];
     int servo_initial_[SERVO_COUNT] = {180, 180, 0, 0, 90, 90};
 
-    unsigned long final_time_;
-    unsigned long partial_time_;
-    float increment_[SERVO_COUNT];
-
     bool is_otto_resting_;
 
     void Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
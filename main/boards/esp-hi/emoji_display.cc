@@ -3,6 +3,8 @@
 #include <esp_log.h>
 #include "mmap_generate_emoji.h"
 #include "emoji_display.h"
+#include "config.h"
+#include "asset_bundle.h"
 
 #include <esp_lcd_panel_io.h>
 #include <freertos/FreeRTOS.h>
@@ -12,19 +14,15 @@
 
 static const char *TAG = "emoji";
 
+#define EMOJI_TRANSFER_PIXELS (DISPLAY_WIDTH * 10)  // Matches max_transfer_sz of the SPI bus
+#define EMOJI_CACHE_ENTRIES 0                        // No PSRAM for decoded frames
+
 namespace anim {
 
 bool EmojiPlayer::OnFlushIoReady(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
 {
-    auto* disp_drv = static_cast<anim_player_handle_t*>(user_ctx);
-    anim_player_flush_ready(disp_drv);
-    return true;
-}
-
-void EmojiPlayer::OnFlush(anim_player_handle_t handle, int x_start, int y_start, int x_end, int y_end, const void *color_data)
-{
-    auto* panel = static_cast<esp_lcd_panel_handle_t>(anim_player_get_user_data(handle));
-    esp_lcd_panel_draw_bitmap(panel, x_start, y_start, x_end, y_end, color_data);
+    auto* player = static_cast<AafPlayer*>(user_ctx);
+    return player->FlushReadyFromIsr();
 }
 
 EmojiPlayer::EmojiPlayer(esp_lcd_panel_handle_t panel, esp_lcd_panel_io_handle_t panel_io)
@@ -39,30 +37,22 @@ EmojiPlayer::EmojiPlayer(esp_lcd_panel_handle_t panel, esp_lcd_panel_io_handle_t
 
     mmap_assets_new(&assets_cfg, &assets_handle_);
 
-    anim_player_config_t player_cfg = {
-        .flush_cb = OnFlush,
-        .update_cb = NULL,
-        .user_data = panel,
-        .flags = {.swap = true},
-        .task = ANIM_PLAYER_INIT_CONFIG()
-    };
-
-    player_handle_ = anim_player_init(&player_cfg);
+    // Only changed regions are sent, in transfers that fit the SPI bus limit
+    player_ = std::make_unique<AafPlayer>(DISPLAY_WIDTH, DISPLAY_HEIGHT, EMOJI_TRANSFER_PIXELS, EMOJI_CACHE_ENTRIES,
+        [panel](int x_start, int y_start, int x_end, int y_end, const void *color_data) {
+            esp_lcd_panel_draw_bitmap(panel, x_start, y_start, x_end, y_end, color_data);
+        });
 
     const esp_lcd_panel_io_callbacks_t cbs = {
         .on_color_trans_done = OnFlushIoReady,
     };
-    esp_lcd_panel_io_register_event_callbacks(panel_io, &cbs, player_handle_);
+    esp_lcd_panel_io_register_event_callbacks(panel_io, &cbs, player_.get());
     StartPlayer(MMAP_EMOJI_CONNECTING_AAF, true, 15);
 }
 
 EmojiPlayer::~EmojiPlayer()
 {
-    if (player_handle_) {
-        anim_player_update(player_handle_, PLAYER_ACTION_STOP);
-        anim_player_deinit(player_handle_);
-        player_handle_ = nullptr;
-    }
+    player_.reset();
 
     if (assets_handle_) {
         mmap_assets_del(assets_handle_);
@@ -72,28 +62,24 @@ EmojiPlayer::~EmojiPlayer()
 
 void EmojiPlayer::StartPlayer(int aaf, bool repeat, int fps)
 {
-    if (player_handle_) {
-        uint32_t start, end;
-        const void *src_data;
-        size_t src_len;
-
-        src_data = mmap_assets_get_mem(assets_handle_, aaf);
-        src_len = mmap_assets_get_size(assets_handle_, aaf);
-
-        anim_player_set_src_data(player_handle_, src_data, src_len);
-        anim_player_get_segment(player_handle_, &start, &end);
-        if(MMAP_EMOJI_WAKE_AAF == aaf){
-            start = 7;
+    if (player_) {
+        const void *src_data = mmap_assets_get_mem(assets_handle_, aaf);
+        size_t src_len = mmap_assets_get_size(assets_handle_, aaf);
+        // 资源分区中同名的动画优先，替换表情无需重新烧录 assets_A
+        auto bundled = AssetBundle::GetInstance().Get(mmap_assets_get_name(assets_handle_, aaf));
+        if (!bundled.empty()) {
+            src_data = bundled.data();
+            src_len = bundled.size();
         }
-        anim_player_set_segment(player_handle_, start, end, fps, true);
-        anim_player_update(player_handle_, PLAYER_ACTION_START);
+        int start = MMAP_EMOJI_WAKE_AAF == aaf ? 7 : 0;
+        player_->Play(src_data, src_len, repeat, fps, start);
     }
 }
 
 void EmojiPlayer::StopPlayer()
 {
-    if (player_handle_) {
-        anim_player_update(player_handle_, PLAYER_ACTION_STOP);
+    if (player_) {
+        player_->Stop();
     }
 }
 
@@ -4,11 +4,14 @@
 
 #include <cJSON.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <mbedtls/base64.h>
 
 #include <cstring>
 
 #include "application.h"
 #include "board.h"
+#include "choreography.h"
 #include "config.h"
 #include "mcp_server.h"
 #include "otto_movements.h"
@@ -20,6 +23,7 @@
 class OttoController {
 private:
     Otto otto_;
+    ChoreographyPlayer choreography_{SERVO_COUNT, [this](const int* pose) { otto_.SetPose(pose); }};
     TaskHandle_t action_task_handle_ = nullptr;
     QueueHandle_t action_queue_;
     bool has_hands_ = false;
@@ -62,6 +66,7 @@ private:
             if (xQueueReceive(controller->action_queue_, &params, pdMS_TO_TICKS(1000)) == pdTRUE) {
                 ESP_LOGI(TAG, "执行动作: %d", params.action_type);
                 controller->is_action_in_progress_ = true;
+                controller->otto_.Begin();
 
                 switch (params.action_type) {
                     case ACTION_WALK:
@@ -138,12 +143,14 @@ private:
 
     void StartActionTaskIfNeeded() {
         if (action_task_handle_ == nullptr) {
-            xTaskCreate(ActionTask, "otto_action", 1024 * 3, this, configMAX_PRIORITIES - 1,
-                        &action_task_handle_);
+            // 动作任务只负责生成关键帧，舵机由运动引擎的定时器驱动，低优先级即可
+            xTaskCreate(ActionTask, "otto_action", 1024 * 3, this, 1, &action_task_handle_);
         }
     }
 
     void QueueAction(int action_type, int steps, int speed, int direction, int amount) {
+        choreography_.Stop();
+
         // 检查手部动作
         if ((action_type >= ACTION_HANDS_UP && action_type <= ACTION_HAND_WAVE) && !has_hands_) {
             ESP_LOGW(TAG, "尝试执行手部动作，但机器人没有配置手部舵机");
@@ -158,6 +165,35 @@ private:
         StartActionTaskIfNeeded();
     }
 
+    ReturnValue PlayChoreography(const std::string& payload, bool sync_to_speech) {
+        std::vector<uint8_t> data(payload.size() * 3 / 4 + 3);
+        size_t length = 0;
+        if (mbedtls_base64_decode(data.data(), data.size(), &length,
+                                  (const unsigned char*)payload.data(), payload.size()) != 0) {
+            return "错误：舞蹈数据不是有效的 base64";
+        }
+        data.resize(length);
+
+        // 打断排队中的动作，舞蹈从当前姿态开始
+        xQueueReset(action_queue_);
+        otto_.Stop();
+        int pose[SERVO_COUNT];
+        otto_.GetPose(pose);
+
+        std::function<uint32_t()> clock;
+        if (sync_to_speech) {
+            // 时间轴从本轮说话开始，语音卡顿或迟到时舞蹈一起等待
+            clock = []() { return Application::GetInstance().GetAudioService().GetPlaybackTime(); };
+        } else {
+            int64_t start_time = esp_timer_get_time();
+            clock = [start_time]() { return (uint32_t)((esp_timer_get_time() - start_time) / 1000); };
+        }
+        if (!choreography_.Play(std::move(data), pose, clock)) {
+            return "错误：舞蹈数据格式无效";
+        }
+        return true;
+    }
+
     void LoadTrimsFromNVS() {
         Settings settings("otto_trims", false);
 
@@ -355,15 +391,25 @@ public:
                 });
         }
 
+        mcp_server.AddTool(
+            "self.otto.dance",
+            "播放编排好的舞蹈。choreography: base64 编码的 CHR1 舞蹈数据(由 scripts/choreography.py 生成)，"
+            "通道依次为 left_leg/right_leg/left_foot/right_foot/left_hand/right_hand 的角度; "
+            "sync_to_speech: 为 true 时按语音播放进度对齐，时间从本轮开始说话算起",
+            PropertyList({Property("choreography", kPropertyTypeString),
+                          Property("sync_to_speech", kPropertyTypeBoolean, true)}),
+            [this](const PropertyList& properties) -> ReturnValue {
+                return PlayChoreography(properties["choreography"].value<std::string>(),
+                                        properties["sync_to_speech"].value<bool>());
+            });
+
         // 系统工具
         mcp_server.AddTool("self.otto.stop", "立即停止", PropertyList(),
                            [this](const PropertyList& properties) -> ReturnValue {
-                               if (action_task_handle_ != nullptr) {
-                                   vTaskDelete(action_task_handle_);
-                                   action_task_handle_ = nullptr;
-                               }
-                               is_action_in_progress_ = false;
+                               // 清空队列并打断当前动作，复位从当前姿态平滑过渡
                                xQueueReset(action_queue_);
+                               otto_.Stop();
+                               is_action_in_progress_ = false;
 
                                QueueAction(ACTION_HOME, 1, 1000, 1, 0);
                                return true;
@@ -454,7 +500,10 @@ public:
 
         mcp_server.AddTool("self.otto.get_status", "获取机器人状态，返回 moving 或 idle",
                            PropertyList(), [this](const PropertyList& properties) -> ReturnValue {
-                               return is_action_in_progress_ ? "moving" : "idle";
+                               return is_action_in_progress_ || otto_.IsMoving() ||
+                                              choreography_.IsPlaying()
+                                          ? "moving"
+                                          : "idle";
                            });
 
         mcp_server.AddTool("self.battery.get_level", "获取机器人电池电量和充电状态", PropertyList(),
@@ -475,6 +524,8 @@ public:
     }
 
     ~OttoController() {
+        choreography_.Stop();
+        otto_.Stop();
         if (action_task_handle_ != nullptr) {
             vTaskDelete(action_task_handle_);
             action_task_handle_ = nullptr;
@@ -1,14 +1,23 @@
 #include "otto_movements.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include "oscillator.h"
 
 static const char* TAG = "OttoMovements";
 
 #define HAND_HOME_POSITION 45
-
-Otto::Otto() {
+#define OSCILLATION_SAMPLE_MS 40  // Oscillators are sampled into keyframes at this interval
+#define OSCILLATION_MIN_SAMPLES 8
+#define OSCILLATION_BLEND_MS 200  // Cross-fade from the current pose into an oscillation
+
+Otto::Otto()
+    : motion_(SERVO_COUNT, [this](int servo, int position) {
+          if (servo_pins_[servo] != -1) {
+              servo_[servo].SetPosition(position);
+          }
+      }) {
     is_otto_resting_ = false;
     has_hands_ = false;
     // 初始化所有舵机管脚为-1（未连接）
@@ -22,10 +31,6 @@ Otto::~Otto() {
     DetachServos();
 }
 
-unsigned long IRAM_ATTR millis() {
-    return (unsigned long)(esp_timer_get_time() / 1000ULL);
-}
-
 void Otto::Init(int left_leg, int right_leg, int left_foot, int right_foot, int left_hand,
                 int right_hand) {
     servo_pins_[LEFT_LEG] = left_leg;
@@ -86,58 +91,36 @@ void Otto::SetTrims(int left_leg, int right_leg, int left_foot, int right_foot,
 ///////////////////////////////////////////////////////////////////
 //-- BASIC MOTION FUNCTIONS -------------------------------------//
 ///////////////////////////////////////////////////////////////////
+void Otto::Begin() {
+    motion_.Begin();
+}
+
+void Otto::Stop() {
+    motion_.Stop();
+    is_otto_resting_ = false;
+}
+
+bool Otto::IsMoving() {
+    return motion_.IsMoving();
+}
+
+void Otto::SetPose(const int* positions) {
+    is_otto_resting_ = false;
+    motion_.SetPose(positions);
+}
+
+void Otto::GetPose(int* positions) {
+    for (int i = 0; i < SERVO_COUNT; i++) {
+        positions[i] = motion_.GetPosition(i);
+    }
+}
+
 void Otto::MoveServos(int time, int servo_target[]) {
     if (GetRestState() == true) {
         SetRestState(false);
     }
 
-    final_time_ = millis() + time;
-    if (time > 10) {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                increment_[i] = (servo_target[i] - servo_[i].GetPosition()) / (time / 10.0);
-            }
-        }
-
-        for (int iteration = 1; millis() < final_time_; iteration++) {
-            partial_time_ = millis() + 10;
-            for (int i = 0; i < SERVO_COUNT; i++) {
-                if (servo_pins_[i] != -1) {
-                    servo_[i].SetPosition(servo_[i].GetPosition() + increment_[i]);
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
-    } else {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                servo_[i].SetPosition(servo_target[i]);
-            }
-        }
-        vTaskDelay(pdMS_TO_TICKS(time));
-    }
-
-    // final adjustment to the target.
-    bool f = true;
-    int adjustment_count = 0;
-    while (f && adjustment_count < 10) {
-        f = false;
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1 && servo_target[i] != servo_[i].GetPosition()) {
-                f = true;
-                break;
-            }
-        }
-        if (f) {
-            for (int i = 0; i < SERVO_COUNT; i++) {
-                if (servo_pins_[i] != -1) {
-                    servo_[i].SetPosition(servo_target[i]);
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(10));
-            adjustment_count++;
-        }
-    };
+    motion_.MoveTo(servo_target, time);
 }
 
 void Otto::MoveSingle(int position, int servo_number) {
@@ -151,7 +134,12 @@ void Otto::MoveSingle(int position, int servo_number) {
     }
 
     if (servo_number >= 0 && servo_number < SERVO_COUNT && servo_pins_[servo_number] != -1) {
-        servo_[servo_number].SetPosition(position);
+        int positions[SERVO_COUNT];
+        for (int i = 0; i < SERVO_COUNT; i++) {
+            positions[i] = motion_.GetTarget(i);
+        }
+        positions[servo_number] = position;
+        motion_.MoveTo(positions, 0);
     }
 }
 
@@ -166,18 +154,32 @@ void Otto::OscillateServos(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT],
         }
     }
 
-    double ref = millis();
-    double end_time = period * cycle + ref;
-
-    while (millis() < end_time) {
+    //-- Sample the whole oscillation into keyframes, the motion engine interpolates between
+    //-- samples. The first samples are cross-faded from the pose the previous move ended in
+    int samples = std::max(OSCILLATION_MIN_SAMPLES, period / OSCILLATION_SAMPLE_MS);
+    int total = (int)std::lround(samples * cycle);
+    int start[SERVO_COUNT];
+    int positions[SERVO_COUNT];
+    for (int i = 0; i < SERVO_COUNT; i++) {
+        start[i] = motion_.GetTarget(i);
+    }
+    int elapsed = 0;
+    for (int k = 1; k <= total; k++) {
+        int time = (int)((int64_t)period * k / samples);
         for (int i = 0; i < SERVO_COUNT; i++) {
+            positions[i] = start[i];
             if (servo_pins_[i] != -1) {
-                servo_[i].Refresh();
+                int sample = servo_[i].Sample(OSCILLATOR_PHASE(k, samples));
+                positions[i] = time < OSCILLATION_BLEND_MS
+                                   ? start[i] + (sample - start[i]) * time / OSCILLATION_BLEND_MS
+                                   : sample;
             }
         }
-        vTaskDelay(5);
+        if (!motion_.MoveTo(positions, time - elapsed)) {
+            return;
+        }
+        elapsed = time;
     }
-    vTaskDelay(pdMS_TO_TICKS(10));
 }
 
 void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
@@ -186,16 +188,8 @@ void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int peri
         SetRestState(false);
     }
 
-    int cycles = (int)steps;
-
-    //-- Execute complete cycles
-    if (cycles >= 1)
-        for (int i = 0; i < cycles; i++)
-            OscillateServos(amplitude, offset, period, phase_diff);
-
-    //-- Execute the final not complete cycle
-    OscillateServos(amplitude, offset, period, phase_diff, (float)steps - cycles);
-    vTaskDelay(pdMS_TO_TICKS(10));
+    //-- Complete cycles and the final not complete cycle in one continuous trajectory
+    OscillateServos(amplitude, offset, period, phase_diff, steps);
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -216,7 +210,7 @@ void Otto::Home(bool hands_down) {
                     }
                 } else {
                     // 如果不需要复位手部，保持当前位置
-                    homes[i] = servo_[i].GetPosition();
+                    homes[i] = motion_.GetTarget(i);
                 }
             } else {
                 // 腿部和脚部舵机始终复位
@@ -224,11 +218,12 @@ void Otto::Home(bool hands_down) {
             }
         }
 
-        MoveServos(500, homes);
-        is_otto_resting_ = true;
+        if (motion_.MoveTo(homes, 500)) {
+            is_otto_resting_ = true;
+        }
     }
 
-    vTaskDelay(pdMS_TO_TICKS(200));
+    motion_.Hold(200);
 }
 
 bool Otto::GetRestState() {
@@ -366,7 +361,7 @@ void Otto::Bend(int steps, int period, int dir) {
     for (int i = 0; i < steps; i++) {
         MoveServos(T2 / 2, bend1);
         MoveServos(T2 / 2, bend2);
-        vTaskDelay(pdMS_TO_TICKS(period * 0.8));
+        motion_.Hold(period * 0.8);
         MoveServos(500, homes);
     }
 }
@@ -417,7 +412,7 @@ void Otto::ShakeLeg(int steps, int period, int dir) {
         MoveServos(500, homes);  // Return to home position
     }
 
-    vTaskDelay(pdMS_TO_TICKS(period));
+    motion_.Hold(period);
 }
 
 //---------------------------------------------------------
@@ -607,10 +602,10 @@ void Otto::HandsUp(int period, int dir) {
         target[RIGHT_HAND] = 10;
     } else if (dir == 1) {
         target[LEFT_HAND] = 170;
-        target[RIGHT_HAND] = servo_[RIGHT_HAND].GetPosition();
+        target[RIGHT_HAND] = motion_.GetTarget(RIGHT_HAND);
     } else if (dir == -1) {
         target[RIGHT_HAND] = 10;
-        target[LEFT_HAND] = servo_[LEFT_HAND].GetPosition();
+        target[LEFT_HAND] = motion_.GetTarget(LEFT_HAND);
     }
 
     MoveServos(period, target);
@@ -630,9 +625,9 @@ void Otto::HandsDown(int period, int dir) {
     int target[SERVO_COUNT] = {90, 90, 90, 90, HAND_HOME_POSITION, 180 - HAND_HOME_POSITION};
 
     if (dir == 1) {
-        target[RIGHT_HAND] = servo_[RIGHT_HAND].GetPosition();
+        target[RIGHT_HAND] = motion_.GetTarget(RIGHT_HAND);
     } else if (dir == -1) {
-        target[LEFT_HAND] = servo_[LEFT_HAND].GetPosition();
+        target[LEFT_HAND] = motion_.GetTarget(LEFT_HAND);
     }
 
     MoveServos(period, target);
@@ -658,11 +653,7 @@ void Otto::HandWave(int period, int dir) {
 
     int current_positions[SERVO_COUNT];
     for (int i = 0; i < SERVO_COUNT; i++) {
-        if (servo_pins_[i] != -1) {
-            current_positions[i] = servo_[i].GetPosition();
-        } else {
-            current_positions[i] = 90;
-        }
+        current_positions[i] = motion_.GetTarget(i);
     }
 
     int position;
@@ -674,24 +665,24 @@ void Otto::HandWave(int period, int dir) {
 
     current_positions[servo_index] = position;
     MoveServos(300, current_positions);
-    vTaskDelay(pdMS_TO_TICKS(300));
+    motion_.Hold(300);
 
     // 左右摆动5次
     for (int i = 0; i < 5; i++) {
         if (servo_index == LEFT_HAND) {
             current_positions[servo_index] = position - 30;
             MoveServos(period / 10, current_positions);
-            vTaskDelay(pdMS_TO_TICKS(period / 10));
+            motion_.Hold(period / 10);
             current_positions[servo_index] = position + 30;
             MoveServos(period / 10, current_positions);
         } else {
             current_positions[servo_index] = position + 30;
             MoveServos(period / 10, current_positions);
-            vTaskDelay(pdMS_TO_TICKS(period / 10));
+            motion_.Hold(period / 10);
             current_positions[servo_index] = position - 30;
             MoveServos(period / 10, current_positions);
         }
-        vTaskDelay(pdMS_TO_TICKS(period / 10));
+        motion_.Hold(period / 10);
     }
 
     if (servo_index == LEFT_HAND) {
@@ -714,11 +705,7 @@ void Otto::HandWaveBoth(int period) {
 
     int current_positions[SERVO_COUNT];
     for (int i = 0; i < SERVO_COUNT; i++) {
-        if (servo_pins_[i] != -1) {
-            current_positions[i] = servo_[i].GetPosition();
-        } else {
-            current_positions[i] = 90;
-        }
+        current_positions[i] = motion_.GetTarget(i);
     }
 
     int left_position = 170;
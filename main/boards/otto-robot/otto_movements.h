@@ -7,6 +7,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "oscillator.h"
+#include "servo_motion.h"
 
 //-- Constants
 #define FORWARD 1
@@ -46,6 +47,15 @@ public:
     void SetTrims(int left_leg, int right_leg, int left_foot, int right_foot, int left_hand = 0,
                   int right_hand = 0);
 
+    //-- Motion engine. Moves below queue keyframes and return once they are buffered,
+    //-- Begin() starts a new command and Stop() preempts whatever is still playing
+    void Begin();
+    void Stop();
+    bool IsMoving();
+    //-- Pose setters for external sequencers, SetPose() preempts queued moves
+    void SetPose(const int* positions);
+    void GetPose(int* positions);
+
     //-- Predetermined Motion Functions
     void MoveServos(int time, int servo_target[]);
     void MoveSingle(int position, int servo_number);
@@ -87,14 +97,11 @@ public:
 
 private:
     Oscillator servo_[SERVO_COUNT];
+    ServoMotion motion_;
 
     int servo_pins_[SERVO_COUNT];
     int servo_trim_[SERVO_COUNT];
 
-    unsigned long final_time_;
-    unsigned long partial_time_;
-    float increment_[SERVO_COUNT];
-
     bool is_otto_resting_;
     bool has_hands_;  // 是否有手部舵机
 
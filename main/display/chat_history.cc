@@ -0,0 +1,119 @@
+#include "chat_history.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <cstring>
+#include <algorithm>
+
+#define TAG "ChatHistory"
+
+static void* AllocatePreferSpiram(size_t size) {
+    void* ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (ptr == nullptr) {
+        ptr = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    return ptr;
+}
+
+ChatHistory::ChatHistory(size_t text_capacity, size_t max_messages)
+    : text_capacity_(text_capacity), max_messages_(max_messages) {
+    text_ = static_cast<char*>(AllocatePreferSpiram(text_capacity_));
+    entries_ = static_cast<Entry*>(AllocatePreferSpiram(sizeof(Entry) * max_messages_));
+    if (text_ == nullptr || entries_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate chat history (%u bytes, %u messages)",
+            (unsigned)text_capacity_, (unsigned)max_messages_);
+        heap_caps_free(text_);
+        heap_caps_free(entries_);
+        text_ = nullptr;
+        entries_ = nullptr;
+    }
+}
+
+ChatHistory::~ChatHistory() {
+    heap_caps_free(text_);
+    heap_caps_free(entries_);
+}
+
+void ChatHistory::DropOldest() {
+    first_seq_++;
+    count_--;
+}
+
+uint32_t ChatHistory::Append(ChatRole role, const char* text) {
+    if (text_ == nullptr) {
+        return end_seq();
+    }
+
+    // Clip very long messages at a UTF-8 boundary so one message can not evict the whole history
+    size_t length = strlen(text);
+    size_t max_length = std::min<size_t>(text_capacity_ / 4, UINT16_MAX) - 1;
+    if (length > max_length) {
+        length = max_length;
+        while (length > 0 && (static_cast<uint8_t>(text[length]) & 0xC0) == 0x80) {
+            length--;
+        }
+    }
+    size_t span = length + 1;
+
+    if (count_ == max_messages_) {
+        DropOldest();
+    }
+
+    // Text is written sequentially, so the bytes after the tail always belong to the oldest messages
+    size_t offset = text_tail_;
+    size_t skipped_end = text_tail_;
+    if (offset + span > text_capacity_) {
+        offset = 0;
+        skipped_end = text_capacity_;
+    }
+    auto overlaps = [](size_t start, size_t end, const Entry& entry) {
+        return entry.offset < end && start < entry.offset + entry.length + 1u;
+    };
+    while (count_ > 0) {
+        const Entry& oldest = EntryAt(first_seq_);
+        if (!overlaps(offset, offset + span, oldest) && !overlaps(text_tail_, skipped_end, oldest)) {
+            break;
+        }
+        DropOldest();
+    }
+
+    memcpy(text_ + offset, text, length);
+    text_[offset + length] = '\0';
+    text_tail_ = offset + span;
+
+    uint32_t seq = end_seq();
+    Entry& entry = EntryAt(seq);
+    entry.offset = offset;
+    entry.length = length;
+    entry.role = role;
+    entry.text_width = kTextWidthUnknown;
+    count_++;
+    return seq;
+}
+
+void ChatHistory::RemoveLast() {
+    if (count_ == 0) {
+        return;
+    }
+    count_--;
+    text_tail_ = EntryAt(end_seq()).offset;
+}
+
+bool ChatHistory::Get(uint32_t seq, Message& message) const {
+    if (count_ == 0 || seq < first_seq_ || seq >= end_seq()) {
+        return false;
+    }
+    const Entry& entry = EntryAt(seq);
+    message.text = text_ + entry.offset;
+    message.length = entry.length;
+    message.role = entry.role;
+    message.text_width = entry.text_width;
+    return true;
+}
+
+void ChatHistory::SetTextWidth(uint32_t seq, int16_t text_width) {
+    if (count_ == 0 || seq < first_seq_ || seq >= end_seq()) {
+        return;
+    }
+    EntryAt(seq).text_width = text_width;
+}
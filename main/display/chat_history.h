@@ -0,0 +1,68 @@
+#ifndef CHAT_HISTORY_H
+#define CHAT_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum ChatRole : uint8_t {
+    kChatRoleUser,
+    kChatRoleAssistant,
+    kChatRoleSystem,
+};
+
+/*
+ * Chat messages kept as plain text in a fixed byte ring instead of one LVGL
+ * widget tree per message. Messages are addressed by a monotonically growing
+ * sequence number, the oldest ones are dropped once text or slots run out.
+ */
+class ChatHistory {
+public:
+    static constexpr int16_t kTextWidthUnknown = -1;
+
+    struct Message {
+        const char* text;
+        uint16_t length;
+        ChatRole role;
+        int16_t text_width;     // Cached lv_txt_get_width result
+    };
+
+    ChatHistory(size_t text_capacity, size_t max_messages);
+    ~ChatHistory();
+
+    ChatHistory(const ChatHistory&) = delete;
+    ChatHistory& operator=(const ChatHistory&) = delete;
+
+    // Returns the sequence number of the new message
+    uint32_t Append(ChatRole role, const char* text);
+    // Drops the newest message, used to collapse consecutive system messages
+    void RemoveLast();
+    bool Get(uint32_t seq, Message& message) const;
+    void SetTextWidth(uint32_t seq, int16_t text_width);
+
+    uint32_t first_seq() const { return first_seq_; }
+    uint32_t end_seq() const { return first_seq_ + count_; }
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+private:
+    struct Entry {
+        uint32_t offset;
+        uint16_t length;
+        ChatRole role;
+        int16_t text_width;
+    };
+
+    Entry& EntryAt(uint32_t seq) const { return entries_[seq % max_messages_]; }
+    void DropOldest();
+
+    char* text_ = nullptr;
+    size_t text_capacity_;
+    Entry* entries_ = nullptr;
+    size_t max_messages_;
+    uint32_t first_seq_ = 0;
+    size_t count_ = 0;
+    // Where the next message text goes, the oldest live text starts at the first entry's offset
+    size_t text_tail_ = 0;
+};
+
+#endif // CHAT_HISTORY_H
@@ -1,6 +1,7 @@
 #include <esp_log.h>
 #include <esp_err.h>
 #include <string>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
@@ -14,7 +15,20 @@
 
 #define TAG "Display"
 
+// Pending updates are applied at roughly the LVGL refresh rate
+#define DISPLAY_UPDATE_PERIOD_MS    33
+#define MAX_PENDING_CHAT_MESSAGES   8
+
+// Status bar sources are polled at their own cadence
+#define BATTERY_POLL_INTERVAL_US                (5 * 1000 * 1000)
+#define BATTERY_POLL_POWER_SAVE_INTERVAL_US     (30 * 1000 * 1000)
+#define NETWORK_POLL_MIN_INTERVAL_US            (10 * 1000 * 1000)
+#define NETWORK_POLL_MAX_INTERVAL_US            (60 * 1000 * 1000)
+
 Display::Display() {
+    network_poll_interval_us_ = NETWORK_POLL_MIN_INTERVAL_US;
+    status_statistics_start_us_ = esp_timer_get_time();
+
     // Notification timer
     esp_timer_create_args_t notification_timer_args = {
         .callback = [](void *arg) {
@@ -40,6 +54,9 @@ Display::Display() {
 }
 
 Display::~Display() {
+    if (update_timer_ != nullptr && lv_is_initialized()) {
+        lv_timer_delete(update_timer_);
+    }
     if (notification_timer_ != nullptr) {
         esp_timer_stop(notification_timer_);
         esp_timer_delete(notification_timer_);
@@ -61,14 +78,168 @@ Display::~Display() {
     }
 }
 
+void Display::StartUpdateTimer() {
+    DisplayLockGuard lock(this);
+    if (update_timer_ != nullptr) {
+        return;
+    }
+    update_timer_ = lv_timer_create([](lv_timer_t* timer) {
+        auto display = static_cast<Display*>(lv_timer_get_user_data(timer));
+        display->ApplyPendingUpdates();
+    }, DISPLAY_UPDATE_PERIOD_MS, this);
+}
+
+bool Display::ShouldDefer() {
+    // Before the first timer tick the LVGL task is unknown, so everything is posted
+    return update_timer_ != nullptr && xTaskGetCurrentTaskHandle() != lvgl_task_;
+}
+
+void Display::PostStatus(const char* status) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (pending_.status_dirty) {
+            coalesced_updates_++;
+        }
+        pending_.status_dirty = true;
+        pending_.status = status;
+    }
+    has_pending_updates_ = true;
+}
+
+void Display::PostNotification(const char* notification, int duration_ms) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (pending_.notification_dirty) {
+            coalesced_updates_++;
+        }
+        pending_.notification_dirty = true;
+        pending_.notification = notification;
+        pending_.notification_duration_ms = duration_ms;
+    }
+    has_pending_updates_ = true;
+}
+
+void Display::PostEmotion(const char* emotion, bool is_icon) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (pending_.emotion_dirty) {
+            coalesced_updates_++;
+        }
+        pending_.emotion_dirty = true;
+        pending_.emotion_is_icon = is_icon;
+        pending_.emotion = emotion;
+    }
+    has_pending_updates_ = true;
+}
+
+void Display::PostChatMessage(const char* role, const char* content) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        auto& messages = pending_.chat_messages;
+        // Consecutive system messages collapse on screen, so only the last one is kept
+        if (strcmp(role, "system") == 0 && content[0] != '\0' &&
+            !messages.empty() && messages.back().first == "system" && !messages.back().second.empty()) {
+            messages.back().second = content;
+            coalesced_updates_++;
+        } else {
+            if (messages.size() >= MAX_PENDING_CHAT_MESSAGES) {
+                messages.erase(messages.begin());
+                coalesced_updates_++;
+            }
+            messages.emplace_back(role, content);
+        }
+    }
+    has_pending_updates_ = true;
+}
+
+void Display::ApplyPendingUpdates() {
+    lvgl_task_ = xTaskGetCurrentTaskHandle();
+    if (!has_pending_updates_.exchange(false)) {
+        return;
+    }
+
+    PendingUpdates updates;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        std::swap(updates, pending_);
+    }
+
+    // Running on the LVGL task, so these apply immediately
+    // Status first, it would hide a notification posted in the same frame. The status
+    // text stays underneath and shows again when the notification times out.
+    if (updates.status_dirty) {
+        SetStatus(updates.status.c_str());
+    }
+    if (updates.notification_dirty) {
+        ShowNotification(updates.notification.c_str(), updates.notification_duration_ms);
+    }
+    if (updates.emotion_dirty) {
+        if (updates.emotion_is_icon) {
+            SetIcon(updates.emotion.c_str());
+        } else {
+            SetEmotion(updates.emotion.c_str());
+        }
+    }
+    for (auto& [role, content] : updates.chat_messages) {
+        SetChatMessage(role.c_str(), content.c_str());
+    }
+}
+
+void Display::PrintStatistics() {
+    uint32_t lock_count;
+    int64_t lock_wait_total_us, lock_wait_max_us;
+    {
+        DisplayLockGuard lock(this);
+        lock_count = lock_count_;
+        lock_wait_total_us = lock_wait_total_us_;
+        lock_wait_max_us = lock_wait_max_us_;
+        lock_count_ = 0;
+        lock_wait_total_us_ = 0;
+        lock_wait_max_us_ = 0;
+    }
+    uint32_t coalesced_updates;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        coalesced_updates = coalesced_updates_;
+        coalesced_updates_ = 0;
+    }
+    ESP_LOGI(TAG, "Lock: count=%lu avg_wait=%lldus max_wait=%lldus coalesced_updates=%lu",
+        (unsigned long)lock_count, (long long)(lock_count > 0 ? lock_wait_total_us / lock_count : 0),
+        (long long)lock_wait_max_us, (unsigned long)coalesced_updates);
+
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed_us = now - status_statistics_start_us_;
+    status_statistics_start_us_ = now;
+    if (elapsed_us > 0) {
+        auto per_minute = [elapsed_us](uint32_t count) {
+            return (unsigned long)(count * 60000000LL / elapsed_us);
+        };
+        ESP_LOGI(TAG, "Status bar per minute: redraws=%lu battery_queries=%lu network_queries=%lu%s",
+            per_minute(status_redraws_.exchange(0)), per_minute(battery_queries_.exchange(0)),
+            per_minute(network_queries_.exchange(0)), power_save_ ? " (power save)" : "");
+    }
+}
+
 void Display::SetStatus(const char* status) {
+    if (ShouldDefer()) {
+        PostStatus(status);
+        return;
+    }
     DisplayLockGuard lock(this);
     if (status_label_ == nullptr) {
         return;
     }
-    lv_label_set_text(status_label_, status);
-    lv_obj_clear_flag(status_label_, LV_OBJ_FLAG_HIDDEN);
-    lv_obj_add_flag(notification_label_, LV_OBJ_FLAG_HIDDEN);
+    // Setting the same text or flags still invalidates the area, so only touch what changed
+    if (strcmp(lv_label_get_text(status_label_), status) != 0) {
+        lv_label_set_text(status_label_, status);
+        status_redraws_++;
+    }
+    if (lv_obj_has_flag(status_label_, LV_OBJ_FLAG_HIDDEN)) {
+        lv_obj_clear_flag(status_label_, LV_OBJ_FLAG_HIDDEN);
+    }
+    if (!lv_obj_has_flag(notification_label_, LV_OBJ_FLAG_HIDDEN)) {
+        lv_obj_add_flag(notification_label_, LV_OBJ_FLAG_HIDDEN);
+    }
 
     last_status_update_time_ = std::chrono::system_clock::now();
 }
@@ -78,6 +249,10 @@ void Display::ShowNotification(const std::string &notification, int duration_ms)
 }
 
 void Display::ShowNotification(const char* notification, int duration_ms) {
+    if (ShouldDefer()) {
+        PostNotification(notification, duration_ms);
+        return;
+    }
     DisplayLockGuard lock(this);
     if (notification_label_ == nullptr) {
         return;
@@ -90,26 +265,46 @@ void Display::ShowNotification(const char* notification, int duration_ms) {
     ESP_ERROR_CHECK(esp_timer_start_once(notification_timer_, duration_ms * 1000));
 }
 
+static const char* GetBatteryIcon(int level, bool charging) {
+    if (charging) {
+        return FONT_AWESOME_BATTERY_CHARGING;
+    }
+    const char* levels[] = {
+        FONT_AWESOME_BATTERY_EMPTY, // 0-19%
+        FONT_AWESOME_BATTERY_1,    // 20-39%
+        FONT_AWESOME_BATTERY_2,    // 40-59%
+        FONT_AWESOME_BATTERY_3,    // 60-79%
+        FONT_AWESOME_BATTERY_FULL, // 80-99%
+        FONT_AWESOME_BATTERY_FULL, // 100%
+    };
+    return levels[std::clamp(level, 0, 100) / 20];
+}
+
+void Display::NotifyNetworkChanged() {
+    network_changed_ = true;
+}
+
 void Display::UpdateStatusBar(bool update_all) {
     auto& app = Application::GetInstance();
     auto& board = Board::GetInstance();
     auto codec = board.GetAudioCodec();
 
-    // Update mute icon
-    {
-        DisplayLockGuard lock(this);
-        if (mute_label_ == nullptr) {
-            return;
-        }
+    // Displays without a status bar have nothing to update
+    if (mute_label_ == nullptr) {
+        return;
+    }
 
-        // Update icon if mute status changes
-        if (codec->output_volume() == 0 && !muted_) {
-            muted_ = true;
-            lv_label_set_text(mute_label_, FONT_AWESOME_VOLUME_MUTE);
-        } else if (codec->output_volume() > 0 && muted_) {
-            muted_ = false;
-            lv_label_set_text(mute_label_, "");
-        }
+    std::lock_guard<std::mutex> status_lock(status_bar_mutex_);
+    int64_t now_us = esp_timer_get_time();
+    bool power_save = power_save_;
+
+    // Update mute icon, only the cheap volume read happens every second
+    bool muted = codec->output_volume() == 0;
+    if (muted != muted_) {
+        DisplayLockGuard lock(this);
+        muted_ = muted;
+        lv_label_set_text(mute_label_, muted_ ? FONT_AWESOME_VOLUME_MUTE : "");
+        status_redraws_++;
     }
 
     // Update time
@@ -129,51 +324,48 @@ void Display::UpdateStatusBar(bool update_all) {
         }
     }
 
+    bool poll_battery = update_all || now_us >= next_battery_poll_us_;
+    // In power save mode the modem is left alone unless it reported a change itself
+    bool poll_network = update_all || network_changed_ || (!power_save && now_us >= next_network_poll_us_);
+    if (!poll_battery && !poll_network) {
+        return;
+    }
+
     esp_pm_lock_acquire(pm_lock_);
     // Update battery icon
-    int battery_level;
-    bool charging, discharging;
-    const char* icon = nullptr;
-    if (board.GetBatteryLevel(battery_level, charging, discharging)) {
-        if (charging) {
-            icon = FONT_AWESOME_BATTERY_CHARGING;
-        } else {
-            const char* levels[] = {
-                FONT_AWESOME_BATTERY_EMPTY, // 0-19%
-                FONT_AWESOME_BATTERY_1,    // 20-39%
-                FONT_AWESOME_BATTERY_2,    // 40-59%
-                FONT_AWESOME_BATTERY_3,    // 60-79%
-                FONT_AWESOME_BATTERY_FULL, // 80-99%
-                FONT_AWESOME_BATTERY_FULL, // 100%
-            };
-            icon = levels[battery_level / 20];
-        }
-        DisplayLockGuard lock(this);
-        if (battery_label_ != nullptr && battery_icon_ != icon) {
-            battery_icon_ = icon;
-            lv_label_set_text(battery_label_, battery_icon_);
-        }
-
-        if (low_battery_popup_ != nullptr) {
-            if (strcmp(icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && discharging) {
-                if (lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) { // If low battery popup is hidden, show it
-                    lv_obj_clear_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
-                    app.PlaySound(Lang::Sounds::P3_LOW_BATTERY);
+    if (poll_battery) {
+        next_battery_poll_us_ = now_us + (power_save ? BATTERY_POLL_POWER_SAVE_INTERVAL_US : BATTERY_POLL_INTERVAL_US);
+        battery_queries_++;
+        int battery_level;
+        bool charging, discharging;
+        if (board.GetBatteryLevel(battery_level, charging, discharging)) {
+            const char* icon = GetBatteryIcon(battery_level, charging);
+            bool low_battery = strcmp(icon, FONT_AWESOME_BATTERY_EMPTY) == 0 && discharging;
+            if (battery_icon_ != icon || low_battery_shown_ != low_battery) {
+                DisplayLockGuard lock(this);
+                if (battery_label_ != nullptr && battery_icon_ != icon) {
+                    battery_icon_ = icon;
+                    lv_label_set_text(battery_label_, battery_icon_);
+                    status_redraws_++;
                 }
-            } else {
-                // Hide the low battery popup when the battery is not empty
-                if (!lv_obj_has_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN)) { // If low battery popup is shown, hide it
-                    lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+                if (low_battery_popup_ != nullptr && low_battery_shown_ != low_battery) {
+                    low_battery_shown_ = low_battery;
+                    if (low_battery) {
+                        lv_obj_clear_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+                        app.PlaySound(Lang::Sounds::P3_LOW_BATTERY);
+                    } else {
+                        lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+                    }
+                    status_redraws_++;
                 }
             }
         }
     }
 
-    // Update network icon every 10 seconds
-    static int seconds_counter = 0;
-    if (update_all || seconds_counter++ % 10 == 0) {
+    // Update network icon, backing off while the signal stays the same
+    if (poll_network) {
         // Don't read 4G network status during firmware upgrade to avoid occupying UART resources
-        auto device_state = Application::GetInstance().GetDeviceState();
+        auto device_state = app.GetDeviceState();
         static const std::vector<DeviceState> allowed_states = {
             kDeviceStateIdle,
             kDeviceStateStarting,
@@ -182,19 +374,29 @@ void Display::UpdateStatusBar(bool update_all) {
             kDeviceStateActivating,
         };
         if (std::find(allowed_states.begin(), allowed_states.end(), device_state) != allowed_states.end()) {
-            icon = board.GetNetworkStateIcon();
-            if (network_label_ != nullptr && icon != nullptr && network_icon_ != icon) {
+            bool forced = update_all || network_changed_.exchange(false);
+            network_queries_++;
+            const char* icon = board.GetNetworkStateIcon();
+            if (icon != nullptr && network_icon_ != icon) {
+                network_poll_interval_us_ = NETWORK_POLL_MIN_INTERVAL_US;
                 DisplayLockGuard lock(this);
-                network_icon_ = icon;
-                lv_label_set_text(network_label_, network_icon_);
+                if (network_label_ != nullptr) {
+                    network_icon_ = icon;
+                    lv_label_set_text(network_label_, network_icon_);
+                    status_redraws_++;
+                }
+            } else if (forced) {
+                network_poll_interval_us_ = NETWORK_POLL_MIN_INTERVAL_US;
+            } else {
+                network_poll_interval_us_ = std::min<int64_t>(network_poll_interval_us_ * 2, NETWORK_POLL_MAX_INTERVAL_US);
             }
         }
+        next_network_poll_us_ = now_us + network_poll_interval_us_;
     }
 
     esp_pm_lock_release(pm_lock_);
 }
 
-
 void Display::SetEmotion(const char* emotion) {
     struct Emotion {
         const char* icon;
@@ -225,6 +427,11 @@ void Display::SetEmotion(const char* emotion) {
         {FONT_AWESOME_EMOJI_CONFUSED, "confused"}
     };
     
+    if (ShouldDefer()) {
+        PostEmotion(emotion, false);
+        return;
+    }
+
     // Find matching emotion
     std::string_view emotion_view(emotion);
     auto it = std::find_if(emotions.begin(), emotions.end(),
@@ -244,6 +451,10 @@ void Display::SetEmotion(const char* emotion) {
 }
 
 void Display::SetIcon(const char* icon) {
+    if (ShouldDefer()) {
+        PostEmotion(icon, true);
+        return;
+    }
     DisplayLockGuard lock(this);
     if (emotion_label_ == nullptr) {
         return;
@@ -255,7 +466,15 @@ void Display::SetPreviewImage(const lv_img_dsc_t* image) {
     // Do nothing
 }
 
+void Display::SetSharedPreviewImage(std::shared_ptr<const lv_img_dsc_t> image) {
+    SetPreviewImage(image.get());
+}
+
 void Display::SetChatMessage(const char* role, const char* content) {
+    if (ShouldDefer()) {
+        PostChatMessage(role, content);
+        return;
+    }
     DisplayLockGuard lock(this);
     if (chat_message_label_ == nullptr) {
         return;
@@ -270,6 +489,7 @@ void Display::SetTheme(const std::string& theme_name) {
 }
 
 void Display::SetPowerSaveMode(bool on) {
+    power_save_ = on;
     if (on) {
         SetChatMessage("system", "");
         SetEmotion("sleepy");
@@ -6,8 +6,16 @@
 #include <esp_log.h>
 #include <esp_pm.h>
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
 #include <string>
 #include <chrono>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <utility>
+#include <memory>
 
 struct DisplayFonts {
     const lv_font_t* text_font = nullptr;
@@ -27,10 +35,15 @@ public:
     virtual void SetChatMessage(const char* role, const char* content);
     virtual void SetIcon(const char* icon);
     virtual void SetPreviewImage(const lv_img_dsc_t* image);
+    // Shows an image without copying it, the display keeps a reference for as long as it is visible
+    virtual void SetSharedPreviewImage(std::shared_ptr<const lv_img_dsc_t> image);
     virtual void SetTheme(const std::string& theme_name);
     virtual std::string GetTheme() { return current_theme_name_; }
     virtual void UpdateStatusBar(bool update_all = false);
+    // Forces the network icon to be refreshed on the next status bar update
+    void NotifyNetworkChanged();
     virtual void SetPowerSaveMode(bool on);
+    virtual void PrintStatistics();
 
     inline int width() const { return width_; }
     inline int height() const { return height_; }
@@ -55,11 +68,61 @@ protected:
     const char* battery_icon_ = nullptr;
     const char* network_icon_ = nullptr;
     bool muted_ = false;
+    bool low_battery_shown_ = false;
+
+    // Status bar polling state, guarded by status_bar_mutex_
+    std::mutex status_bar_mutex_;
+    int64_t next_battery_poll_us_ = 0;
+    int64_t next_network_poll_us_ = 0;
+    int64_t network_poll_interval_us_ = 0;
+    std::atomic<bool> network_changed_ = false;
+    std::atomic<bool> power_save_ = false;
+    std::atomic<uint32_t> status_redraws_ = 0;
+    std::atomic<uint32_t> battery_queries_ = 0;
+    std::atomic<uint32_t> network_queries_ = 0;
+    int64_t status_statistics_start_us_ = 0;
     std::string current_theme_name_;
 
     std::chrono::system_clock::time_point last_status_update_time_;
     esp_timer_handle_t notification_timer_ = nullptr;
 
+    /*
+     * Updates from other tasks are posted here and applied by the LVGL task once per
+     * frame, so callers never wait for the display lock. Only the latest status,
+     * notification and emotion survive, chat messages keep their order.
+     */
+    struct PendingUpdates {
+        bool status_dirty = false;
+        std::string status;
+        bool notification_dirty = false;
+        std::string notification;
+        int notification_duration_ms = 0;
+        bool emotion_dirty = false;
+        bool emotion_is_icon = false;
+        std::string emotion;
+        std::vector<std::pair<std::string, std::string>> chat_messages;
+    };
+    std::mutex pending_mutex_;
+    PendingUpdates pending_;
+    std::atomic<bool> has_pending_updates_ = false;
+    lv_timer_t* update_timer_ = nullptr;
+    std::atomic<TaskHandle_t> lvgl_task_ = nullptr;
+    uint32_t coalesced_updates_ = 0;
+
+    // Lock wait statistics, only touched while the display lock is held
+    uint32_t lock_count_ = 0;
+    int64_t lock_wait_total_us_ = 0;
+    int64_t lock_wait_max_us_ = 0;
+
+    // Called by LVGL based displays once their UI is set up
+    void StartUpdateTimer();
+    bool ShouldDefer();
+    void PostStatus(const char* status);
+    void PostNotification(const char* notification, int duration_ms);
+    void PostEmotion(const char* emotion, bool is_icon);
+    void PostChatMessage(const char* role, const char* content);
+    void ApplyPendingUpdates();
+
     friend class DisplayLockGuard;
     virtual bool Lock(int timeout_ms = 0) = 0;
     virtual void Unlock() = 0;
@@ -69,8 +132,16 @@ protected:
 class DisplayLockGuard {
 public:
     DisplayLockGuard(Display *display) : display_(display) {
+        int64_t start_time = esp_timer_get_time();
         if (!display_->Lock(30000)) {
             ESP_LOGE("Display", "Failed to lock display");
+            return;
+        }
+        int64_t wait_us = esp_timer_get_time() - start_time;
+        display_->lock_count_++;
+        display_->lock_wait_total_us_ += wait_us;
+        if (wait_us > display_->lock_wait_max_us_) {
+            display_->lock_wait_max_us_ = wait_us;
         }
     }
     ~DisplayLockGuard() {
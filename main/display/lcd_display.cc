@@ -7,6 +7,8 @@
 #include <esp_err.h>
 #include <esp_lvgl_port.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <soc/soc_caps.h>
 #include "assets/lang_config.h"
 #include <cstring>
 #include "settings.h"
@@ -15,6 +17,43 @@
 
 #define TAG "LcdDisplay"
 
+// Draw buffers never take more than this share of the free DMA capable internal RAM
+#define BUFFER_INTERNAL_BUDGET_DIVISOR  4
+// The display is set up before Wi-Fi, AFE and Opus allocate, so free RAM at that point
+// overstates what can be spared. Total internal draw buffer bytes are also capped per target.
+#if CONFIG_IDF_TARGET_ESP32P4
+#define BUFFER_INTERNAL_MAX_BYTES       (128 * 1024)
+#elif CONFIG_IDF_TARGET_ESP32S3
+#define BUFFER_INTERNAL_MAX_BYTES       (24 * 1024)
+#else
+#define BUFFER_INTERNAL_MAX_BYTES       (16 * 1024)
+#endif
+// Double buffering is only worth it when each strip still has a reasonable height
+#define MIN_DOUBLE_BUFFER_LINES         20
+#define MIN_SINGLE_BUFFER_LINES         10
+#define DEFAULT_BUFFER_LINES            20
+// Slow buses gain nothing from taller strips once rendering overlaps the transfer
+#define SPI_MAX_BUFFER_LINES            40
+#define QSPI_MAX_BUFFER_LINES           80
+#define MIPI_MAX_BUFFER_LINES           120
+
+#if CONFIG_SPIRAM
+#define CHAT_HISTORY_MAX_MESSAGES   500
+#define CHAT_HISTORY_TEXT_SIZE      (32 * 1024)
+#else
+#define CHAT_HISTORY_MAX_MESSAGES   64
+#define CHAT_HISTORY_TEXT_SIZE      (6 * 1024)
+#endif
+#if CONFIG_IDF_TARGET_ESP32P4
+#define CHAT_MAX_VISIBLE_ROWS       24
+#else
+#define CHAT_MAX_VISIBLE_ROWS       12
+#endif
+// Bubble padding, border and row spacing around a single line of text
+#define CHAT_ROW_DECORATION_HEIGHT  28
+// Image bubbles are not recycled, keep only the most recent ones
+#define CHAT_MAX_IMAGE_BUBBLES      2
+
 // Color definitions for dark theme
 #define DARK_BACKGROUND_COLOR       lv_color_hex(0x121212)     // Dark background
 #define DARK_TEXT_COLOR             lv_color_white()           // White text
@@ -68,7 +107,11 @@ const ThemeColors LIGHT_THEME = {
 LV_FONT_DECLARE(font_awesome_30_4);
 
 LcdDisplay::LcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel, DisplayFonts fonts, int width, int height)
-    : panel_io_(panel_io), panel_(panel), fonts_(fonts) {
+    : panel_io_(panel_io), panel_(panel), fonts_(fonts)
+#if CONFIG_USE_WECHAT_MESSAGE_STYLE
+    , chat_history_(CHAT_HISTORY_TEXT_SIZE, CHAT_HISTORY_MAX_MESSAGES)
+#endif
+{
     width_ = width;
     height_ = height;
 
@@ -84,20 +127,127 @@ LcdDisplay::LcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_
     }
 }
 
-SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel,
-                           int width, int height, int offset_x, int offset_y, bool mirror_x, bool mirror_y, bool swap_xy,
-                           DisplayFonts fonts)
-    : LcdDisplay(panel_io, panel, fonts, width, height) {
+LcdBufferStrategy LcdDisplay::ChooseBufferStrategy(LcdBusType bus, int width, int height) {
+    LcdBufferStrategy strategy;
+    if (bus == kLcdBusRgb) {
+        // RGB panels scan out of their own frame buffers, LVGL renders straight into them
+        strategy.double_buffer = true;
+        strategy.full_refresh = true;
+        return strategy;
+    }
+
+    uint32_t max_lines = MIPI_MAX_BUFFER_LINES;
+    if (bus == kLcdBusSpi) {
+        max_lines = SPI_MAX_BUFFER_LINES;
+    } else if (bus == kLcdBusQspi) {
+        max_lines = QSPI_MAX_BUFFER_LINES;
+    }
+    max_lines = std::min<uint32_t>(max_lines, height);
+
+    size_t line_bytes = width * sizeof(uint16_t);
+    size_t budget = std::min<size_t>(heap_caps_get_free_size(MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL) / BUFFER_INTERNAL_BUDGET_DIVISOR,
+        BUFFER_INTERNAL_MAX_BYTES);
+    size_t largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    uint32_t budget_lines = std::min(budget / 2, largest_block) / line_bytes;
+
+    // Two buffers let the CPU render the next strip while DMA still sends the previous one
+    if (budget_lines >= MIN_DOUBLE_BUFFER_LINES) {
+        strategy.double_buffer = true;
+        strategy.buffer_lines = std::min(budget_lines, max_lines);
+        return strategy;
+    }
 
+#if SOC_PSRAM_DMA_CAPABLE
+    if (heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA) >= max_lines * line_bytes * 2) {
+        strategy.double_buffer = true;
+        strategy.buff_spiram = true;
+        strategy.buffer_lines = max_lines;
+        return strategy;
+    }
+#endif
+
+    // Low on memory, keep a single strip in internal RAM like before
+    budget_lines = std::min(budget, largest_block) / line_bytes;
+    strategy.buffer_lines = std::max<uint32_t>(MIN_SINGLE_BUFFER_LINES,
+        std::min<uint32_t>(budget_lines, DEFAULT_BUFFER_LINES));
+    strategy.buffer_lines = std::min(strategy.buffer_lines, max_lines);
+    return strategy;
+}
+
+void LcdDisplay::RegisterRenderStatistics() {
+    ESP_LOGI(TAG, "Draw buffer: %lu lines, %s, %s%s", (unsigned long)buffer_strategy_.buffer_lines,
+        buffer_strategy_.double_buffer ? "double" : "single", buffer_strategy_.buff_spiram ? "PSRAM" : "internal",
+        buffer_strategy_.full_refresh ? ", full refresh" : "");
+
+    statistics_start_time_ = esp_timer_get_time();
+    lv_display_add_event_cb(display_, [](lv_event_t* e) {
+        auto display = static_cast<LcdDisplay*>(lv_event_get_user_data(e));
+        int64_t now = esp_timer_get_time();
+        auto& stats = display->render_statistics_;
+        switch (lv_event_get_code(e)) {
+            case LV_EVENT_RENDER_START:
+                display->render_start_time_ = now;
+                break;
+            case LV_EVENT_RENDER_READY: {
+                int64_t render_us = now - display->render_start_time_;
+                stats.frames++;
+                stats.total_render_us += render_us;
+                stats.max_render_us = std::max(stats.max_render_us, render_us);
+                break;
+            }
+            case LV_EVENT_FLUSH_START:
+                stats.flushes++;
+                break;
+            case LV_EVENT_FLUSH_WAIT_START:
+                display->flush_wait_start_time_ = now;
+                break;
+            case LV_EVENT_FLUSH_WAIT_FINISH: {
+                int64_t wait_us = now - display->flush_wait_start_time_;
+                stats.total_flush_wait_us += wait_us;
+                stats.max_flush_wait_us = std::max(stats.max_flush_wait_us, wait_us);
+                break;
+            }
+            default:
+                break;
+        }
+    }, LV_EVENT_ALL, this);
+}
+
+void LcdDisplay::PrintStatistics() {
+    Display::PrintStatistics();
+
+    LcdRenderStatistics stats;
+    int64_t elapsed_us;
+    {
+        DisplayLockGuard lock(this);
+        int64_t now = esp_timer_get_time();
+        stats = render_statistics_;
+        elapsed_us = now - statistics_start_time_;
+        render_statistics_ = LcdRenderStatistics();
+        statistics_start_time_ = now;
+    }
+    if (stats.frames == 0 || elapsed_us <= 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "Render: fps=%.1f flushes=%lu avg_render=%lldus max_render=%lldus avg_flush_wait=%lldus max_flush_wait=%lldus",
+        stats.frames * 1000000.0f / elapsed_us, (unsigned long)stats.flushes,
+        (long long)(stats.total_render_us / stats.frames), (long long)stats.max_render_us,
+        (long long)(stats.flushes > 0 ? stats.total_flush_wait_us / stats.flushes : 0), (long long)stats.max_flush_wait_us);
+}
+
+// Shared by SPI and QSPI panels, both are driven through esp_lcd_panel_draw_bitmap over a serial bus
+static lv_display_t* AddSerialDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel,
+                                      int width, int height, bool mirror_x, bool mirror_y, bool swap_xy,
+                                      const LcdBufferStrategy& strategy) {
     // draw white
-    std::vector<uint16_t> buffer(width_, 0xFFFF);
-    for (int y = 0; y < height_; y++) {
-        esp_lcd_panel_draw_bitmap(panel_, 0, y, width_, y + 1, buffer.data());
+    std::vector<uint16_t> buffer(width, 0xFFFF);
+    for (int y = 0; y < height; y++) {
+        esp_lcd_panel_draw_bitmap(panel, 0, y, width, y + 1, buffer.data());
     }
 
     // Set the display to on
     ESP_LOGI(TAG, "Turning display on");
-    ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_, true));
+    ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel, true));
 
     ESP_LOGI(TAG, "Initialize LVGL library");
     lv_init();
@@ -110,14 +260,14 @@ SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
 
     ESP_LOGI(TAG, "Adding LCD display");
     const lvgl_port_display_cfg_t display_cfg = {
-        .io_handle = panel_io_,
-        .panel_handle = panel_,
+        .io_handle = panel_io,
+        .panel_handle = panel,
         .control_handle = nullptr,
-        .buffer_size = static_cast<uint32_t>(width_ * 20),
-        .double_buffer = false,
+        .buffer_size = static_cast<uint32_t>(width) * strategy.buffer_lines,
+        .double_buffer = strategy.double_buffer,
         .trans_size = 0,
-        .hres = static_cast<uint32_t>(width_),
-        .vres = static_cast<uint32_t>(height_),
+        .hres = static_cast<uint32_t>(width),
+        .vres = static_cast<uint32_t>(height),
         .monochrome = false,
         .rotation = {
             .swap_xy = swap_xy,
@@ -126,16 +276,24 @@ SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
         },
         .color_format = LV_COLOR_FORMAT_RGB565,
         .flags = {
-            .buff_dma = 1,
-            .buff_spiram = 0,
+            .buff_dma = strategy.buff_dma,
+            .buff_spiram = strategy.buff_spiram,
             .sw_rotate = 0,
             .swap_bytes = 1,
-            .full_refresh = 0,
+            .full_refresh = strategy.full_refresh,
             .direct_mode = 0,
         },
     };
 
-    display_ = lvgl_port_add_disp(&display_cfg);
+    return lvgl_port_add_disp(&display_cfg);
+}
+
+SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel,
+                           int width, int height, int offset_x, int offset_y, bool mirror_x, bool mirror_y, bool swap_xy,
+                           DisplayFonts fonts)
+    : LcdDisplay(panel_io, panel, fonts, width, height) {
+    buffer_strategy_ = ChooseBufferStrategy(kLcdBusSpi, width_, height_);
+    display_ = AddSerialDisplay(panel_io_, panel_, width_, height_, mirror_x, mirror_y, swap_xy, buffer_strategy_);
     if (display_ == nullptr) {
         ESP_LOGE(TAG, "Failed to add display");
         return;
@@ -145,6 +303,26 @@ SpiLcdDisplay::SpiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
         lv_display_set_offset(display_, offset_x, offset_y);
     }
 
+    RegisterRenderStatistics();
+    SetupUI();
+}
+
+QspiLcdDisplay::QspiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handle_t panel,
+                           int width, int height, int offset_x, int offset_y, bool mirror_x, bool mirror_y, bool swap_xy,
+                           DisplayFonts fonts)
+    : LcdDisplay(panel_io, panel, fonts, width, height) {
+    buffer_strategy_ = ChooseBufferStrategy(kLcdBusQspi, width_, height_);
+    display_ = AddSerialDisplay(panel_io_, panel_, width_, height_, mirror_x, mirror_y, swap_xy, buffer_strategy_);
+    if (display_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to add display");
+        return;
+    }
+
+    if (offset_x != 0 || offset_y != 0) {
+        lv_display_set_offset(display_, offset_x, offset_y);
+    }
+
+    RegisterRenderStatistics();
     SetupUI();
 }
 
@@ -171,11 +349,12 @@ RgbLcdDisplay::RgbLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
     lvgl_port_init(&port_cfg);
 
     ESP_LOGI(TAG, "Adding LCD display");
+    buffer_strategy_ = ChooseBufferStrategy(kLcdBusRgb, width_, height_);
     const lvgl_port_display_cfg_t display_cfg = {
         .io_handle = panel_io_,
         .panel_handle = panel_,
-        .buffer_size = static_cast<uint32_t>(width_ * 20),
-        .double_buffer = true,
+        .buffer_size = static_cast<uint32_t>(width_) * buffer_strategy_.buffer_lines,
+        .double_buffer = buffer_strategy_.double_buffer,
         .hres = static_cast<uint32_t>(width_),
         .vres = static_cast<uint32_t>(height_),
         .rotation = {
@@ -186,7 +365,7 @@ RgbLcdDisplay::RgbLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
         .flags = {
             .buff_dma = 1,
             .swap_bytes = 0,
-            .full_refresh = 1,
+            .full_refresh = buffer_strategy_.full_refresh,
             .direct_mode = 1,
         },
     };
@@ -208,6 +387,7 @@ RgbLcdDisplay::RgbLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_h
         lv_display_set_offset(display_, offset_x, offset_y);
     }
 
+    RegisterRenderStatistics();
     SetupUI();
 }
 
@@ -229,12 +409,13 @@ MipiLcdDisplay::MipiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel
     lvgl_port_init(&port_cfg);
 
     ESP_LOGI(TAG, "Adding LCD display");
+    buffer_strategy_ = ChooseBufferStrategy(kLcdBusMipi, width_, height_);
     const lvgl_port_display_cfg_t disp_cfg = {
             .io_handle = panel_io,
             .panel_handle = panel,
             .control_handle = nullptr,
-            .buffer_size = static_cast<uint32_t>(width_ * 50),
-            .double_buffer = false,
+            .buffer_size = static_cast<uint32_t>(width_) * buffer_strategy_.buffer_lines,
+            .double_buffer = buffer_strategy_.double_buffer,
             .hres = static_cast<uint32_t>(width_),
             .vres = static_cast<uint32_t>(height_),
             .monochrome = false,
@@ -245,8 +426,8 @@ MipiLcdDisplay::MipiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel
             .mirror_y = mirror_y,
         },
         .flags = {
-            .buff_dma = true,
-            .buff_spiram =false,
+            .buff_dma = buffer_strategy_.buff_dma,
+            .buff_spiram = buffer_strategy_.buff_spiram,
             .sw_rotate = false,
         },
     };
@@ -266,6 +447,7 @@ MipiLcdDisplay::MipiLcdDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel
         lv_display_set_offset(display_, offset_x, offset_y);
     }
 
+    RegisterRenderStatistics();
     SetupUI();
 }
 
@@ -347,8 +529,13 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_flex_align(content_, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START);
     lv_obj_set_style_pad_row(content_, 10, 0); // Space between messages
 
-    // We'll create chat messages dynamically in SetChatMessage
+    // Chat rows are created on demand in SetChatMessage and recycled once the pool is full
     chat_message_label_ = nullptr;
+    chat_row_pool_size_ = std::min<size_t>(CHAT_MAX_VISIBLE_ROWS,
+        height_ / (fonts_.text_font->line_height + CHAT_ROW_DECORATION_HEIGHT) + 2);
+    lv_obj_add_event_cb(content_, [](lv_event_t* e) {
+        static_cast<LcdDisplay*>(lv_event_get_user_data(e))->OnChatScrollEnd();
+    }, LV_EVENT_SCROLL_END, this);
 
     /* Status bar */
     lv_obj_set_flex_flow(status_bar_, LV_FLEX_FLOW_ROW);
@@ -412,295 +599,338 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_style_text_color(low_battery_label_, lv_color_white(), 0);
     lv_obj_center(low_battery_label_);
     lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+
+    StartUpdateTimer();
 }
-#if CONFIG_IDF_TARGET_ESP32P4
-#define  MAX_MESSAGES 40
-#else
-#define  MAX_MESSAGES 20
-#endif
-void LcdDisplay::SetChatMessage(const char* role, const char* content) {
-    DisplayLockGuard lock(this);
-    if (content_ == nullptr) {
+static const char* const CHAT_ROLE_NAMES[] = {"user", "assistant", "system"};
+
+lv_obj_t* LcdDisplay::CreateChatRow() {
+    // A full-width transparent row lets every role align its bubble the same way
+    lv_obj_t* row = lv_obj_create(content_);
+    lv_obj_set_width(row, LV_HOR_RES);
+    lv_obj_set_height(row, LV_SIZE_CONTENT);
+    lv_obj_set_style_bg_opa(row, LV_OPA_TRANSP, 0);
+    lv_obj_set_style_border_width(row, 0, 0);
+    lv_obj_set_style_pad_all(row, 0, 0);
+    lv_obj_clear_flag(row, LV_OBJ_FLAG_SCROLLABLE);
+
+    lv_obj_t* msg_bubble = lv_obj_create(row);
+    lv_obj_set_style_radius(msg_bubble, 8, 0);
+    lv_obj_set_scrollbar_mode(msg_bubble, LV_SCROLLBAR_MODE_OFF);
+    lv_obj_clear_flag(msg_bubble, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_border_width(msg_bubble, 1, 0);
+    lv_obj_set_style_pad_all(msg_bubble, 8, 0);
+    lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
+    lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
+    lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
+
+    lv_obj_t* msg_text = lv_label_create(msg_bubble);
+    lv_label_set_long_mode(msg_text, LV_LABEL_LONG_WRAP);
+    lv_obj_set_style_text_font(msg_text, fonts_.text_font, 0);
+    return row;
+}
+
+void LcdDisplay::BindChatRow(lv_obj_t* row, uint32_t seq) {
+    ChatHistory::Message message;
+    if (!chat_history_.Get(seq, message)) {
+        lv_obj_set_user_data(row, nullptr);
+        lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
         return;
     }
-    
-    // Avoid empty message boxes
-    if(strlen(content) == 0) return;
-    
-    // Check if message count exceeds limit
-    uint32_t child_count = lv_obj_get_child_cnt(content_);
-    if (child_count >= MAX_MESSAGES) {
-        // Delete the oldest message (first child object)
-        lv_obj_t* first_child = lv_obj_get_child(content_, 0);
-        lv_obj_t* last_child = lv_obj_get_child(content_, child_count - 1);
-        if (first_child != nullptr) {
-            lv_obj_del(first_child);
-        }
-        // Scroll to the last message immediately
-        if (last_child != nullptr) {
-            lv_obj_scroll_to_view_recursive(last_child, LV_ANIM_OFF);
+    // Remember which message the row shows, offset by one so that nullptr means unbound
+    lv_obj_set_user_data(row, (void*)(uintptr_t)(seq + 1));
+    lv_obj_clear_flag(row, LV_OBJ_FLAG_HIDDEN);
+
+    lv_obj_t* msg_bubble = lv_obj_get_child(row, 0);
+    lv_obj_t* msg_text = lv_obj_get_child(msg_bubble, 0);
+    lv_label_set_text(msg_text, message.text);
+
+    // Measuring is the expensive part of building a bubble, do it once per message
+    if (message.text_width == ChatHistory::kTextWidthUnknown) {
+        lv_coord_t text_width = lv_txt_get_width(message.text, message.length, fonts_.text_font, 0);
+        lv_coord_t max_width = LV_HOR_RES * 85 / 100 - 16;  // 屏幕宽度的85%
+        lv_coord_t min_width = 20;
+        message.text_width = std::clamp(text_width, min_width, max_width);
+        chat_history_.SetTextWidth(seq, message.text_width);
+    }
+    lv_obj_set_width(msg_text, message.text_width);
+
+    // Set custom property to mark bubble type, SetTheme relies on it
+    lv_obj_set_user_data(msg_bubble, (void*)CHAT_ROLE_NAMES[message.role]);
+    lv_obj_set_style_border_color(msg_bubble, current_theme_.border, 0);
+    switch (message.role) {
+        case kChatRoleUser:
+            // User messages are right-aligned with green background
+            lv_obj_set_style_bg_color(msg_bubble, current_theme_.user_bubble, 0);
+            lv_obj_set_style_text_color(msg_text, current_theme_.text, 0);
+            lv_obj_align(msg_bubble, LV_ALIGN_RIGHT_MID, -25, 0);
+            break;
+        case kChatRoleAssistant:
+            // Assistant messages are left-aligned with white background
+            lv_obj_set_style_bg_color(msg_bubble, current_theme_.assistant_bubble, 0);
+            lv_obj_set_style_text_color(msg_text, current_theme_.text, 0);
+            lv_obj_align(msg_bubble, LV_ALIGN_LEFT_MID, 0, 0);
+            break;
+        case kChatRoleSystem:
+            // System messages are center-aligned with light gray background
+            lv_obj_set_style_bg_color(msg_bubble, current_theme_.system_bubble, 0);
+            lv_obj_set_style_text_color(msg_text, current_theme_.system_text, 0);
+            lv_obj_align(msg_bubble, LV_ALIGN_CENTER, 0, 0);
+            break;
+    }
+
+    // Store reference to the latest message label
+    if (seq + 1 == chat_history_.end_seq()) {
+        chat_message_label_ = msg_text;
+    }
+}
+
+void LcdDisplay::ShowLatestChatMessages() {
+    while (chat_rows_.size() < chat_row_pool_size_ && chat_rows_.size() < chat_history_.size()) {
+        chat_rows_.push_back(CreateChatRow());
+    }
+    if (chat_rows_.empty()) {
+        return;
+    }
+
+    // Rows that scrolled off the top are recycled for the newest messages
+    uint32_t first = chat_history_.end_seq() - chat_rows_.size();
+    if (first > chat_window_first_ && first - chat_window_first_ < chat_rows_.size()) {
+        for (uint32_t i = chat_window_first_; i < first; i++) {
+            lv_obj_t* row = chat_rows_.front();
+            chat_rows_.erase(chat_rows_.begin());
+            chat_rows_.push_back(row);
         }
     }
-    
-    // Collapse system messages (if it's a system message, check if the last message is also a system message)
-    if (strcmp(role, "system") == 0 && child_count > 0) {
-        // Get the last message container
-        lv_obj_t* last_container = lv_obj_get_child(content_, child_count - 1);
-        if (last_container != nullptr && lv_obj_get_child_cnt(last_container) > 0) {
-            // Get the bubble inside the container
-            lv_obj_t* last_bubble = lv_obj_get_child(last_container, 0);
-            if (last_bubble != nullptr) {
-                // Check if bubble type is system message
-                void* bubble_type_ptr = lv_obj_get_user_data(last_bubble);
-                if (bubble_type_ptr != nullptr && strcmp((const char*)bubble_type_ptr, "system") == 0) {
-                    // If the last message is also a system message, delete it
-                    lv_obj_del(last_container);
-                }
-            }
+    chat_window_first_ = first;
+
+    for (size_t i = 0; i < chat_rows_.size(); i++) {
+        if ((uintptr_t)lv_obj_get_user_data(chat_rows_[i]) != first + i + 1) {
+            BindChatRow(chat_rows_[i], first + i);
         }
     }
-    
-    // Create a message bubble
-    lv_obj_t* msg_bubble = lv_obj_create(content_);
-    lv_obj_set_style_radius(msg_bubble, 8, 0);
-    lv_obj_set_scrollbar_mode(msg_bubble, LV_SCROLLBAR_MODE_OFF);
-    lv_obj_set_style_border_width(msg_bubble, 1, 0);
-    lv_obj_set_style_border_color(msg_bubble, current_theme_.border, 0);
-    lv_obj_set_style_pad_all(msg_bubble, 8, 0);
+    ArrangeChatObjects();
 
-    // Create the message text
-    lv_obj_t* msg_text = lv_label_create(msg_bubble);
-    lv_label_set_text(msg_text, content);
-    
-    // Calculate actual text width
-    lv_coord_t text_width = lv_txt_get_width(content, strlen(content), fonts_.text_font, 0);
+    // Auto-scroll to the newest message
+    lv_obj_scroll_to_view_recursive(chat_rows_.back(), LV_ANIM_ON);
+}
 
-    // Calculate bubble width
-    lv_coord_t max_width = LV_HOR_RES * 85 / 100 - 16;  // 屏幕宽度的85%
-    lv_coord_t min_width = 20;  
-    lv_coord_t bubble_width;
-    
-    // Ensure text width is not less than minimum width
-    if (text_width < min_width) {
-        text_width = min_width;
+void LcdDisplay::OnChatScrollEnd() {
+    if (chat_rows_.size() < chat_row_pool_size_) {
+        return;
     }
 
-    // If text width is less than maximum width, use text width
-    if (text_width < max_width) {
-        bubble_width = text_width; 
-    } else {
-        bubble_width = max_width;
+    if (lv_obj_get_scroll_top(content_) <= 0 && chat_window_first_ > chat_history_.first_seq()) {
+        // Reached the top, reuse the bottom row for the previous message
+        lv_obj_t* row = chat_rows_.back();
+        chat_rows_.pop_back();
+        chat_rows_.insert(chat_rows_.begin(), row);
+        chat_window_first_--;
+        BindChatRow(row, chat_window_first_);
+        ArrangeChatObjects();
+    } else if (lv_obj_get_scroll_bottom(content_) <= 0 &&
+               chat_window_first_ + chat_rows_.size() < chat_history_.end_seq()) {
+        // Reached the bottom of an older window, reuse the top row for the next message
+        lv_obj_t* row = chat_rows_.front();
+        chat_rows_.erase(chat_rows_.begin());
+        chat_rows_.push_back(row);
+        chat_window_first_++;
+        BindChatRow(row, chat_window_first_ + chat_rows_.size() - 1);
+        ArrangeChatObjects();
     }
-    
-    // Set message text width
-    lv_obj_set_width(msg_text, bubble_width);  // 减去padding
-    lv_label_set_long_mode(msg_text, LV_LABEL_LONG_WRAP);
-    lv_obj_set_style_text_font(msg_text, fonts_.text_font, 0);
+}
 
-    // Set bubble width
-    lv_obj_set_width(msg_bubble, bubble_width);
-    lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
+void LcdDisplay::ArrangeChatObjects() {
+    // Image bubbles are pruned by age, their frames are released as soon as the bubble is deleted
+    while (!chat_images_.empty() && (chat_images_.size() > CHAT_MAX_IMAGE_BUBBLES ||
+                                     chat_images_.front().seq < chat_history_.first_seq())) {
+        lv_obj_del(chat_images_.front().bubble);
+        chat_images_.erase(chat_images_.begin());
+    }
 
-    // Set alignment and style based on message role
-    if (strcmp(role, "user") == 0) {
-        // User messages are right-aligned with green background
-        lv_obj_set_style_bg_color(msg_bubble, current_theme_.user_bubble, 0);
-        // Set text color for contrast
-        lv_obj_set_style_text_color(msg_text, current_theme_.text, 0);
-        
-        // Set custom property to mark bubble type
-        lv_obj_set_user_data(msg_bubble, (void*)"user");
-        
-        // Set appropriate width for content
-        lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
-        lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
-        
-        // Don't grow
-        lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
-    } else if (strcmp(role, "assistant") == 0) {
-        // Assistant messages are left-aligned with white background
-        lv_obj_set_style_bg_color(msg_bubble, current_theme_.assistant_bubble, 0);
-        // Set text color for contrast
-        lv_obj_set_style_text_color(msg_text, current_theme_.text, 0);
-        
-        // Set custom property to mark bubble type
-        lv_obj_set_user_data(msg_bubble, (void*)"assistant");
-        
-        // Set appropriate width for content
-        lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
-        lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
-        
-        // Don't grow
-        lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
-    } else if (strcmp(role, "system") == 0) {
-        // System messages are center-aligned with light gray background
-        lv_obj_set_style_bg_color(msg_bubble, current_theme_.system_bubble, 0);
-        // Set text color for contrast
-        lv_obj_set_style_text_color(msg_text, current_theme_.system_text, 0);
-        
-        // Set custom property to mark bubble type
-        lv_obj_set_user_data(msg_bubble, (void*)"system");
-        
-        // Set appropriate width for content
-        lv_obj_set_width(msg_bubble, LV_SIZE_CONTENT);
-        lv_obj_set_height(msg_bubble, LV_SIZE_CONTENT);
-        
-        // Don't grow
-        lv_obj_set_style_flex_grow(msg_bubble, 0, 0);
+    // Rows and images are kept in message order, images outside the visible window are hidden
+    uint32_t window_end = chat_window_first_ + chat_rows_.size();
+    int32_t index = 0;
+    auto place = [&index](lv_obj_t* obj) {
+        if (lv_obj_get_index(obj) != index) {
+            lv_obj_move_to_index(obj, index);
+        }
+        index++;
+    };
+    auto place_image = [&](const ChatImage& image) {
+        bool visible = chat_rows_.empty() || (image.seq >= chat_window_first_ && image.seq <= window_end);
+        if (visible == lv_obj_has_flag(image.bubble, LV_OBJ_FLAG_HIDDEN)) {
+            if (visible) {
+                lv_obj_clear_flag(image.bubble, LV_OBJ_FLAG_HIDDEN);
+            } else {
+                lv_obj_add_flag(image.bubble, LV_OBJ_FLAG_HIDDEN);
+            }
+        }
+        place(image.bubble);
+    };
+
+    size_t next_image = 0;
+    for (size_t i = 0; i < chat_rows_.size(); i++) {
+        while (next_image < chat_images_.size() && chat_images_[next_image].seq <= chat_window_first_ + i) {
+            place_image(chat_images_[next_image++]);
+        }
+        place(chat_rows_[i]);
+    }
+    while (next_image < chat_images_.size()) {
+        place_image(chat_images_[next_image++]);
+    }
+}
+
+void LcdDisplay::SetChatMessage(const char* role, const char* content) {
+    if (ShouldDefer()) {
+        PostChatMessage(role, content);
+        return;
+    }
+    DisplayLockGuard lock(this);
+    if (content_ == nullptr) {
+        return;
     }
     
-    // Create a full-width container for user messages to ensure right alignment
+    // Avoid empty message boxes
+    if(strlen(content) == 0) return;
+
+    ChatRole chat_role;
     if (strcmp(role, "user") == 0) {
-        // Create a full-width container
-        lv_obj_t* container = lv_obj_create(content_);
-        lv_obj_set_width(container, LV_HOR_RES);
-        lv_obj_set_height(container, LV_SIZE_CONTENT);
-        
-        // Make container transparent and borderless
-        lv_obj_set_style_bg_opa(container, LV_OPA_TRANSP, 0);
-        lv_obj_set_style_border_width(container, 0, 0);
-        lv_obj_set_style_pad_all(container, 0, 0);
-        
-        // Move the message bubble into this container
-        lv_obj_set_parent(msg_bubble, container);
-        
-        // Right align the bubble in the container
-        lv_obj_align(msg_bubble, LV_ALIGN_RIGHT_MID, -25, 0);
-        
-        // Auto-scroll to this container
-        lv_obj_scroll_to_view_recursive(container, LV_ANIM_ON);
+        chat_role = kChatRoleUser;
+    } else if (strcmp(role, "assistant") == 0) {
+        chat_role = kChatRoleAssistant;
     } else if (strcmp(role, "system") == 0) {
-        // Create a full-width container for system messages to ensure center alignment
-        lv_obj_t* container = lv_obj_create(content_);
-        lv_obj_set_width(container, LV_HOR_RES);
-        lv_obj_set_height(container, LV_SIZE_CONTENT);
-        
-        // Make the container transparent and borderless
-        lv_obj_set_style_bg_opa(container, LV_OPA_TRANSP, 0);
-        lv_obj_set_style_border_width(container, 0, 0);
-        lv_obj_set_style_pad_all(container, 0, 0);
-        
-        // Move the message bubble into this container
-        lv_obj_set_parent(msg_bubble, container);
-        
-        // Center the bubble in the container
-        lv_obj_align(msg_bubble, LV_ALIGN_CENTER, 0, 0);
-        
-        // Automatically scroll to the bottom
-        lv_obj_scroll_to_view_recursive(container, LV_ANIM_ON);
+        chat_role = kChatRoleSystem;
     } else {
-        // For assistant messages
-        // Left align assistant messages
-        lv_obj_align(msg_bubble, LV_ALIGN_LEFT_MID, 0, 0);
+        ESP_LOGW(TAG, "Unknown chat role: %s", role);
+        return;
+    }
 
-        // Auto-scroll to the message bubble
-        lv_obj_scroll_to_view_recursive(msg_bubble, LV_ANIM_ON);
+    // Collapse system messages, a new one replaces the previous if it is the last message
+    ChatHistory::Message last_message;
+    if (chat_role == kChatRoleSystem && chat_history_.Get(chat_history_.end_seq() - 1, last_message) &&
+        last_message.role == kChatRoleSystem) {
+        uint32_t last_seq = chat_history_.end_seq() - 1;
+        chat_history_.RemoveLast();
+        for (auto row : chat_rows_) {
+            if ((uintptr_t)lv_obj_get_user_data(row) == last_seq + 1) {
+                lv_obj_set_user_data(row, nullptr);
+            }
+        }
     }
-    
-    // Store reference to the latest message label
-    chat_message_label_ = msg_text;
+
+    chat_history_.Append(chat_role, content);
+    ShowLatestChatMessages();
 }
 
 void LcdDisplay::SetPreviewImage(const lv_img_dsc_t* img_dsc) {
-    DisplayLockGuard lock(this);
-    if (content_ == nullptr) {
+    if (img_dsc == nullptr) {
+        return;
+    }
+
+    // The caller may reuse its buffer, so take a private copy of the image
+    lv_img_dsc_t* copied_img_dsc = (lv_img_dsc_t*)heap_caps_malloc(sizeof(lv_img_dsc_t), MALLOC_CAP_8BIT);
+    if (copied_img_dsc == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate memory for image descriptor");
         return;
     }
     
-    if (img_dsc != nullptr) {
-        // Create a message bubble for image preview
-        lv_obj_t* img_bubble = lv_obj_create(content_);
-        lv_obj_set_style_radius(img_bubble, 8, 0);
-        lv_obj_set_scrollbar_mode(img_bubble, LV_SCROLLBAR_MODE_OFF);
-        lv_obj_set_style_border_width(img_bubble, 1, 0);
-        lv_obj_set_style_border_color(img_bubble, current_theme_.border, 0);
-        lv_obj_set_style_pad_all(img_bubble, 8, 0);
-        
-        // Set image bubble background color (similar to system message)
-        lv_obj_set_style_bg_color(img_bubble, current_theme_.assistant_bubble, 0);
-        
-        // Set the custom attribute marker bubble type
-        lv_obj_set_user_data(img_bubble, (void*)"image");
-        
-        // Create the image object inside the bubble
-        lv_obj_t* preview_image = lv_image_create(img_bubble);
-        
-        // Copy the image descriptor and data to avoid source data changes
-        lv_img_dsc_t* copied_img_dsc = (lv_img_dsc_t*)heap_caps_malloc(sizeof(lv_img_dsc_t), MALLOC_CAP_8BIT);
-        if (copied_img_dsc == nullptr) {
-            ESP_LOGE(TAG, "Failed to allocate memory for image descriptor");
-            lv_obj_del(img_bubble);
-            return;
-        }
-        
-        // Copy the header
-        copied_img_dsc->header = img_dsc->header;
-        copied_img_dsc->data_size = img_dsc->data_size;
-        
-        // Copy the image data
-        uint8_t* copied_data = (uint8_t*)heap_caps_malloc(img_dsc->data_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (copied_data == nullptr) {
-            // Fallback to internal RAM if SPIRAM allocation fails
-            copied_data = (uint8_t*)heap_caps_malloc(img_dsc->data_size, MALLOC_CAP_8BIT);
-        }
-        if (copied_data == nullptr) {
-            ESP_LOGE(TAG, "Failed to allocate memory for image data (size: %lu bytes)", img_dsc->data_size);
-            heap_caps_free(copied_img_dsc);
-            lv_obj_del(img_bubble);
-            return;
-        }
-        
-        memcpy(copied_data, img_dsc->data, img_dsc->data_size);
-        copied_img_dsc->data = copied_data;
-        
-        // Calculate appropriate size for the image
-        lv_coord_t max_width = LV_HOR_RES * 70 / 100;  // 70% of screen width
-        lv_coord_t max_height = LV_VER_RES * 50 / 100; // 50% of screen height
-        
-        // Calculate zoom factor to fit within maximum dimensions
-        lv_coord_t img_width = copied_img_dsc->header.w;
-        lv_coord_t img_height = copied_img_dsc->header.h;
-        
-        lv_coord_t zoom_w = (max_width * 256) / img_width;
-        lv_coord_t zoom_h = (max_height * 256) / img_height;
-        lv_coord_t zoom = (zoom_w < zoom_h) ? zoom_w : zoom_h;
-        
-        // Ensure zoom doesn't exceed 256 (100%)
-        if (zoom > 256) zoom = 256;
-        
-        // Set image properties
-        lv_image_set_src(preview_image, copied_img_dsc);
-        lv_image_set_scale(preview_image, zoom);
-        
-        // Add event handler to clean up copied data when image is deleted
-        lv_obj_add_event_cb(preview_image, [](lv_event_t* e) {
-            lv_img_dsc_t* copied_img_dsc = (lv_img_dsc_t*)lv_event_get_user_data(e);
-            if (copied_img_dsc != nullptr) {
-                heap_caps_free((void*)copied_img_dsc->data);
-                heap_caps_free(copied_img_dsc);
-            }
-        }, LV_EVENT_DELETE, (void*)copied_img_dsc);
-        
-        // Calculate actual scaled image dimensions
-        lv_coord_t scaled_width = (img_width * zoom) / 256;
-        lv_coord_t scaled_height = (img_height * zoom) / 256;
-        
-        // Set bubble size to be 16 pixels larger than the image (8 pixels on each side)
-        lv_obj_set_width(img_bubble, scaled_width + 16);
-        lv_obj_set_height(img_bubble, scaled_height + 16);
-        
-        // Don't grow in flex layout
-        lv_obj_set_style_flex_grow(img_bubble, 0, 0);
-        
-        // Center the image within the bubble
-        lv_obj_center(preview_image);
-        
-        // Left align the image bubble like assistant messages
-        lv_obj_align(img_bubble, LV_ALIGN_LEFT_MID, 0, 0);
+    // Copy the header
+    copied_img_dsc->header = img_dsc->header;
+    copied_img_dsc->data_size = img_dsc->data_size;
+    
+    // Copy the image data
+    uint8_t* copied_data = (uint8_t*)heap_caps_malloc(img_dsc->data_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (copied_data == nullptr) {
+        // Fallback to internal RAM if SPIRAM allocation fails
+        copied_data = (uint8_t*)heap_caps_malloc(img_dsc->data_size, MALLOC_CAP_8BIT);
+    }
+    if (copied_data == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate memory for image data (size: %lu bytes)", img_dsc->data_size);
+        heap_caps_free(copied_img_dsc);
+        return;
+    }
+    
+    memcpy(copied_data, img_dsc->data, img_dsc->data_size);
+    copied_img_dsc->data = copied_data;
+
+    SetSharedPreviewImage(std::shared_ptr<const lv_img_dsc_t>(copied_img_dsc, [](const lv_img_dsc_t* image) {
+        heap_caps_free((void*)image->data);
+        heap_caps_free((void*)image);
+    }));
+}
 
-        // Auto-scroll to the image bubble
-        lv_obj_scroll_to_view_recursive(img_bubble, LV_ANIM_ON);
+void LcdDisplay::SetSharedPreviewImage(std::shared_ptr<const lv_img_dsc_t> image) {
+    DisplayLockGuard lock(this);
+    if (content_ == nullptr || image == nullptr) {
+        return;
     }
+    
+    // Create a message bubble for image preview
+    lv_obj_t* img_bubble = lv_obj_create(content_);
+    lv_obj_set_style_radius(img_bubble, 8, 0);
+    lv_obj_set_scrollbar_mode(img_bubble, LV_SCROLLBAR_MODE_OFF);
+    lv_obj_set_style_border_width(img_bubble, 1, 0);
+    lv_obj_set_style_border_color(img_bubble, current_theme_.border, 0);
+    lv_obj_set_style_pad_all(img_bubble, 8, 0);
+    
+    // Set image bubble background color (similar to system message)
+    lv_obj_set_style_bg_color(img_bubble, current_theme_.assistant_bubble, 0);
+    
+    // Set the custom attribute marker bubble type
+    lv_obj_set_user_data(img_bubble, (void*)"image");
+    
+    // Create the image object inside the bubble
+    lv_obj_t* preview_image = lv_image_create(img_bubble);
+    
+    // Calculate appropriate size for the image
+    lv_coord_t max_width = LV_HOR_RES * 70 / 100;  // 70% of screen width
+    lv_coord_t max_height = LV_VER_RES * 50 / 100; // 50% of screen height
+    
+    // Calculate zoom factor to fit within maximum dimensions
+    lv_coord_t img_width = image->header.w;
+    lv_coord_t img_height = image->header.h;
+    
+    lv_coord_t zoom_w = (max_width * 256) / img_width;
+    lv_coord_t zoom_h = (max_height * 256) / img_height;
+    lv_coord_t zoom = (zoom_w < zoom_h) ? zoom_w : zoom_h;
+    
+    // Ensure zoom doesn't exceed 256 (100%)
+    if (zoom > 256) zoom = 256;
+    
+    // Set image properties
+    lv_image_set_src(preview_image, image.get());
+    lv_image_set_scale(preview_image, zoom);
+    
+    // The widget keeps the image alive, the reference is dropped when it is deleted
+    auto image_ref = new std::shared_ptr<const lv_img_dsc_t>(std::move(image));
+    lv_obj_add_event_cb(preview_image, [](lv_event_t* e) {
+        delete static_cast<std::shared_ptr<const lv_img_dsc_t>*>(lv_event_get_user_data(e));
+    }, LV_EVENT_DELETE, image_ref);
+    
+    // Calculate actual scaled image dimensions
+    lv_coord_t scaled_width = (img_width * zoom) / 256;
+    lv_coord_t scaled_height = (img_height * zoom) / 256;
+    
+    // Set bubble size to be 16 pixels larger than the image (8 pixels on each side)
+    lv_obj_set_width(img_bubble, scaled_width + 16);
+    lv_obj_set_height(img_bubble, scaled_height + 16);
+    
+    // Don't grow in flex layout
+    lv_obj_set_style_flex_grow(img_bubble, 0, 0);
+    
+    // Center the image within the bubble
+    lv_obj_center(preview_image);
+    
+    // Left align the image bubble like assistant messages
+    lv_obj_align(img_bubble, LV_ALIGN_LEFT_MID, 0, 0);
+
+    // The image follows the latest message, and stays there when rows are recycled
+    chat_images_.push_back({img_bubble, chat_history_.end_seq()});
+    ArrangeChatObjects();
+
+    // Auto-scroll to the image bubble
+    lv_obj_scroll_to_view_recursive(img_bubble, LV_ANIM_ON);
 }
 #else
 void LcdDisplay::SetupUI() {
@@ -805,6 +1035,8 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_style_text_color(low_battery_label_, lv_color_white(), 0);
     lv_obj_center(low_battery_label_);
     lv_obj_add_flag(low_battery_popup_, LV_OBJ_FLAG_HIDDEN);
+
+    StartUpdateTimer();
 }
 
 void LcdDisplay::SetPreviewImage(const lv_img_dsc_t* img_dsc) {
@@ -829,8 +1061,16 @@ void LcdDisplay::SetPreviewImage(const lv_img_dsc_t* img_dsc) {
         if (emotion_label_ != nullptr) {
             lv_obj_clear_flag(emotion_label_, LV_OBJ_FLAG_HIDDEN);
         }
+        preview_image_ref_.reset();
     }
 }
+
+void LcdDisplay::SetSharedPreviewImage(std::shared_ptr<const lv_img_dsc_t> image) {
+    DisplayLockGuard lock(this);
+    SetPreviewImage(image.get());
+    // Hold the shown frame until it is replaced so its owner can not reuse the buffer
+    preview_image_ref_ = std::move(image);
+}
 #endif
 
 void LcdDisplay::SetEmotion(const char* emotion) {
@@ -863,6 +1103,11 @@ void LcdDisplay::SetEmotion(const char* emotion) {
         {"🙄", "confused"}
     };
     
+    if (ShouldDefer()) {
+        PostEmotion(emotion, false);
+        return;
+    }
+
     // Find matching emotion
     std::string_view emotion_view(emotion);
     auto it = std::find_if(emotions.begin(), emotions.end(),
@@ -891,6 +1136,10 @@ void LcdDisplay::SetEmotion(const char* emotion) {
 }
 
 void LcdDisplay::SetIcon(const char* icon) {
+    if (ShouldDefer()) {
+        PostEmotion(icon, true);
+        return;
+    }
     DisplayLockGuard lock(this);
     if (emotion_label_ == nullptr) {
         return;
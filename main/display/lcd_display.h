@@ -2,12 +2,15 @@
 #define LCD_DISPLAY_H
 
 #include "display.h"
+#include "chat_history.h"
 
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
 #include <font_emoji.h>
 
 #include <atomic>
+#include <cstdint>
+#include <vector>
 
 // Theme color structure
 struct ThemeColors {
@@ -22,6 +25,31 @@ struct ThemeColors {
     lv_color_t low_battery;
 };
 
+// Bus that feeds the panel, it decides how expensive a flush is and where draw buffers may live
+enum LcdBusType {
+    kLcdBusSpi,
+    kLcdBusQspi,
+    kLcdBusRgb,
+    kLcdBusMipi,
+};
+
+// LVGL draw buffer layout chosen for a display class
+struct LcdBufferStrategy {
+    uint32_t buffer_lines = 20;
+    bool double_buffer = false;
+    bool buff_dma = true;
+    bool buff_spiram = false;
+    bool full_refresh = false;
+};
+
+struct LcdRenderStatistics {
+    uint32_t frames = 0;
+    uint32_t flushes = 0;
+    int64_t total_render_us = 0;
+    int64_t max_render_us = 0;
+    int64_t total_flush_wait_us = 0;
+    int64_t max_flush_wait_us = 0;
+};
 
 class LcdDisplay : public Display {
 protected:
@@ -34,10 +62,39 @@ protected:
     lv_obj_t* container_ = nullptr;
     lv_obj_t* side_bar_ = nullptr;
     lv_obj_t* preview_image_ = nullptr;
+    std::shared_ptr<const lv_img_dsc_t> preview_image_ref_;
 
     DisplayFonts fonts_;
     ThemeColors current_theme_;
 
+    LcdBufferStrategy buffer_strategy_;
+    LcdRenderStatistics render_statistics_;
+    int64_t render_start_time_ = 0;
+    int64_t flush_wait_start_time_ = 0;
+    int64_t statistics_start_time_ = 0;
+
+#if CONFIG_USE_WECHAT_MESSAGE_STYLE
+    // Message text lives in the history, only the visible rows own LVGL widgets
+    ChatHistory chat_history_;
+    std::vector<lv_obj_t*> chat_rows_;      // Recycled rows in display order
+    size_t chat_row_pool_size_ = 0;
+    uint32_t chat_window_first_ = 0;        // Sequence number shown by chat_rows_[0]
+    // Image bubbles oldest first, each one follows the message before seq
+    struct ChatImage {
+        lv_obj_t* bubble;
+        uint32_t seq;
+    };
+    std::vector<ChatImage> chat_images_;
+
+    lv_obj_t* CreateChatRow();
+    void BindChatRow(lv_obj_t* row, uint32_t seq);
+    void ShowLatestChatMessages();
+    void OnChatScrollEnd();
+    void ArrangeChatObjects();
+#endif
+
+    static LcdBufferStrategy ChooseBufferStrategy(LcdBusType bus, int width, int height);
+    void RegisterRenderStatistics();
     void SetupUI();
     virtual bool Lock(int timeout_ms = 0) override;
     virtual void Unlock() override;
@@ -51,12 +108,16 @@ public:
     virtual void SetEmotion(const char* emotion) override;
     virtual void SetIcon(const char* icon) override;
     virtual void SetPreviewImage(const lv_img_dsc_t* img_dsc) override;
+    virtual void SetSharedPreviewImage(std::shared_ptr<const lv_img_dsc_t> image) override;
 #if CONFIG_USE_WECHAT_MESSAGE_STYLE
     virtual void SetChatMessage(const char* role, const char* content) override; 
 #endif  
 
     // Add theme switching function
     virtual void SetTheme(const std::string& theme_name) override;
+
+    // Logs FPS and render/flush timing since the last call, then resets the counters
+    virtual void PrintStatistics() override;
 };
 
 // RGB LCD Display
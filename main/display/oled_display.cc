@@ -62,6 +62,7 @@ OledDisplay::OledDisplay(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_handl
     } else {
         SetupUI_128x32();
     }
+    StartUpdateTimer();
 }
 
 OledDisplay::~OledDisplay() {
@@ -96,6 +97,10 @@ void OledDisplay::Unlock() {
 }
 
 void OledDisplay::SetChatMessage(const char* role, const char* content) {
+    if (ShouldDefer()) {
+        PostChatMessage(role, content);
+        return;
+    }
     DisplayLockGuard lock(this);
     if (chat_message_label_ == nullptr) {
         return;
@@ -1,16 +1,22 @@
 #include "circular_strip.h"
 #include "application.h"
 #include <esp_log.h>
+#include <soc/soc_caps.h>
+#include <algorithm>
 
 #define TAG "CircularStrip"
 
 #define BLINK_INFINITE -1
 
+// Polled at the level meter's 30 Hz publishing rate
+#define LEVEL_INTERVAL_MS 33
+
 CircularStrip::CircularStrip(gpio_num_t gpio, uint8_t max_leds) : max_leds_(max_leds) {
     // If the gpio is not connected, you should use NoLed class
     assert(gpio != GPIO_NUM_NC);
 
     colors_.resize(max_leds_);
+    pixels_.resize(max_leds_);
 
     led_strip_config_t strip_config = {};
     strip_config.strip_gpio_num = gpio;
@@ -21,16 +27,40 @@ CircularStrip::CircularStrip(gpio_num_t gpio, uint8_t max_leds) : max_leds_(max_
     led_strip_rmt_config_t rmt_config = {};
     rmt_config.resolution_hz = 10 * 1000 * 1000; // 10MHz
 
+#if SOC_RMT_SUPPORT_DMA
+    // A whole frame goes out in one DMA transfer instead of refilling RMT memory per pixel
+    rmt_config.flags.with_dma = true;
+    if (led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip_) != ESP_OK) {
+        ESP_LOGW(TAG, "No DMA channel for the led strip, falling back to RMT memory");
+        rmt_config.flags.with_dma = false;
+        ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip_));
+    }
+#else
     ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip_));
+#endif
     led_strip_clear(led_strip_);
 
     esp_timer_create_args_t strip_timer_args = {
         .callback = [](void *arg) {
             auto strip = static_cast<CircularStrip*>(arg);
             std::lock_guard<std::mutex> lock(strip->mutex_);
-            if (strip->strip_callback_ != nullptr) {
-                strip->strip_callback_();
+            strip->statistics_.wakeups++;
+            if (strip->follow_level_) {
+                strip->ShowLevelFrame();
+                return;
+            }
+            if (strip->effect_.empty()) {
+                return;
+            }
+            strip->keyframe_index_++;
+            if (strip->keyframe_index_ == strip->effect_.size()) {
+                if (!strip->effect_.loops()) {
+                    strip->effect_ = StripEffect();
+                    return;
+                }
+                strip->keyframe_index_ = 0;
             }
+            strip->ShowKeyframe();
         },
         .arg = this,
         .dispatch_method = ESP_TIMER_TASK,
@@ -47,133 +77,137 @@ CircularStrip::~CircularStrip() {
     }
 }
 
+// Push only the pixels that changed, and skip the refresh if none did
+void CircularStrip::ShowFrame(const std::vector<StripColor>& frame) {
+    int64_t start_time = esp_timer_get_time();
+    bool changed = false;
+    for (int i = 0; i < max_leds_; i++) {
+        if (frame[i] != pixels_[i]) {
+            pixels_[i] = frame[i];
+            led_strip_set_pixel(led_strip_, i, frame[i].red, frame[i].green, frame[i].blue);
+            changed = true;
+        }
+    }
+    if (changed) {
+        led_strip_refresh(led_strip_);
+        statistics_.refreshes++;
+    } else {
+        statistics_.skipped++;
+    }
+    statistics_.render_time_us += esp_timer_get_time() - start_time;
+}
+
+// Show the current keyframe and sleep until the next one differs
+void CircularStrip::ShowKeyframe() {
+    effect_.Render(keyframe_index_, frame_);
+    ShowFrame(frame_);
+
+    bool last = keyframe_index_ + 1 == effect_.size();
+    if (last && (!effect_.loops() || effect_.size() == 1)) {
+        if (!effect_.loops()) {
+            effect_ = StripEffect();
+        }
+        return;
+    }
+    esp_timer_start_once(strip_timer_, (int64_t)effect_.keyframe(keyframe_index_).hold * tick_ms_ * 1000);
+}
+
+void CircularStrip::StartEffect(StripEffect&& effect, int interval_ms) {
+    if (led_strip_ == nullptr) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    esp_timer_stop(strip_timer_);
+    follow_level_ = false;
+    effect_ = std::move(effect);
+    keyframe_index_ = 0;
+    tick_ms_ = interval_ms;
+    if (!effect_.empty()) {
+        ShowKeyframe();
+    }
+}
 
 void CircularStrip::SetAllColor(StripColor color) {
     std::lock_guard<std::mutex> lock(mutex_);
     esp_timer_stop(strip_timer_);
+    follow_level_ = false;
+    effect_ = StripEffect();
     for (int i = 0; i < max_leds_; i++) {
         colors_[i] = color;
-        led_strip_set_pixel(led_strip_, i, color.red, color.green, color.blue);
     }
-    led_strip_refresh(led_strip_);
+    ShowFrame(colors_);
 }
 
 void CircularStrip::SetSingleColor(uint8_t index, StripColor color) {
     std::lock_guard<std::mutex> lock(mutex_);
     esp_timer_stop(strip_timer_);
+    follow_level_ = false;
+    effect_ = StripEffect();
     colors_[index] = color;
-    led_strip_set_pixel(led_strip_, index, color.red, color.green, color.blue);
-    led_strip_refresh(led_strip_);
+    ShowFrame(colors_);
 }
 
 void CircularStrip::Blink(StripColor color, int interval_ms) {
     for (int i = 0; i < max_leds_; i++) {
         colors_[i] = color;
     }
-    StartStripTask(interval_ms, [this]() {
-        static bool on = true;
-        if (on) {
-            for (int i = 0; i < max_leds_; i++) {
-                led_strip_set_pixel(led_strip_, i, colors_[i].red, colors_[i].green, colors_[i].blue);
-            }
-            led_strip_refresh(led_strip_);
-        } else {
-            led_strip_clear(led_strip_);
-        }
-        on = !on;
-    });
+    StartEffect(StripEffect::Blink(max_leds_, color), interval_ms);
 }
 
 void CircularStrip::FadeOut(int interval_ms) {
-    StartStripTask(interval_ms, [this]() {
-        bool all_off = true;
-        for (int i = 0; i < max_leds_; i++) {
-            colors_[i].red /= 2;
-            colors_[i].green /= 2;
-            colors_[i].blue /= 2;
-            if (colors_[i].red != 0 || colors_[i].green != 0 || colors_[i].blue != 0) {
-                all_off = false;
-            }
-            led_strip_set_pixel(led_strip_, i, colors_[i].red, colors_[i].green, colors_[i].blue);
-        }
-        if (all_off) {
-            led_strip_clear(led_strip_);
-            esp_timer_stop(strip_timer_);
-        } else {
-            led_strip_refresh(led_strip_);
-        }
-    });
+    // The strip timer writes pixels_ while an effect or the level meter runs
+    std::vector<StripColor> pixels;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pixels = pixels_;
+    }
+    StartEffect(StripEffect::FadeOut(pixels), interval_ms);
 }
 
 void CircularStrip::Breathe(StripColor low, StripColor high, int interval_ms) {
-    StartStripTask(interval_ms, [this, low, high]() {
-        static bool increase = true;
-        static StripColor color = low;
-        if (increase) {
-            if (color.red < high.red) {
-                color.red++;
-            }
-            if (color.green < high.green) {
-                color.green++;
-            }
-            if (color.blue < high.blue) {
-                color.blue++;
-            }
-            if (color.red == high.red && color.green == high.green && color.blue == high.blue) {
-                increase = false;
-            }
-        } else {
-            if (color.red > low.red) {
-                color.red--;
-            }
-            if (color.green > low.green) {
-                color.green--;
-            }
-            if (color.blue > low.blue) {
-                color.blue--;
-            }
-            if (color.red == low.red && color.green == low.green && color.blue == low.blue) {
-                increase = true;
-            }
-        }
-        for (int i = 0; i < max_leds_; i++) {
-            led_strip_set_pixel(led_strip_, i, color.red, color.green, color.blue);
-        }
-        led_strip_refresh(led_strip_);
-    });
+    StartEffect(StripEffect::Breathe(max_leds_, low, high), interval_ms);
 }
 
 void CircularStrip::Scroll(StripColor low, StripColor high, int length, int interval_ms) {
     for (int i = 0; i < max_leds_; i++) {
         colors_[i] = low;
     }
-    StartStripTask(interval_ms, [this, low, high, length]() {
-        static int offset = 0;
-        for (int i = 0; i < max_leds_; i++) {
-            colors_[i] = low;
-        }
-        for (int j = 0; j < length; j++) {
-            int i = (offset + j) % max_leds_;
-            colors_[i] = high;
-        }
-        for (int i = 0; i < max_leds_; i++) {
-            led_strip_set_pixel(led_strip_, i, colors_[i].red, colors_[i].green, colors_[i].blue);
-        }
-        led_strip_refresh(led_strip_);
-        offset = (offset + 1) % max_leds_;
-    });
+    StartEffect(StripEffect::Scroll(max_leds_, low, high, length), interval_ms);
 }
 
-void CircularStrip::StartStripTask(int interval_ms, std::function<void()> cb) {
+// Lit pixels scale with the RMS level, the pixel at the edge is blended for a smooth meter
+void CircularStrip::ShowLevelFrame() {
+    auto level = Application::GetInstance().GetAudioService().GetOutputLevel();
+    int lit = level.rms * max_leds_;
+    frame_.resize(max_leds_);
+    for (int i = 0; i < max_leds_; i++) {
+        int weight = std::clamp(lit - i * 255, 0, 255);
+        frame_[i].red = level_low_.red + (level_high_.red - level_low_.red) * weight / 255;
+        frame_[i].green = level_low_.green + (level_high_.green - level_low_.green) * weight / 255;
+        frame_[i].blue = level_low_.blue + (level_high_.blue - level_low_.blue) * weight / 255;
+    }
+    ShowFrame(frame_);
+}
+
+void CircularStrip::ShowAudioLevel(StripColor low, StripColor high) {
     if (led_strip_ == nullptr) {
         return;
     }
 
     std::lock_guard<std::mutex> lock(mutex_);
     esp_timer_stop(strip_timer_);
-    
-    strip_callback_ = cb;
-    esp_timer_start_periodic(strip_timer_, interval_ms * 1000);
+    effect_ = StripEffect();
+    follow_level_ = true;
+    level_low_ = low;
+    level_high_ = high;
+    ShowLevelFrame();
+    esp_timer_start_periodic(strip_timer_, LEVEL_INTERVAL_MS * 1000);
+}
+
+StripStatistics CircularStrip::GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
 }
 
 void CircularStrip::SetBrightness(uint8_t default_brightness, uint8_t low_brightness) {
@@ -212,8 +246,9 @@ void CircularStrip::OnStateChanged() {
             break;
         }
         case kDeviceStateSpeaking: {
-            StripColor color = { low_brightness_, default_brightness_, low_brightness_ };
-            SetAllColor(color);
+            StripColor low = { 0, low_brightness_, 0 };
+            StripColor high = { low_brightness_, default_brightness_, low_brightness_ };
+            ShowAudioLevel(low, high);
             break;
         }
         case kDeviceStateUpgrading: {
@@ -2,6 +2,7 @@
 #define _CIRCULAR_STRIP_H_
 
 #include "led.h"
+#include "strip_effect.h"
 #include <driver/gpio.h>
 #include <led_strip.h>
 #include <esp_timer.h>
@@ -12,8 +13,11 @@
 #define DEFAULT_BRIGHTNESS 32
 #define LOW_BRIGHTNESS 4
 
-struct StripColor {
-    uint8_t red = 0, green = 0, blue = 0;
+struct StripStatistics {
+    uint32_t wakeups = 0;           // Timer callbacks
+    uint32_t refreshes = 0;         // Frames pushed to the strip
+    uint32_t skipped = 0;           // Frames identical to the one on the strip
+    int64_t render_time_us = 0;     // Time spent rendering and pushing frames
 };
 
 class CircularStrip : public Led {
@@ -28,6 +32,9 @@ public:
     void Blink(StripColor color, int interval_ms);
     void Breathe(StripColor low, StripColor high, int interval_ms);
     void Scroll(StripColor low, StripColor high, int length, int interval_ms);
+    // Light a share of the strip that follows the speaker level
+    void ShowAudioLevel(StripColor low, StripColor high);
+    StripStatistics GetStatistics();
 
 private:
     std::mutex mutex_;
@@ -35,15 +42,26 @@ private:
     led_strip_handle_t led_strip_ = nullptr;
     int max_leds_ = 0;
     std::vector<StripColor> colors_;
+    std::vector<StripColor> pixels_;    // Colors currently shown on the strip
+    std::vector<StripColor> frame_;     // Render target for the next frame
     int blink_counter_ = 0;
     int blink_interval_ms_ = 0;
     esp_timer_handle_t strip_timer_ = nullptr;
-    std::function<void()> strip_callback_ = nullptr;
+    StripEffect effect_;
+    size_t keyframe_index_ = 0;
+    int tick_ms_ = 0;
+    bool follow_level_ = false;
+    StripColor level_low_;
+    StripColor level_high_;
+    StripStatistics statistics_;
 
     uint8_t default_brightness_ = DEFAULT_BRIGHTNESS;
     uint8_t low_brightness_ = LOW_BRIGHTNESS;
 
-    void StartStripTask(int interval_ms, std::function<void()> cb);
+    void StartEffect(StripEffect&& effect, int interval_ms);
+    void ShowKeyframe();
+    void ShowFrame(const std::vector<StripColor>& frame);
+    void ShowLevelFrame();
     void Rainbow(StripColor low, StripColor high, int interval_ms);
     void FadeOut(int interval_ms);
 };
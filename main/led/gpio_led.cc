@@ -16,6 +16,10 @@
 
 #define BLINK_INFINITE -1
 
+// Speaking brightness follows the output level, polled at the level meter's 30 Hz
+#define LEVEL_INTERVAL_MS 33
+#define LEVEL_FLOOR 64              // Share of the brightness kept during silence, out of 255
+
 // GPIO_LED
 #define LEDC_LS_TIMER          LEDC_TIMER_1
 #define LEDC_LS_MODE           LEDC_LOW_SPEED_MODE
@@ -109,6 +113,7 @@ void GpioLed::TurnOn() {
 
     std::lock_guard<std::mutex> lock(mutex_);
     esp_timer_stop(blink_timer_);
+    follow_level_ = false;
     ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
     ledc_set_duty(ledc_channel_.speed_mode, ledc_channel_.channel, duty_);
     ledc_update_duty(ledc_channel_.speed_mode, ledc_channel_.channel);
@@ -121,6 +126,7 @@ void GpioLed::TurnOff() {
 
     std::lock_guard<std::mutex> lock(mutex_);
     esp_timer_stop(blink_timer_);
+    follow_level_ = false;
     ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
     ledc_set_duty(ledc_channel_.speed_mode, ledc_channel_.channel, 0);
     ledc_update_duty(ledc_channel_.speed_mode, ledc_channel_.channel);
@@ -145,6 +151,7 @@ void GpioLed::StartBlinkTask(int times, int interval_ms) {
 
     std::lock_guard<std::mutex> lock(mutex_);
     esp_timer_stop(blink_timer_);
+    follow_level_ = false;
     ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
 
     blink_counter_ = times * 2;
@@ -152,8 +159,31 @@ void GpioLed::StartBlinkTask(int times, int interval_ms) {
     esp_timer_start_periodic(blink_timer_, interval_ms * 1000);
 }
 
+void GpioLed::StartLevelTask() {
+    if (!ledc_initialized_) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    esp_timer_stop(blink_timer_);
+    ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
+    follow_level_ = true;
+    level_duty_ = UINT32_MAX;
+    esp_timer_start_periodic(blink_timer_, LEVEL_INTERVAL_MS * 1000);
+}
+
 void GpioLed::OnBlinkTimer() {
     std::lock_guard<std::mutex> lock(mutex_);
+    if (follow_level_) {
+        auto level = Application::GetInstance().GetAudioService().GetOutputLevel();
+        uint32_t duty = duty_ * (LEVEL_FLOOR + level.rms * (255 - LEVEL_FLOOR) / 255) / 255;
+        if (duty != level_duty_) {
+            level_duty_ = duty;
+            ledc_set_duty(ledc_channel_.speed_mode, ledc_channel_.channel, duty);
+            ledc_update_duty(ledc_channel_.speed_mode, ledc_channel_.channel);
+        }
+        return;
+    }
     blink_counter_--;
     if (blink_counter_ & 1) {
         ledc_set_duty(ledc_channel_.speed_mode, ledc_channel_.channel, duty_);
@@ -174,6 +204,7 @@ void GpioLed::StartFadeTask() {
 
     std::lock_guard<std::mutex> lock(mutex_);
     esp_timer_stop(blink_timer_);
+    follow_level_ = false;
     ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
     fade_up_ = true;
     ledc_set_fade_with_time(ledc_channel_.speed_mode,
@@ -232,7 +263,7 @@ void GpioLed::OnStateChanged() {
             break;
         case kDeviceStateSpeaking:
             SetBrightness(SPEAKING_BRIGHTNESS);
-            TurnOn();
+            StartLevelTask();
             break;
         case kDeviceStateUpgrading:
             SetBrightness(UPGRADING_BRIGHTNESS);
@@ -32,6 +32,8 @@ class GpioLed : public Led {
     int blink_interval_ms_ = 0;
     esp_timer_handle_t blink_timer_ = nullptr;
     bool fade_up_ = true;
+    bool follow_level_ = false;     // Blink timer tracks the speaker level instead of blinking
+    uint32_t level_duty_ = 0;
 
     void StartBlinkTask(int times, int interval_ms);
     void OnBlinkTimer();
@@ -39,6 +41,7 @@ class GpioLed : public Led {
     void BlinkOnce();
     void Blink(int times, int interval_ms);
     void StartContinuousBlink(int interval_ms);
+    void StartLevelTask();
     void StartFadeTask();
     void OnFadeEnd();
     static bool IRAM_ATTR FadeCallback(const ledc_cb_param_t *param, void *user_arg);
@@ -0,0 +1,121 @@
+#include "strip_effect.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#define STRIP_GAMMA 2.2f
+
+// Interpolate one channel in perceptual space and map it back to PWM duty
+static uint8_t Interpolate(uint8_t low, uint8_t high, int step, int steps) {
+    if (step <= 0) {
+        return low;
+    }
+    if (step >= steps) {
+        return high;
+    }
+    float low_level = powf(low / 255.0f, 1.0f / STRIP_GAMMA);
+    float high_level = powf(high / 255.0f, 1.0f / STRIP_GAMMA);
+    float level = low_level + (high_level - low_level) * step / steps;
+    return (uint8_t)lroundf(255.0f * powf(level, STRIP_GAMMA));
+}
+
+void StripEffect::AddKeyframe(const StripKeyframe& keyframe) {
+    if (!keyframes_.empty()) {
+        auto& last = keyframes_.back();
+        if (keyframe.frame < 0 && last.frame < 0 && last.color == keyframe.color &&
+            last.background == keyframe.background && last.offset == keyframe.offset &&
+            last.length == keyframe.length) {
+            last.hold += keyframe.hold;
+            return;
+        }
+    }
+    keyframes_.push_back(keyframe);
+}
+
+StripEffect StripEffect::Blink(int leds, StripColor color) {
+    StripEffect effect;
+    effect.leds_ = leds;
+    StripKeyframe on;
+    on.color = color;
+    on.length = leds;
+    effect.AddKeyframe(on);
+    effect.AddKeyframe(StripKeyframe());
+    return effect;
+}
+
+StripEffect StripEffect::Breathe(int leds, StripColor low, StripColor high) {
+    StripEffect effect;
+    effect.leds_ = leds;
+    // One tick per unit of the widest channel, the same period as stepping colors by one
+    int steps = std::max({abs(high.red - low.red), abs(high.green - low.green), abs(high.blue - low.blue)});
+    for (int i = 0; i < 2 * std::max(steps, 1); i++) {
+        int step = i <= steps ? i : 2 * steps - i;
+        StripKeyframe keyframe;
+        keyframe.background.red = Interpolate(low.red, high.red, step, steps);
+        keyframe.background.green = Interpolate(low.green, high.green, step, steps);
+        keyframe.background.blue = Interpolate(low.blue, high.blue, step, steps);
+        effect.AddKeyframe(keyframe);
+    }
+    // The cycle wraps around, fold a hold at the end into the first keyframe
+    if (effect.keyframes_.size() > 1 && effect.keyframes_.back().background == effect.keyframes_.front().background) {
+        effect.keyframes_.front().hold += effect.keyframes_.back().hold;
+        effect.keyframes_.pop_back();
+    }
+    return effect;
+}
+
+StripEffect StripEffect::Scroll(int leds, StripColor low, StripColor high, int length) {
+    StripEffect effect;
+    effect.leds_ = leds;
+    for (int offset = 0; offset < leds; offset++) {
+        StripKeyframe keyframe;
+        keyframe.color = high;
+        keyframe.background = low;
+        keyframe.offset = offset;
+        keyframe.length = std::min(length, leds);
+        effect.AddKeyframe(keyframe);
+    }
+    return effect;
+}
+
+StripEffect StripEffect::FadeOut(const std::vector<StripColor>& colors) {
+    StripEffect effect;
+    effect.leds_ = colors.size();
+    effect.loop_ = false;
+    if (colors.empty()) {
+        return effect;
+    }
+    // Halve every pixel per tick, a stored frame each until the strip is dark
+    std::vector<StripColor> frame = colors;
+    bool all_off = false;
+    while (!all_off) {
+        all_off = true;
+        for (auto& color : frame) {
+            color.red /= 2;
+            color.green /= 2;
+            color.blue /= 2;
+            if (color.red != 0 || color.green != 0 || color.blue != 0) {
+                all_off = false;
+            }
+        }
+        StripKeyframe keyframe;
+        keyframe.frame = effect.frames_.size() / effect.leds_;
+        effect.frames_.insert(effect.frames_.end(), frame.begin(), frame.end());
+        effect.AddKeyframe(keyframe);
+    }
+    return effect;
+}
+
+void StripEffect::Render(size_t index, std::vector<StripColor>& frame) const {
+    const auto& keyframe = keyframes_[index];
+    frame.resize(leds_);
+    for (int i = 0; i < leds_; i++) {
+        if (keyframe.frame >= 0) {
+            frame[i] = frames_[keyframe.frame * leds_ + i];
+        } else {
+            int position = (i - keyframe.offset + leds_) % leds_;
+            frame[i] = position < keyframe.length ? keyframe.color : keyframe.background;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef _STRIP_EFFECT_H_
+#define _STRIP_EFFECT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct StripColor {
+    uint8_t red = 0, green = 0, blue = 0;
+
+    bool operator==(const StripColor& other) const {
+        return red == other.red && green == other.green && blue == other.blue;
+    }
+    bool operator!=(const StripColor& other) const {
+        return !(*this == other);
+    }
+};
+
+// One step of an effect: a lit run of pixels over a background, or a stored frame
+struct StripKeyframe {
+    StripColor color;           // Pixels inside the lit run
+    StripColor background;      // Pixels outside the lit run
+    uint16_t offset = 0;        // First pixel of the lit run
+    uint16_t length = 0;        // Lit run length, wraps around the strip
+    int16_t frame = -1;         // Stored frame used instead of the run, -1 if none
+    uint16_t hold = 1;          // Timer ticks this keyframe stays on the strip
+};
+
+/*
+ * An LED effect compiled once into a keyframe table. Gradients are interpolated
+ * in perceptual space and gamma corrected when compiling, consecutive identical
+ * keyframes are merged into one longer hold, so playing an effect only renders
+ * frames that differ and the timer only wakes up when the strip has to change.
+ */
+class StripEffect {
+public:
+    StripEffect() = default;
+
+    static StripEffect Blink(int leds, StripColor color);
+    static StripEffect Breathe(int leds, StripColor low, StripColor high);
+    static StripEffect Scroll(int leds, StripColor low, StripColor high, int length);
+    static StripEffect FadeOut(const std::vector<StripColor>& colors);
+
+    bool empty() const { return keyframes_.empty(); }
+    bool loops() const { return loop_; }
+    size_t size() const { return keyframes_.size(); }
+    const StripKeyframe& keyframe(size_t index) const { return keyframes_[index]; }
+
+    // Render a keyframe into a frame of one color per pixel
+    void Render(size_t index, std::vector<StripColor>& frame) const;
+
+private:
+    int leds_ = 0;
+    bool loop_ = true;
+    std::vector<StripKeyframe> keyframes_;
+    std::vector<StripColor> frames_;    // Stored frames, leds_ pixels each
+
+    void AddKeyframe(const StripKeyframe& keyframe);
+};
+
+#endif // _STRIP_EFFECT_H_
@@ -8,7 +8,6 @@
 #include <esp_app_desc.h>
 #include <algorithm>
 #include <cstring>
-#include <esp_pthread.h>
 
 #include "application.h"
 #include "display.h"
@@ -17,6 +16,16 @@
 #define TAG "MCP"
 
 #define DEFAULT_TOOLCALL_STACK_SIZE 6144
+#define LARGE_TOOLCALL_STACK_SIZE 12288
+// Worker stacks live in internal RAM for good, so targets without PSRAM keep a single small worker
+#if CONFIG_SPIRAM
+#define SMALL_TOOLCALL_WORKERS 2
+#else
+#define SMALL_TOOLCALL_WORKERS 1
+#endif
+// The large worker is only created the first time a tool asks for a bigger stack
+#define LARGE_TOOLCALL_WORKERS 1
+#define MAX_TOOLCALLS_IN_QUEUE 8
 
 McpServer::McpServer() {
 }
@@ -108,13 +117,16 @@ void McpServer::AddCommonTools() {
 }
 
 void McpServer::AddTool(McpTool* tool) {
-    // Prevent adding duplicate tools
-    if (std::find_if(tools_.begin(), tools_.end(), [tool](const McpTool* t) { return t->name() == tool->name(); }) != tools_.end()) {
+    // Prevent adding duplicate tools, the index keys point into the tool's own name
+    if (!tool_index_.emplace(tool->name(), tool).second) {
         ESP_LOGW(TAG, "Tool %s already added", tool->name().c_str());
         return;
     }
 
     ESP_LOGI(TAG, "Add tool: %s", tool->name().c_str());
+    if (tool->json().empty()) {
+        ESP_LOGW(TAG, "Tool %s schema not cached, it is serialized on every tools/list", tool->name().c_str());
+    }
     tools_.push_back(tool);
 }
 
@@ -256,7 +268,9 @@ void McpServer::ReplyError(int id, const std::string& message) {
 
 void McpServer::GetToolsList(int id, const std::string& cursor) {
     const int max_payload_size = 8000;
-    std::string json = "{\"tools\":[";
+    std::string json;
+    json.reserve(max_payload_size);
+    json = "{\"tools\":[";
     
     bool found_cursor = cursor.empty();
     auto it = tools_.begin();
@@ -273,15 +287,22 @@ void McpServer::GetToolsList(int id, const std::string& cursor) {
             }
         }
         
-        // Check size before adding tool
-        std::string tool_json = (*it)->to_json() + ",";
-        if (json.length() + tool_json.length() + 30 > max_payload_size) {
+        // Check size before adding the pre-serialized tool
+        std::string uncached_json;
+        auto tool_json = (*it)->json();
+        if (tool_json.empty()) {
+            // The schema did not fit in memory at registration, serialize it for this call only
+            uncached_json = (*it)->to_json();
+            tool_json = uncached_json;
+        }
+        if (json.length() + tool_json.length() + 1 + 30 > max_payload_size) {
             // If adding this tool would exceed size limit, set next_cursor and exit loop
             next_cursor = (*it)->name();
             break;
         }
         
-        json += tool_json;
+        json.append(tool_json);
+        json.push_back(',');
         ++it;
     }
     
@@ -306,129 +327,148 @@ void McpServer::GetToolsList(int id, const std::string& cursor) {
 }
 
 void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size) {
-    auto tool_iter = std::find_if(tools_.begin(), tools_.end(), 
-                                 [&tool_name](const McpTool* tool) { 
-                                     return tool->name() == tool_name; 
-                                 });
-    
-    if (tool_iter == tools_.end()) {
+    auto tool_iter = tool_index_.find(tool_name);
+    if (tool_iter == tool_index_.end()) {
         ESP_LOGE(TAG, "tools/call: Unknown tool: %s", tool_name.c_str());
         ReplyError(id, "Unknown tool: " + tool_name);
         return;
     }
 
-    PropertyList arguments = (*tool_iter)->properties();
-    try {
-        for (auto& argument : arguments) {
-            bool found = false;
-            if (cJSON_IsObject(tool_arguments)) {
-                auto value = cJSON_GetObjectItem(tool_arguments, argument.name().c_str());
-                if (argument.type() == kPropertyTypeBoolean && cJSON_IsBool(value)) {
-                    argument.set_value<bool>(value->valueint == 1);
-                    found = true;
-                } else if (argument.type() == kPropertyTypeInteger && cJSON_IsNumber(value)) {
-                    argument.set_value<int>(value->valueint);
-                    found = true;
-                } else if (argument.type() == kPropertyTypeString && cJSON_IsString(value)) {
-                    argument.set_value<std::string>(value->valuestring);
-                    found = true;
+    McpToolCall call(id, tool_iter->second);
+    auto& arguments = *call.arguments;
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        auto& argument = arguments.at(i);
+        bool found = false;
+        if (cJSON_IsObject(tool_arguments)) {
+            auto value = cJSON_GetObjectItem(tool_arguments, argument.name().c_str());
+            if (argument.type() == kPropertyTypeBoolean && cJSON_IsBool(value)) {
+                argument.set_value<bool>(value->valueint == 1);
+                found = true;
+            } else if (argument.type() == kPropertyTypeInteger && cJSON_IsNumber(value)) {
+                if (!argument.in_range(value->valueint)) {
+                    ESP_LOGE(TAG, "tools/call: Argument %s out of range: %d", argument.name().c_str(), value->valueint);
+                    ReplyError(id, "Argument out of range: " + argument.name());
+                    return;
                 }
+                argument.set_value<int>(value->valueint);
+                found = true;
+            } else if (argument.type() == kPropertyTypeString && cJSON_IsString(value)) {
+                argument.set_value<std::string>(value->valuestring);
+                found = true;
             }
+        }
 
-            if (!argument.has_default_value() && !found) {
-                ESP_LOGE(TAG, "tools/call: Missing valid argument: %s", argument.name().c_str());
-                ReplyError(id, "Missing valid argument: " + argument.name());
-                return;
-            }
+        if (!argument.has_default_value() && !found) {
+            ESP_LOGE(TAG, "tools/call: Missing valid argument: %s", argument.name().c_str());
+            ReplyError(id, "Missing valid argument: " + argument.name());
+            return;
+        }
+    }
+
+    auto stack_class = stack_size > DEFAULT_TOOLCALL_STACK_SIZE ? kMcpToolStackLarge : kMcpToolStackSmall;
+    if (stack_size > LARGE_TOOLCALL_STACK_SIZE) {
+        ESP_LOGW(TAG, "tools/call: %s requested %d bytes of stack, using %d", tool_name.c_str(), stack_size, LARGE_TOOLCALL_STACK_SIZE);
+    }
+
+    StartToolCallWorkers(kMcpToolStackSmall);
+    if (stack_class == kMcpToolStackLarge) {
+        StartToolCallWorkers(kMcpToolStackLarge);
+    }
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(tool_call_mutex_);
+        if (tool_call_workers_[stack_class] == 0) {
+            // The large worker could not be allocated, try the small ones instead
+            stack_class = kMcpToolStackSmall;
         }
-    } catch (const std::exception& e) {
-        ESP_LOGE(TAG, "tools/call: Argument parsing error: %s", e.what());
-        ReplyError(id, "Argument parsing error: " + std::string(e.what()));
+        auto& queue = tool_call_queues_[stack_class];
+        if (tool_call_workers_[stack_class] > 0 && queue.size() < MAX_TOOLCALLS_IN_QUEUE) {
+            queue.push_back(std::move(call));
+            queued = true;
+        }
+    }
+    if (queued) {
+        tool_call_cv_.notify_all();
         return;
     }
 
-    // Check system resources
-    size_t free_heap = esp_get_free_heap_size();
-    UBaseType_t task_count = uxTaskGetNumberOfTasks();
-    
-    ESP_LOGI(TAG, "Tool call %s - heap: %d, tasks: %d", 
-             tool_name.c_str(), (int)free_heap, (int)task_count);
-
-    // Configure thread parameters with better settings for ESP32
-    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
-    cfg.thread_name = "mcp_tool";
-    cfg.stack_size = std::max(static_cast<size_t>(stack_size), static_cast<size_t>(4096));
-    cfg.prio = 5; // Higher priority than default
-    cfg.inherit_cfg = false; // Don't inherit config to reduce overhead
-    esp_pthread_set_cfg(&cfg);
-
-    // Try to free up some tasks before creating new one
-    if (task_count >= 19) {
-        ESP_LOGW(TAG, "High task count (%d), attempting cleanup before tool execution", (int)task_count);
-        vTaskDelay(pdMS_TO_TICKS(10)); // Small delay to let other tasks finish
-        
-        // Check again after delay
-        task_count = uxTaskGetNumberOfTasks();
-        ESP_LOGI(TAG, "Task count after cleanup delay: %d", (int)task_count);
+    ESP_LOGW(TAG, "tools/call: No worker available, rejecting %s", tool_name.c_str());
+    ReplyError(id, "Too many pending tool calls");
+}
+
+void McpServer::StartToolCallWorkers(McpToolStackClass stack_class) {
+    std::lock_guard<std::mutex> lock(tool_call_mutex_);
+    if (tool_call_workers_started_[stack_class]) {
+        return;
     }
+    tool_call_workers_started_[stack_class] = true;
 
-    // Create thread with better error handling and retry
-    int retry_count = 0;
-    const int max_retries = 3;
-    
-    while (retry_count < max_retries) {
+    bool large = stack_class == kMcpToolStackLarge;
+    size_t stack_size = large ? LARGE_TOOLCALL_STACK_SIZE : DEFAULT_TOOLCALL_STACK_SIZE;
+    int count = large ? LARGE_TOOLCALL_WORKERS : SMALL_TOOLCALL_WORKERS;
+    for (int i = 0; i < count; ++i) {
+        // Tools may write to flash (e.g. Settings), so the stacks must stay in internal RAM
+        auto stack = (StackType_t*)heap_caps_malloc(stack_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        auto buffer = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+        if (stack == nullptr || buffer == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate tool call worker (stack: %u bytes)", stack_size);
+            heap_caps_free(stack);
+            heap_caps_free(buffer);
+            continue;
+        }
+
+        auto arg = new std::pair<McpServer*, McpToolStackClass>(this, stack_class);
+        xTaskCreateStatic([](void* arg) {
+            auto pair = (std::pair<McpServer*, McpToolStackClass>*)arg;
+            auto server = pair->first;
+            auto stack_class = pair->second;
+            delete pair;
+            server->ToolCallWorkerLoop(stack_class);
+            vTaskDelete(NULL);
+        }, large ? "mcp_tool_large" : "mcp_tool", stack_size, arg, 5, stack, buffer);
+        tool_call_workers_[stack_class]++;
+    }
+}
+
+void McpServer::ToolCallWorkerLoop(McpToolStackClass stack_class) {
+    auto& queue = tool_call_queues_[stack_class];
+    while (true) {
+        std::unique_lock<std::mutex> lock(tool_call_mutex_);
+        tool_call_cv_.wait(lock, [&queue]() { return !queue.empty(); });
+        auto call = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+
+        auto& tool_name = call.tool->name();
+        ESP_LOGI(TAG, "Executing tool: %s", tool_name.c_str());
         try {
-            ESP_LOGI(TAG, "Creating thread for tool call: %s (attempt %d/%d, stack: %d bytes)", 
-                     tool_name.c_str(), retry_count + 1, max_retries, (int)cfg.stack_size);
-            
-            tool_call_thread_ = std::thread([this, id, tool_iter, arguments = std::move(arguments), tool_name]() {
-                ESP_LOGI(TAG, "Executing tool: %s", tool_name.c_str());
-                
-                try {
-                    auto result = (*tool_iter)->Call(arguments);
-                    ESP_LOGI(TAG, "Tool %s completed", tool_name.c_str());
-                    ReplyResult(id, result);
-                } catch (const std::exception& e) {
-                    ESP_LOGE(TAG, "Tool execution error for %s: %s", tool_name.c_str(), e.what());
-                    ReplyError(id, "Tool execution failed: " + std::string(e.what()));
-                } catch (...) {
-                    ESP_LOGE(TAG, "Unknown error executing tool: %s", tool_name.c_str());
-                    ReplyError(id, "Tool execution failed: unknown error");
-                }
-            });
-            
-            tool_call_thread_.detach();
-            ESP_LOGI(TAG, "Tool thread created successfully for: %s", tool_name.c_str());
-            return; // Success!
-            
-        } catch (const std::system_error& e) {
-            retry_count++;
-            ESP_LOGW(TAG, "Failed to create thread for tool %s (attempt %d/%d): %s (error code: %d)", 
-                     tool_name.c_str(), retry_count, max_retries, e.what(), e.code().value());
-            
-            if (retry_count < max_retries) {
-                // Wait and reduce stack size for retry
-                vTaskDelay(pdMS_TO_TICKS(50 * retry_count)); // Increasing delay
-                
-                // Fix the type casting issue here:
-                size_t reduced_stack = (cfg.stack_size > 1024) ? cfg.stack_size - 1024 : 2048;
-                cfg.stack_size = std::max(reduced_stack, static_cast<size_t>(2048));
-                
-                esp_pthread_set_cfg(&cfg);
-                ESP_LOGI(TAG, "Retrying with reduced stack size: %d bytes", (int)cfg.stack_size);
-            }
+            auto result = call.tool->Call(*call.arguments);
+            ESP_LOGI(TAG, "Tool %s completed", tool_name.c_str());
+            ReplyResult(call.id, result);
+        } catch (const std::exception& e) {
+            ESP_LOGE(TAG, "Tool execution error for %s: %s", tool_name.c_str(), e.what());
+            ReplyError(call.id, "Tool execution failed: " + std::string(e.what()));
         } catch (...) {
-            retry_count++;
-            ESP_LOGE(TAG, "Unknown error creating thread for tool %s (attempt %d/%d)", 
-                     tool_name.c_str(), retry_count, max_retries);
-            
-            if (retry_count < max_retries) {
-                vTaskDelay(pdMS_TO_TICKS(50 * retry_count));
+            ESP_LOGE(TAG, "Unknown error executing tool: %s", tool_name.c_str());
+            ReplyError(call.id, "Tool execution failed: unknown error");
+        }
+    }
+}
+
+void McpServer::CancelPendingToolCalls() {
+    std::vector<int> cancelled_ids;
+    {
+        std::lock_guard<std::mutex> lock(tool_call_mutex_);
+        for (auto& queue : tool_call_queues_) {
+            for (auto& call : queue) {
+                cancelled_ids.push_back(call.id);
             }
+            queue.clear();
         }
     }
-    
-    // All retries failed
-    ESP_LOGE(TAG, "Failed to create thread for tool %s after %d attempts", tool_name.c_str(), max_retries);
-    ReplyError(id, "Failed to execute tool - system resources unavailable");
+
+    for (auto id : cancelled_ids) {
+        ESP_LOGW(TAG, "tools/call: Cancelled pending call %d", id);
+        ReplyError(id, "Tool call cancelled");
+    }
 }
\ No newline at end of file
@@ -4,13 +4,23 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
 #include <functional>
 #include <variant>
 #include <optional>
 #include <stdexcept>
-#include <thread>
+#include <string_view>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 #include <cJSON.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 // Add type alias
 using ReturnValue = std::variant<bool, int, std::string>;
@@ -66,6 +76,15 @@ public:
     inline bool has_range() const { return min_value_.has_value() && max_value_.has_value(); }
     inline int min_value() const { return min_value_.value_or(0); }
     inline int max_value() const { return max_value_.value_or(0); }
+    inline bool in_range(int value) const {
+        return (!min_value_.has_value() || value >= min_value_.value()) &&
+               (!max_value_.has_value() || value <= max_value_.value());
+    }
+
+    // Restore the value from the registered property without touching the name or limits
+    inline void reset_value(const Property& source) {
+        value_ = source.value_;
+    }
 
     template<typename T>
     inline T value() const {
@@ -86,7 +105,7 @@ public:
         value_ = value;
     }
 
-    std::string to_json() const {
+    cJSON* to_cjson() const {
         cJSON *json = cJSON_CreateObject();
         
         if (type_ == kPropertyTypeBoolean) {
@@ -111,7 +130,11 @@ public:
                 cJSON_AddStringToObject(json, "default", value<std::string>().c_str());
             }
         }
-        
+        return json;
+    }
+
+    std::string to_json() const {
+        cJSON *json = to_cjson();
         char *json_str = cJSON_PrintUnformatted(json);
         std::string result(json_str);
         cJSON_free(json_str);
@@ -133,14 +156,26 @@ public:
     }
 
     const Property& operator[](const std::string& name) const {
+        auto property = Find(name);
+        if (property == nullptr) {
+            throw std::runtime_error("Property not found: " + name);
+        }
+        return *property;
+    }
+
+    const Property* Find(std::string_view name) const {
         for (const auto& property : properties_) {
             if (property.name() == name) {
-                return property;
+                return &property;
             }
         }
-        throw std::runtime_error("Property not found: " + name);
+        return nullptr;
     }
 
+    inline size_t size() const { return properties_.size(); }
+    inline Property& at(size_t index) { return properties_[index]; }
+    inline const Property& at(size_t index) const { return properties_[index]; }
+
     auto begin() { return properties_.begin(); }
     auto end() { return properties_.end(); }
 
@@ -154,14 +189,16 @@ public:
         return required;
     }
 
-    std::string to_json() const {
+    cJSON* to_cjson() const {
         cJSON *json = cJSON_CreateObject();
-        
         for (const auto& property : properties_) {
-            cJSON *prop_json = cJSON_Parse(property.to_json().c_str());
-            cJSON_AddItemToObject(json, property.name().c_str(), prop_json);
+            cJSON_AddItemToObject(json, property.name().c_str(), property.to_cjson());
         }
-        
+        return json;
+    }
+
+    std::string to_json() const {
+        cJSON *json = to_cjson();
         char *json_str = cJSON_PrintUnformatted(json);
         std::string result(json_str);
         cJSON_free(json_str);
@@ -177,6 +214,25 @@ private:
     std::string description_;
     PropertyList properties_;
     std::function<ReturnValue(const PropertyList&)> callback_;
+    // The schema never changes after registration, so it is serialized once (into PSRAM if available)
+    char* json_ = nullptr;
+    size_t json_length_ = 0;
+    // Preallocated arguments bound in place for each call, a copy is only made while it is in use
+    PropertyList argument_slot_;
+    std::atomic<bool> argument_slot_busy_ = false;
+
+    void CacheJson() {
+        std::string json = to_json();
+        json_ = (char*)heap_caps_malloc(json.size() + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (json_ == nullptr) {
+            // Fallback to internal RAM if SPIRAM allocation fails
+            json_ = (char*)heap_caps_malloc(json.size() + 1, MALLOC_CAP_8BIT);
+        }
+        if (json_ != nullptr) {
+            memcpy(json_, json.c_str(), json.size() + 1);
+            json_length_ = json.size();
+        }
+    }
 
 public:
     McpTool(const std::string& name, 
@@ -186,11 +242,40 @@ public:
         : name_(name), 
         description_(description), 
         properties_(properties), 
-        callback_(callback) {}
+        callback_(callback),
+        argument_slot_(properties) {
+        CacheJson();
+    }
+
+    McpTool(const McpTool&) = delete;
+    McpTool& operator=(const McpTool&) = delete;
+
+    ~McpTool() {
+        if (json_ != nullptr) {
+            heap_caps_free(json_);
+        }
+    }
 
     inline const std::string& name() const { return name_; }
     inline const std::string& description() const { return description_; }
     inline const PropertyList& properties() const { return properties_; }
+    // Empty if the schema could not be cached, callers fall back to to_json()
+    inline std::string_view json() const { return std::string_view(json_ != nullptr ? json_ : "", json_length_); }
+
+    // Returns the argument slot reset to the default values, or nullptr if another call still holds it
+    PropertyList* AcquireArgumentSlot() {
+        if (argument_slot_busy_.exchange(true)) {
+            return nullptr;
+        }
+        for (size_t i = 0; i < argument_slot_.size(); ++i) {
+            argument_slot_.at(i).reset_value(properties_.at(i));
+        }
+        return &argument_slot_;
+    }
+
+    void ReleaseArgumentSlot() {
+        argument_slot_busy_ = false;
+    }
 
     std::string to_json() const {
         std::vector<std::string> required = properties_.GetRequired();
@@ -202,8 +287,7 @@ public:
         cJSON *input_schema = cJSON_CreateObject();
         cJSON_AddStringToObject(input_schema, "type", "object");
         
-        cJSON *properties = cJSON_Parse(properties_.to_json().c_str());
-        cJSON_AddItemToObject(input_schema, "properties", properties);
+        cJSON_AddItemToObject(input_schema, "properties", properties_.to_cjson());
         
         if (!required.empty()) {
             cJSON *required_array = cJSON_CreateArray();
@@ -249,6 +333,61 @@ public:
     }
 };
 
+// Tool calls run on a fixed pool of workers, grouped by the stack size they need
+enum McpToolStackClass {
+    kMcpToolStackSmall,
+    kMcpToolStackLarge,
+    kMcpToolStackClassCount,
+};
+
+class McpToolCall {
+public:
+    int id = 0;
+    McpTool* tool = nullptr;
+    PropertyList* arguments = nullptr;
+
+    McpToolCall(int id, McpTool* tool) : id(id), tool(tool) {
+        arguments = tool->AcquireArgumentSlot();
+        if (arguments == nullptr) {
+            // The same tool is still running, fall back to a private copy
+            owned_arguments_ = std::make_unique<PropertyList>(tool->properties());
+            arguments = owned_arguments_.get();
+        }
+    }
+
+    McpToolCall(McpToolCall&& other) noexcept
+        : id(other.id), tool(other.tool), arguments(other.arguments), owned_arguments_(std::move(other.owned_arguments_)) {
+        other.arguments = nullptr;
+    }
+
+    McpToolCall& operator=(McpToolCall&& other) noexcept {
+        if (this != &other) {
+            Release();
+            id = other.id;
+            tool = other.tool;
+            arguments = other.arguments;
+            owned_arguments_ = std::move(other.owned_arguments_);
+            other.arguments = nullptr;
+        }
+        return *this;
+    }
+
+    ~McpToolCall() {
+        Release();
+    }
+
+private:
+    std::unique_ptr<PropertyList> owned_arguments_;
+
+    void Release() {
+        if (arguments != nullptr && owned_arguments_ == nullptr) {
+            tool->ReleaseArgumentSlot();
+        }
+        arguments = nullptr;
+        owned_arguments_.reset();
+    }
+};
+
 class McpServer {
 public:
     static McpServer& GetInstance() {
@@ -261,6 +400,8 @@ public:
     void AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback);
     void ParseMessage(const cJSON* json);
     void ParseMessage(const std::string& message);
+    // Drop the tool calls that are still waiting for a worker, running calls are not interrupted
+    void CancelPendingToolCalls();
 
 private:
     McpServer();
@@ -273,9 +414,17 @@ private:
 
     void GetToolsList(int id, const std::string& cursor);
     void DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size);
+    void StartToolCallWorkers(McpToolStackClass stack_class);
+    void ToolCallWorkerLoop(McpToolStackClass stack_class);
 
     std::vector<McpTool*> tools_;
-    std::thread tool_call_thread_;
+    std::unordered_map<std::string_view, McpTool*> tool_index_;
+
+    std::mutex tool_call_mutex_;
+    std::condition_variable tool_call_cv_;
+    std::deque<McpToolCall> tool_call_queues_[kMcpToolStackClassCount];
+    int tool_call_workers_[kMcpToolStackClassCount] = {};
+    bool tool_call_workers_started_[kMcpToolStackClassCount] = {};
 };
 
 #endif // MCP_SERVER_H
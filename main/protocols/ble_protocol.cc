@@ -16,21 +16,94 @@ static const char* TAG = "BleProtocol";
 #include "services/gap/ble_svc_gap.h"
 #include "services/gatt/ble_svc_gatt.h"
 #include "store/config/ble_store_config.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 
 #include <string>
 #include <atomic>
 #include <map>
+#include <mutex>
+#include <condition_variable>
 #include <vector>
 #include <memory>
+#include <cstring>
+
+#ifdef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define BLE_MAX_CONNECTIONS std::min(CONFIG_BT_NIMBLE_MAX_CONNECTIONS, 3)
+#else
+#define BLE_MAX_CONNECTIONS 1
+#endif
+
+// ATT MTU requested from every client, with LE data length extension a 512 byte
+// notification only needs two or three link layer packets
+#define BLE_PREFERRED_MTU 512
+#define BLE_DATA_LEN_TX_OCTETS 251
+#define BLE_DATA_LEN_TX_TIME 2120
+
+// Binary frames: message id (1), flags (1), fragment index (2, little endian),
+// the first fragment is followed by the total message length (2, little endian)
+#define BLE_FRAME_HEADER_SIZE 4
+#define BLE_FRAME_LENGTH_SIZE 2
+#define BLE_FRAME_FLAG_FIRST 0x01
+#define BLE_FRAME_FLAG_LAST 0x02
+#define BLE_MAX_MESSAGE_SIZE 4096
+
+// A partial message is dropped when its next fragment does not arrive in time
+#define BLE_REASSEMBLY_TIMEOUT_MS 2000
+// Notifications are retried while the host is out of mbufs instead of pacing every chunk
+#define BLE_NOTIFY_RETRY_MS 5
+#define BLE_NOTIFY_MAX_RETRIES 100
+
+// Audio relay: the phone forwards Opus frames between the device and the server.
+// Packets use the BinaryProtocol3 header, a 60ms frame of 16kbps Opus is 120 bytes and
+// fits one notification, about 17 notifications per second in each direction.
+#define BLE_AUDIO_TYPE_OPUS 0
+#define BLE_AUDIO_TYPE_CREDIT 1     // reserved = number of frames the receiver may take
+#define BLE_AUDIO_TYPE_END 2        // The relay finished the downlink utterance
+#define BLE_AUDIO_SAMPLE_RATE 16000
+#define BLE_AUDIO_FRAME_DURATION_MS 60
+#define BLE_AUDIO_DOWNLINK_WINDOW 8     // Frames granted to the relay or waiting to be decoded, 480ms of audio
+#define BLE_AUDIO_CREDIT_BATCH 4        // Downlink credits are granted in batches
+#define BLE_AUDIO_MAX_CREDITS 40        // Cap for uplink credits granted by the relay
+#define BLE_AUDIO_CREDIT_WAIT_MS 120    // Two frame durations
 
 // Santa-Bot custom UUIDs (128-bit for uniqueness and proper identification)
 static const ble_uuid128_t santa_bot_service_uuid = BLE_UUID128_INIT(SANTA_BOT_SERVICE_UUID_128);
 static const ble_uuid128_t santa_bot_characteristic_uuid = BLE_UUID128_INIT(SANTA_BOT_CHARACTERISTIC_UUID_128);
+static const ble_uuid128_t santa_bot_frame_characteristic_uuid = BLE_UUID128_INIT(SANTA_BOT_FRAME_CHARACTERISTIC_UUID_128);
+static const ble_uuid128_t santa_bot_audio_characteristic_uuid = BLE_UUID128_INIT(SANTA_BOT_AUDIO_CHARACTERISTIC_UUID_128);
+
+// Per-connection state, only the NimBLE host task reassembles incoming frames
+struct BleConnection {
+    uint16_t handle = BLE_HS_CONN_HANDLE_NONE;
+    uint16_t mtu = BLE_ATT_MTU_DFLT;
+    bool framed = false;            // The client talks binary frames on the frame characteristic
+    uint8_t next_message_id = 0;    // Id of the next outgoing framed message
+
+    uint8_t* buffer = nullptr;      // Preallocated reassembly buffer of BLE_MAX_MESSAGE_SIZE bytes
+    size_t length = 0;              // Bytes of the current message received so far
+    size_t total_length = 0;        // Announced length of the current message, 0 when idle
+    uint8_t message_id = 0;
+    uint16_t next_index = 0;
+    int64_t last_fragment_time = 0;
+};
 
 // Global state
-static uint16_t conn_handle = BLE_HS_CONN_HANDLE_NONE;
+static BleConnection connections[BLE_MAX_CONNECTIONS];
+static std::mutex connections_mutex;
+static uint16_t active_conn_handle = BLE_HS_CONN_HANDLE_NONE;  // Connection that sent the last command
 static uint16_t chr_val_handle;
-static std::atomic<bool> is_connected{false};
+static uint16_t frame_chr_val_handle;
+static uint16_t audio_chr_val_handle;
+static std::atomic<int> connection_count{0};
+
+// Audio relay state, credits are counted in frames
+static std::mutex audio_mutex;
+static std::condition_variable audio_credit_cv;
+static uint16_t relay_conn_handle = BLE_HS_CONN_HANDLE_NONE;   // Client subscribed to the audio characteristic
+static int uplink_credits = 0;
+static int downlink_outstanding = 0;                            // Downlink credits the relay has not used yet
+static BleAudioStatistics audio_statistics;
 static BleProtocol::CommandCallback command_callback;
 static BleProtocol::ConnectionStateCallback connection_callback;
 
@@ -43,14 +116,39 @@ struct ChunkData {
     uint32_t total_chunks;
     uint32_t received_chunks;
     uint32_t message_id;
+    int64_t last_update_time;
     
     ChunkData(uint32_t total, uint32_t id) : total_chunks(total), received_chunks(0), message_id(id) {
         chunks.resize(total);
+        last_update_time = esp_timer_get_time();
     }
 };
 
 static std::map<uint32_t, ChunkData> chunk_storage;
 
+// Free partial JSON chunked messages whose sender went away
+static void purge_stale_chunks() {
+    int64_t now = esp_timer_get_time();
+    for (auto it = chunk_storage.begin(); it != chunk_storage.end();) {
+        if (now - it->second.last_update_time > BLE_REASSEMBLY_TIMEOUT_MS * 1000LL) {
+            ESP_LOGW(TAG, "Dropping stale chunked message %lu (%lu/%lu chunks)", (unsigned long)it->first,
+                     (unsigned long)it->second.received_chunks, (unsigned long)it->second.total_chunks);
+            it = chunk_storage.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static BleConnection* find_connection(uint16_t handle) {
+    for (auto& conn : connections) {
+        if (conn.handle == handle) {
+            return &conn;
+        }
+    }
+    return nullptr;
+}
+
 // Helper function to process incoming commands and handle chunking
 static void process_incoming_command(const std::string& command_str) {
     ESP_LOGI(TAG, "Processing incoming command: %s", command_str.c_str());
@@ -98,6 +196,7 @@ static void process_incoming_command(const std::string& command_str) {
                  (unsigned long)message_id, (unsigned int)chunk_data.length());
         
         // Initialize storage for this message if needed
+        purge_stale_chunks();
         auto it = chunk_storage.find(message_id);
         if (it == chunk_storage.end()) {
             auto result = chunk_storage.emplace(message_id, ChunkData(total_chunks, message_id));
@@ -107,6 +206,7 @@ static void process_incoming_command(const std::string& command_str) {
         }
         
         ChunkData& message_data = it->second;
+        message_data.last_update_time = esp_timer_get_time();
         
         // Validate chunk index
         if (chunk_index >= total_chunks) {
@@ -167,6 +267,132 @@ static void process_incoming_command(const std::string& command_str) {
     cJSON_Delete(json);
 }
 
+// Reassemble a binary frame into the connection's preallocated buffer
+static void process_incoming_frame(BleConnection& conn, const uint8_t* data, size_t len) {
+    if (len < BLE_FRAME_HEADER_SIZE) {
+        ESP_LOGW(TAG, "Frame too short (%u bytes)", (unsigned int)len);
+        return;
+    }
+    uint8_t message_id = data[0];
+    uint8_t flags = data[1];
+    uint16_t index = data[2] | (data[3] << 8);
+    data += BLE_FRAME_HEADER_SIZE;
+    len -= BLE_FRAME_HEADER_SIZE;
+
+    int64_t now = esp_timer_get_time();
+    if (conn.total_length != 0 && now - conn.last_fragment_time > BLE_REASSEMBLY_TIMEOUT_MS * 1000LL) {
+        ESP_LOGW(TAG, "Dropping stale message %u (%u/%u bytes)", conn.message_id,
+                 (unsigned int)conn.length, (unsigned int)conn.total_length);
+        conn.total_length = 0;
+    }
+
+    if (flags & BLE_FRAME_FLAG_FIRST) {
+        if (len < BLE_FRAME_LENGTH_SIZE || index != 0) {
+            ESP_LOGW(TAG, "Invalid first fragment of message %u", message_id);
+            return;
+        }
+        if (conn.total_length != 0) {
+            ESP_LOGW(TAG, "Message %u interrupted by message %u", conn.message_id, message_id);
+        }
+        size_t total_length = data[0] | (data[1] << 8);
+        data += BLE_FRAME_LENGTH_SIZE;
+        len -= BLE_FRAME_LENGTH_SIZE;
+        if (total_length == 0 || total_length > BLE_MAX_MESSAGE_SIZE) {
+            ESP_LOGE(TAG, "Invalid message length %u", (unsigned int)total_length);
+            conn.total_length = 0;
+            return;
+        }
+        conn.message_id = message_id;
+        conn.total_length = total_length;
+        conn.length = 0;
+        conn.next_index = 0;
+    } else if (conn.total_length == 0 || message_id != conn.message_id || index != conn.next_index) {
+        // Fragments arrive in order on a connection, a gap means the message is lost
+        ESP_LOGW(TAG, "Unexpected fragment %u of message %u", index, message_id);
+        conn.total_length = 0;
+        return;
+    }
+
+    if (conn.length + len > conn.total_length) {
+        ESP_LOGE(TAG, "Message %u longer than announced %u bytes", message_id, (unsigned int)conn.total_length);
+        conn.total_length = 0;
+        return;
+    }
+    memcpy(conn.buffer + conn.length, data, len);
+    conn.length += len;
+    conn.next_index++;
+    conn.last_fragment_time = now;
+
+    if (flags & BLE_FRAME_FLAG_LAST) {
+        size_t total_length = conn.total_length;
+        conn.total_length = 0;
+        if (conn.length != total_length) {
+            ESP_LOGW(TAG, "Message %u truncated: %u/%u bytes", message_id, (unsigned int)conn.length,
+                     (unsigned int)total_length);
+            return;
+        }
+        std::string message((const char*)conn.buffer, conn.length);
+        ESP_LOGD(TAG, "Message %u reassembled: %u fragments -> %u bytes", message_id, conn.next_index,
+                 (unsigned int)conn.length);
+        process_incoming_command(message);
+    }
+}
+
+static bool send_notification(uint16_t conn_handle, uint16_t attr_handle, const void* data, size_t len,
+                              int max_retries = BLE_NOTIFY_MAX_RETRIES);
+
+// Notify the relay that it may send more downlink frames
+static bool send_audio_credits(uint16_t conn_handle, int credits) {
+    uint8_t packet[sizeof(BinaryProtocol3)] = {BLE_AUDIO_TYPE_CREDIT, (uint8_t)credits, 0, 0};
+    // Never sleeps waiting for mbufs, the host task and the decoder must not stall on it
+    return send_notification(conn_handle, audio_chr_val_handle, packet, sizeof(packet), 0);
+}
+
+// Handle a BinaryProtocol3 packet written by the relay
+static void process_incoming_audio(uint16_t conn_handle, const uint8_t* data, size_t len) {
+    if (len < sizeof(BinaryProtocol3)) {
+        ESP_LOGW(TAG, "Audio packet too short (%u bytes)", (unsigned int)len);
+        return;
+    }
+    uint8_t type = data[0];
+    uint8_t reserved = data[1];
+    size_t payload_size = (data[2] << 8) | data[3];
+    if (payload_size > len - sizeof(BinaryProtocol3)) {
+        ESP_LOGW(TAG, "Audio packet truncated: %u/%u bytes", (unsigned int)(len - sizeof(BinaryProtocol3)),
+                 (unsigned int)payload_size);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        if (conn_handle != relay_conn_handle) {
+            ESP_LOGW(TAG, "Audio packet from conn_handle=%d which is not the relay", conn_handle);
+            return;
+        }
+        if (type == BLE_AUDIO_TYPE_CREDIT) {
+            uplink_credits = std::min(uplink_credits + reserved, BLE_AUDIO_MAX_CREDITS);
+            audio_statistics.max_uplink_credits = std::max<uint32_t>(audio_statistics.max_uplink_credits, uplink_credits);
+            audio_credit_cv.notify_all();
+            return;
+        }
+        if (type == BLE_AUDIO_TYPE_OPUS && downlink_outstanding > 0) {
+            downlink_outstanding--;
+        }
+    }
+
+    if (g_ble_protocol_instance == nullptr) {
+        return;
+    }
+    if (type == BLE_AUDIO_TYPE_OPUS) {
+        // The credit comes back once the decoder takes the frame, see GrantRelayCredits()
+        g_ble_protocol_instance->ProcessRelayAudio(data + sizeof(BinaryProtocol3), payload_size);
+    } else if (type == BLE_AUDIO_TYPE_END) {
+        g_ble_protocol_instance->ProcessRelayAudioEnd();
+    } else {
+        ESP_LOGW(TAG, "Unknown audio packet type %u", type);
+    }
+}
+
 // Forward declarations
 static int gatt_svr_chr_access_xiaozhi(uint16_t conn_handle, uint16_t attr_handle,
                                       struct ble_gatt_access_ctxt *ctxt, void *arg);
@@ -190,6 +416,18 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
             .access_cb = gatt_svr_chr_access_xiaozhi,
             .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_NOTIFY,
             .val_handle = &chr_val_handle,
+        }, {
+            /*** Characteristic: Binary framed command & response, write without response for bulk transfers */
+            .uuid = &santa_bot_frame_characteristic_uuid.u,
+            .access_cb = gatt_svr_chr_access_xiaozhi,
+            .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_NOTIFY,
+            .val_handle = &frame_chr_val_handle,
+        }, {
+            /*** Characteristic: Opus audio relay with credit based flow control */
+            .uuid = &santa_bot_audio_characteristic_uuid.u,
+            .access_cb = gatt_svr_chr_access_xiaozhi,
+            .flags = BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_NOTIFY,
+            .val_handle = &audio_chr_val_handle,
         }, {
             0, /* No more characteristics in this service */
         } }
@@ -202,7 +440,7 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
 // GATT characteristic access callback
 static int gatt_svr_chr_access_xiaozhi(uint16_t conn_handle, uint16_t attr_handle,
                                       struct ble_gatt_access_ctxt *ctxt, void *arg) {
-    ESP_LOGI(TAG, "GATT access: conn_handle=%d attr_handle=%d op=%d", 
+    ESP_LOGD(TAG, "GATT access: conn_handle=%d attr_handle=%d op=%d", 
              conn_handle, attr_handle, ctxt->op);
     
     switch (ctxt->op) {
@@ -211,11 +449,38 @@ static int gatt_svr_chr_access_xiaozhi(uint16_t conn_handle, uint16_t attr_handl
         return 0;
         
     case BLE_GATT_ACCESS_OP_WRITE_CHR:
-        ESP_LOGI(TAG, "GATT write request, len=%d", ctxt->om->om_len);
-        
-        if (ctxt->om->om_len > 0) {
+        ESP_LOGD(TAG, "GATT write request, len=%d", OS_MBUF_PKTLEN(ctxt->om));
+
+        if (attr_handle == frame_chr_val_handle || attr_handle == audio_chr_val_handle) {
+            // Large MTU writes may span several mbufs, flatten into a stack buffer
+            uint8_t frame[BLE_ATT_MTU_MAX];
+            uint16_t len = 0;
+            if (ble_hs_mbuf_to_flat(ctxt->om, frame, sizeof(frame), &len) != 0) {
+                return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+            }
+            if (attr_handle == audio_chr_val_handle) {
+                process_incoming_audio(conn_handle, frame, len);
+                return 0;
+            }
+            BleConnection* conn = find_connection(conn_handle);
+            if (conn == nullptr) {
+                return BLE_ATT_ERR_UNLIKELY;
+            }
+            conn->framed = true;
+            active_conn_handle = conn_handle;
+            process_incoming_frame(*conn, frame, len);
+            return 0;
+        }
+
+        // Legacy JSON characteristic, responses go back the same way
+        if (BleConnection* conn = find_connection(conn_handle)) {
+            conn->framed = false;
+        }
+        active_conn_handle = conn_handle;
+
+        if (OS_MBUF_PKTLEN(ctxt->om) > 0) {
             // Extract data from mbuf
-            uint16_t len = ctxt->om->om_len;
+            uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
             char* data = (char*)malloc(len + 1);
             if (data) {
                 ble_hs_mbuf_to_flat(ctxt->om, data, len, NULL);
@@ -287,6 +552,10 @@ static void bleprph_advertise(void) {
     struct ble_hs_adv_fields fields;
     int rc;
 
+    if (connection_count.load() >= BLE_MAX_CONNECTIONS) {
+        return;
+    }
+
     memset(&fields, 0, sizeof fields);
 
     fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
@@ -329,12 +598,39 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
         if (event->connect.status == 0) {
             rc = ble_gap_conn_find(event->connect.conn_handle, &desc);
             assert(rc == 0);
-            conn_handle = event->connect.conn_handle;
-            is_connected.store(true);
-            
-            if (connection_callback) {
+            BleConnection* conn = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex);
+                conn = find_connection(BLE_HS_CONN_HANDLE_NONE);
+                if (conn != nullptr) {
+                    conn->handle = event->connect.conn_handle;
+                    conn->mtu = BLE_ATT_MTU_DFLT;
+                    conn->framed = false;
+                    conn->total_length = 0;
+                }
+            }
+            if (conn == nullptr) {
+                ESP_LOGW(TAG, "No free connection slot, disconnecting");
+                ble_gap_terminate(event->connect.conn_handle, BLE_ERR_CONN_LIMIT);
+                return 0;
+            }
+
+            // Ask for a large ATT MTU and longer link layer packets
+            rc = ble_gattc_exchange_mtu(event->connect.conn_handle, NULL, NULL);
+            if (rc != 0) {
+                ESP_LOGW(TAG, "Failed to start MTU exchange; rc=%d", rc);
+            }
+            rc = ble_gap_set_data_len(event->connect.conn_handle, BLE_DATA_LEN_TX_OCTETS, BLE_DATA_LEN_TX_TIME);
+            if (rc != 0) {
+                ESP_LOGW(TAG, "Failed to set data length; rc=%d", rc);
+            }
+
+            if (connection_count.fetch_add(1) == 0 && connection_callback) {
                 connection_callback(true);
             }
+            if (connection_count.load() < BLE_MAX_CONNECTIONS) {
+                bleprph_advertise();  // Keep accepting further clients
+            }
         }
         
         if (event->connect.status != 0) {
@@ -344,14 +640,46 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
 
     case BLE_GAP_EVENT_DISCONNECT:
         ESP_LOGI(TAG, "disconnect; reason=%d", event->disconnect.reason);
-        conn_handle = BLE_HS_CONN_HANDLE_NONE;
-        is_connected.store(false);
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            BleConnection* conn = find_connection(event->disconnect.conn.conn_handle);
+            if (conn == nullptr) {
+                return 0;
+            }
+            conn->handle = BLE_HS_CONN_HANDLE_NONE;
+            conn->total_length = 0;
+            if (active_conn_handle == event->disconnect.conn.conn_handle) {
+                active_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+            }
+        }
+        if (g_ble_protocol_instance) {
+            g_ble_protocol_instance->ProcessRelayState(event->disconnect.conn.conn_handle, false);
+        }
         
-        if (connection_callback) {
+        if (connection_count.fetch_sub(1) == 1 && connection_callback) {
             connection_callback(false);
         }
         
-        bleprph_advertise();
+        if (!ble_gap_adv_active()) {
+            bleprph_advertise();
+        }
+        return 0;
+
+    case BLE_GAP_EVENT_SUBSCRIBE:
+        if (event->subscribe.attr_handle == audio_chr_val_handle && g_ble_protocol_instance) {
+            g_ble_protocol_instance->ProcessRelayState(event->subscribe.conn_handle, event->subscribe.cur_notify);
+        }
+        return 0;
+
+    case BLE_GAP_EVENT_MTU:
+        ESP_LOGI(TAG, "mtu update; conn_handle=%d mtu=%d", event->mtu.conn_handle, event->mtu.value);
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            BleConnection* conn = find_connection(event->mtu.conn_handle);
+            if (conn != nullptr) {
+                conn->mtu = event->mtu.value;
+            }
+        }
         return 0;
 
     case BLE_GAP_EVENT_ADV_COMPLETE:
@@ -401,6 +729,8 @@ static void bleprph_host_task(void *param) {
 // BleProtocol class implementation
 BleProtocol::BleProtocol() : impl_(nullptr) {
     g_ble_protocol_instance = this;
+    server_sample_rate_ = BLE_AUDIO_SAMPLE_RATE;
+    server_frame_duration_ = BLE_AUDIO_FRAME_DURATION_MS;
 }
 
 BleProtocol::~BleProtocol() {
@@ -421,6 +751,25 @@ bool BleProtocol::Start() {
         return false;
     }
 
+    // Reassembly buffers are allocated once, a message never needs heap at runtime
+    for (auto& conn : connections) {
+        if (conn.buffer == nullptr) {
+            conn.buffer = (uint8_t*)heap_caps_malloc(BLE_MAX_MESSAGE_SIZE, MALLOC_CAP_SPIRAM);
+            if (conn.buffer == nullptr) {
+                conn.buffer = (uint8_t*)heap_caps_malloc(BLE_MAX_MESSAGE_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            }
+            if (conn.buffer == nullptr) {
+                ESP_LOGE(TAG, "Failed to allocate reassembly buffer");
+                return false;
+            }
+        }
+    }
+
+    rc = ble_att_set_preferred_mtu(BLE_PREFERRED_MTU);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Failed to set preferred MTU %d", rc);
+    }
+
     // Initialize the NimBLE host configuration (following ESP-IDF example pattern)
     ble_hs_cfg.reset_cb = bleprph_on_reset;
     ble_hs_cfg.sync_cb = bleprph_on_sync;
@@ -464,30 +813,188 @@ void BleProtocol::Stop() {
 }
 
 bool BleProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
-    // BLE is not suitable for high-bandwidth audio streaming
-    // This implementation is a placeholder - in practice, you might want to
-    // compress audio data heavily or use a different approach
-    ESP_LOGW(TAG, "Audio streaming over BLE not implemented (bandwidth limitations)");
-    return false;
-}
+    uint16_t conn_handle;
+    uint16_t mtu = BLE_ATT_MTU_DFLT;
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        conn_handle = relay_conn_handle;
+    }
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        BleConnection* conn = find_connection(conn_handle);
+        if (conn != nullptr) {
+            mtu = conn->mtu;
+        }
+    }
 
-bool BleProtocol::OpenAudioChannel() {
-    ESP_LOGI(TAG, "Opening BLE audio channel (simulated)");
-    audio_channel_opened_.store(true);
-    
-    if (on_audio_channel_opened_) {
-        on_audio_channel_opened_();
+    uint8_t frame[BLE_ATT_MTU_MAX];
+    size_t size = sizeof(BinaryProtocol3) + packet->payload.size();
+    if (size > std::min<size_t>(mtu, sizeof(frame)) - 3) {
+        ESP_LOGW(TAG, "Opus frame of %u bytes does not fit MTU %u, dropped", (unsigned int)packet->payload.size(), mtu);
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        audio_statistics.uplink_dropped++;
+        return true;
+    }
+
+    {
+        // Wait for the relay to grant a credit, so frames never pile up in the host mbuf pool
+        std::unique_lock<std::mutex> lock(audio_mutex);
+        if (uplink_credits == 0) {
+            audio_statistics.credit_stalls++;
+            audio_credit_cv.wait_for(lock, std::chrono::milliseconds(BLE_AUDIO_CREDIT_WAIT_MS), [conn_handle]() {
+                return uplink_credits > 0 || relay_conn_handle != conn_handle;
+            });
+            if (uplink_credits == 0 || relay_conn_handle != conn_handle) {
+                audio_statistics.uplink_dropped++;
+                return false;
+            }
+        }
+        uplink_credits--;
     }
+
+    frame[0] = BLE_AUDIO_TYPE_OPUS;
+    frame[1] = 0;
+    frame[2] = (packet->payload.size() >> 8) & 0xFF;
+    frame[3] = packet->payload.size() & 0xFF;
+    memcpy(frame + sizeof(BinaryProtocol3), packet->payload.data(), packet->payload.size());
+    if (!send_notification(conn_handle, audio_chr_val_handle, frame, size)) {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        audio_statistics.uplink_dropped++;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(audio_mutex);
+    audio_statistics.uplink_packets++;
+    audio_statistics.uplink_bytes += packet->payload.size();
     return true;
 }
 
+// The audio channel follows the relay subscription, the phone decides when to stream
+bool BleProtocol::OpenAudioChannel() {
+    return audio_channel_opened_.load();
+}
+
 void BleProtocol::CloseAudioChannel() {
     ESP_LOGI(TAG, "Closing BLE audio channel");
-    audio_channel_opened_.store(false);
-    
-    if (on_audio_channel_closed_) {
-        on_audio_channel_closed_();
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        relay_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        audio_credit_cv.notify_all();
+    }
+    if (audio_channel_opened_.exchange(false)) {
+        PrintAudioStatistics();
+        if (on_audio_channel_closed_) {
+            on_audio_channel_closed_();
+        }
+    }
+}
+
+void BleProtocol::ProcessRelayState(uint16_t conn_handle, bool subscribed) {
+    if (subscribed) {
+        {
+            std::lock_guard<std::mutex> lock(audio_mutex);
+            if (relay_conn_handle != BLE_HS_CONN_HANDLE_NONE && relay_conn_handle != conn_handle) {
+                ESP_LOGW(TAG, "Audio relay already active on conn_handle=%d", relay_conn_handle);
+                return;
+            }
+            relay_conn_handle = conn_handle;
+            uplink_credits = 0;
+            downlink_outstanding = BLE_AUDIO_DOWNLINK_WINDOW;
+            audio_statistics = BleAudioStatistics();
+            audio_statistics.open_time_us = esp_timer_get_time();
+        }
+        ESP_LOGI(TAG, "Audio relay subscribed on conn_handle=%d", conn_handle);
+        send_audio_credits(conn_handle, BLE_AUDIO_DOWNLINK_WINDOW);
+        if (!audio_channel_opened_.exchange(true) && on_audio_channel_opened_) {
+            on_audio_channel_opened_();
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        if (relay_conn_handle != conn_handle) {
+            return;
+        }
+    }
+    ESP_LOGI(TAG, "Audio relay unsubscribed on conn_handle=%d", conn_handle);
+    CloseAudioChannel();
+}
+
+void BleProtocol::ProcessRelayAudio(const uint8_t* payload, size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        audio_statistics.downlink_packets++;
+        audio_statistics.downlink_bytes += size;
+    }
+    last_incoming_time_ = std::chrono::steady_clock::now();
+    if (on_incoming_audio_) {
+        on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
+            .sample_rate = server_sample_rate_,
+            .frame_duration = server_frame_duration_,
+            .timestamp = 0,
+            .payload = std::vector<uint8_t>(payload, payload + size)
+        }));
+    }
+}
+
+// Called by the decoder after it took a frame. Credits are only granted for the part of the
+// window not already in flight or still queued, so the relay is paced by playback.
+void BleProtocol::GrantRelayCredits(size_t queued_frames) {
+    uint16_t conn_handle;
+    int credits;
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        if (relay_conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+            return;
+        }
+        credits = BLE_AUDIO_DOWNLINK_WINDOW - downlink_outstanding - (int)queued_frames;
+        // Batched to save notifications, unless the decoder is about to run dry
+        if (credits <= 0 || (credits < BLE_AUDIO_CREDIT_BATCH && queued_frames > 0)) {
+            return;
+        }
+        conn_handle = relay_conn_handle;
+        downlink_outstanding += credits;
+    }
+    if (!send_audio_credits(conn_handle, credits)) {
+        // Granted again on the next decoded frame
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        if (relay_conn_handle == conn_handle) {
+            downlink_outstanding -= credits;
+        }
+    }
+}
+
+// Reported to the application like the server's tts stop message
+void BleProtocol::ProcessRelayAudioEnd() {
+    cJSON* message = cJSON_CreateObject();
+    cJSON_AddStringToObject(message, "type", "tts");
+    cJSON_AddStringToObject(message, "state", "stop");
+    if (on_incoming_json_) {
+        on_incoming_json_(message);
+    }
+    cJSON_Delete(message);
+}
+
+BleAudioStatistics BleProtocol::GetAudioStatistics() const {
+    std::lock_guard<std::mutex> lock(audio_mutex);
+    return audio_statistics;
+}
+
+void BleProtocol::PrintAudioStatistics() const {
+    auto stats = GetAudioStatistics();
+    int64_t elapsed_ms = (esp_timer_get_time() - stats.open_time_us) / 1000;
+    if (elapsed_ms <= 0) {
+        return;
     }
+    ESP_LOGI(TAG, "Audio relay %lld ms: uplink %lu packets %lu bps (dropped=%lu stalls=%lu max_credits=%lu), downlink %lu packets %lu bps",
+             (long long)elapsed_ms, (unsigned long)stats.uplink_packets,
+             (unsigned long)(stats.uplink_bytes * 8000LL / elapsed_ms), (unsigned long)stats.uplink_dropped,
+             (unsigned long)stats.credit_stalls, (unsigned long)stats.max_uplink_credits,
+             (unsigned long)stats.downlink_packets, (unsigned long)(stats.downlink_bytes * 8000LL / elapsed_ms));
 }
 
 bool BleProtocol::IsAudioChannelOpened() const {
@@ -495,7 +1002,7 @@ bool BleProtocol::IsAudioChannelOpened() const {
 }
 
 bool BleProtocol::IsConnected() const {
-    return is_connected.load();
+    return connection_count.load() > 0;
 }
 
 void BleProtocol::OnCommand(CommandCallback callback) {
@@ -552,8 +1059,56 @@ const char* BleProtocol::GetDeviceName() {
 #endif
 }
 
+// Notify one value, waiting while the host has no free mbufs instead of failing the message
+static bool send_notification(uint16_t conn_handle, uint16_t attr_handle, const void* data, size_t len,
+                              int max_retries) {
+    for (int retry = 0; ; ++retry) {
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(data, len);
+        if (om != NULL) {
+            // The mbuf is consumed whether or not the notification is queued
+            int rc = ble_gatts_notify_custom(conn_handle, attr_handle, om);
+            if (rc == 0) {
+                return true;
+            }
+            if (rc != BLE_HS_ENOMEM) {
+                ESP_LOGE(TAG, "Failed to send notification; rc=%d", rc);
+                return false;
+            }
+        }
+        if (retry >= max_retries) {
+            ESP_LOGE(TAG, "Failed to send notification: out of mbufs");
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(BLE_NOTIFY_RETRY_MS));
+    }
+}
+
 bool BleProtocol::SendResponse(const std::string& response) {
-    if (!is_connected.load() || conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+    // Reply to the client that sent the last command, or to any connected client
+    uint16_t conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    uint16_t mtu = BLE_ATT_MTU_DFLT;
+    bool framed = false;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        BleConnection* conn = nullptr;
+        if (active_conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+            conn = find_connection(active_conn_handle);
+        }
+        if (conn == nullptr) {
+            for (auto& c : connections) {
+                if (c.handle != BLE_HS_CONN_HANDLE_NONE) {
+                    conn = &c;
+                    break;
+                }
+            }
+        }
+        if (conn != nullptr) {
+            conn_handle = conn->handle;
+            mtu = conn->mtu;
+            framed = conn->framed;
+        }
+    }
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE) {
         ESP_LOGW(TAG, "Cannot send response: not connected");
         return false;
     }
@@ -565,18 +1120,14 @@ bool BleProtocol::SendResponse(const std::string& response) {
         std::string preview = response.substr(0, preview_len);
         ESP_LOGI(TAG, "Response preview: %s%s", preview.c_str(), response.length() > 200 ? "..." : "");
     }
+
+    if (framed) {
+        return SendFramedResponse(conn_handle, mtu, response);
+    }
     
     // If response is small enough, send as single notification
     if (response.length() <= MAX_CHUNK_SIZE) {
-        struct os_mbuf *om = ble_hs_mbuf_from_flat(response.c_str(), response.length());
-        if (om == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate mbuf for response");
-            return false;
-        }
-
-        int rc = ble_gatts_notify_custom(conn_handle, chr_val_handle, om);
-        if (rc != 0) {
-            ESP_LOGE(TAG, "Failed to send notification; rc=%d", rc);
+        if (!send_notification(conn_handle, chr_val_handle, response.c_str(), response.length())) {
             return false;
         }
         
@@ -585,11 +1136,64 @@ bool BleProtocol::SendResponse(const std::string& response) {
     } else {
         // Send as chunked response
         ESP_LOGI(TAG, "Response too large (%u bytes), sending in chunks", (unsigned int)response.length());
-        return SendChunkedResponse(response);
+        return SendChunkedResponse(conn_handle, response);
     }
 }
 
-bool BleProtocol::SendChunkedResponse(const std::string& response) {
+bool BleProtocol::SendFramedResponse(uint16_t conn_handle, uint16_t mtu, const std::string& response) {
+    if (response.empty() || response.length() > UINT16_MAX) {
+        ESP_LOGE(TAG, "Cannot frame a response of %u bytes", (unsigned int)response.length());
+        return false;
+    }
+
+    uint8_t message_id;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        BleConnection* conn = find_connection(conn_handle);
+        if (conn == nullptr) {
+            return false;
+        }
+        message_id = conn->next_message_id++;
+    }
+
+    // One notification carries ATT MTU - 3 bytes
+    uint8_t frame[BLE_ATT_MTU_MAX];
+    size_t max_frame_size = std::min<size_t>(mtu, sizeof(frame)) - 3;
+    size_t offset = 0;
+    uint16_t index = 0;
+    while (offset < response.length()) {
+        size_t header_size = BLE_FRAME_HEADER_SIZE;
+        uint8_t flags = 0;
+        if (index == 0) {
+            flags |= BLE_FRAME_FLAG_FIRST;
+            frame[BLE_FRAME_HEADER_SIZE] = response.length() & 0xFF;
+            frame[BLE_FRAME_HEADER_SIZE + 1] = (response.length() >> 8) & 0xFF;
+            header_size += BLE_FRAME_LENGTH_SIZE;
+        }
+        size_t payload_size = std::min(max_frame_size - header_size, response.length() - offset);
+        if (offset + payload_size == response.length()) {
+            flags |= BLE_FRAME_FLAG_LAST;
+        }
+        frame[0] = message_id;
+        frame[1] = flags;
+        frame[2] = index & 0xFF;
+        frame[3] = (index >> 8) & 0xFF;
+        memcpy(frame + header_size, response.data() + offset, payload_size);
+
+        if (!send_notification(conn_handle, frame_chr_val_handle, frame, header_size + payload_size)) {
+            ESP_LOGE(TAG, "Failed to send fragment %u of message %u", index, message_id);
+            return false;
+        }
+        offset += payload_size;
+        index++;
+    }
+
+    ESP_LOGI(TAG, "Framed response sent: %u bytes in %u fragments (MTU %u)",
+             (unsigned int)response.length(), index, mtu);
+    return true;
+}
+
+bool BleProtocol::SendChunkedResponse(uint16_t conn_handle, const std::string& response) {
     ESP_LOGI(TAG, "Sending chunked response (%u bytes total)", (unsigned int)response.length());
     
     // Get the current BLE MTU for this connection
@@ -689,22 +1293,12 @@ bool BleProtocol::SendChunkedResponse(const std::string& response) {
         ESP_LOGI(TAG, "Sending chunk %u/%u (%u bytes)", 
                  (unsigned int)(chunk_index + 1), (unsigned int)total_chunks, (unsigned int)chunk_message.length());
         
-        struct os_mbuf *om = ble_hs_mbuf_from_flat(chunk_message.c_str(), chunk_message.length());
-        if (om == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate mbuf for chunk %u", (unsigned int)chunk_index);
-            return false;
-        }
-
-        int rc = ble_gatts_notify_custom(conn_handle, chr_val_handle, om);
-        if (rc != 0) {
-            ESP_LOGE(TAG, "Failed to send chunk %u; rc=%d", (unsigned int)chunk_index, rc);
+        if (!send_notification(conn_handle, chr_val_handle, chunk_message.c_str(), chunk_message.length())) {
+            ESP_LOGE(TAG, "Failed to send chunk %u", (unsigned int)chunk_index);
             return false;
         }
         
         chunk_index++;
-        
-        // Small delay between chunks to prevent overwhelming the BLE stack
-        vTaskDelay(pdMS_TO_TICKS(10));
     }
     
     ESP_LOGI(TAG, "All %u chunks sent successfully", (unsigned int)total_chunks);
@@ -794,11 +1388,35 @@ void BleProtocol::ProcessTextCommand(const std::string& text) {
     ESP_LOGI(TAG, "BLE process text command (disabled): %s", text.c_str());
 }
 
-bool BleProtocol::SendChunkedResponse(const std::string& response) {
+bool BleProtocol::SendChunkedResponse(uint16_t conn_handle, const std::string& response) {
     ESP_LOGI(TAG, "BLE send chunked response (disabled): %u bytes", (unsigned int)response.length());
     return true;
 }
 
+bool BleProtocol::SendFramedResponse(uint16_t conn_handle, uint16_t mtu, const std::string& response) {
+    ESP_LOGI(TAG, "BLE send framed response (disabled): %u bytes", (unsigned int)response.length());
+    return true;
+}
+
+void BleProtocol::ProcessRelayState(uint16_t conn_handle, bool subscribed) {
+}
+
+void BleProtocol::ProcessRelayAudio(const uint8_t* payload, size_t size) {
+}
+
+void BleProtocol::ProcessRelayAudioEnd() {
+}
+
+void BleProtocol::GrantRelayCredits(size_t) {
+}
+
+BleAudioStatistics BleProtocol::GetAudioStatistics() const {
+    return BleAudioStatistics();
+}
+
+void BleProtocol::PrintAudioStatistics() const {
+}
+
 const char* BleProtocol::GetDeviceName() {
     return "Santa-Bot (BLE Disabled)";
 }
@@ -19,6 +19,28 @@
     0x59, 0x1d, 0x47, 0x8c, 0xab, 0x33, 0x8e, 0x99, \
     0xdf, 0x4f, 0x5d, 0xd4, 0xc0, 0xd8, 0x16, 0x81
 
+// Binary framed characteristic UUID: 8116d8c1-d45d-4fdf-998e-33ab8c471d59
+#define SANTA_BOT_FRAME_CHARACTERISTIC_UUID_128 \
+    0x59, 0x1d, 0x47, 0x8c, 0xab, 0x33, 0x8e, 0x99, \
+    0xdf, 0x4f, 0x5d, 0xd4, 0xc1, 0xd8, 0x16, 0x81
+
+// Audio relay characteristic UUID: 8116d8c2-d45d-4fdf-998e-33ab8c471d59
+#define SANTA_BOT_AUDIO_CHARACTERISTIC_UUID_128 \
+    0x59, 0x1d, 0x47, 0x8c, 0xab, 0x33, 0x8e, 0x99, \
+    0xdf, 0x4f, 0x5d, 0xd4, 0xc2, 0xd8, 0x16, 0x81
+
+// Counters of the audio relay since its channel was opened
+struct BleAudioStatistics {
+    uint32_t uplink_packets = 0;
+    uint32_t uplink_bytes = 0;
+    uint32_t uplink_dropped = 0;        // No credit in time, or the frame does not fit the MTU
+    uint32_t credit_stalls = 0;         // Sends that had to wait for a credit
+    uint32_t downlink_packets = 0;
+    uint32_t downlink_bytes = 0;
+    uint32_t max_uplink_credits = 0;    // Deepest uplink window granted by the relay
+    int64_t open_time_us = 0;
+};
+
 class BleProtocol : public Protocol {
 public:
     using CommandCallback = std::function<void(const std::string&)>;
@@ -54,6 +76,14 @@ public:
     // Helper methods for processing commands (called from static callbacks)
     void ProcessJsonCommand(const cJSON* json);
     void ProcessTextCommand(const std::string& text);
+    void ProcessRelayState(uint16_t conn_handle, bool subscribed);
+    void ProcessRelayAudio(const uint8_t* payload, size_t size);
+    void ProcessRelayAudioEnd();
+    // Returns downlink credits to the relay as the decoder drains its queue
+    static void GrantRelayCredits(size_t queued_frames);
+
+    BleAudioStatistics GetAudioStatistics() const;
+    void PrintAudioStatistics() const;
 
 protected:
     bool SendText(const std::string& text) override;
@@ -64,8 +94,10 @@ private:
     CommandCallback command_callback_;
     ConnectionStateCallback connection_callback_;
     
-    // Send large response in chunks
-    bool SendChunkedResponse(const std::string& response);
+    // Send large response in JSON wrapped chunks (legacy characteristic)
+    bool SendChunkedResponse(uint16_t conn_handle, const std::string& response);
+    // Send response as binary frames sized to the negotiated MTU
+    bool SendFramedResponse(uint16_t conn_handle, uint16_t mtu, const std::string& response);
     
     // Constants for chunking
     static const size_t MAX_CHUNK_SIZE = 120; // Conservative size accounting for JSON wrapper + BLE MTU limits
@@ -251,6 +251,10 @@ std::string MqttProtocol::GetHelloMessage() {
     cJSON_AddBoolToObject(features, "aec", true);
 #endif
     cJSON_AddBoolToObject(features, "mcp", true);
+#if CONFIG_USE_UPLINK_VAD_GATE
+    // Silence is not streamed outside realtime mode, gaps between audio frames are expected
+    cJSON_AddBoolToObject(features, "vad_gate", true);
+#endif
     cJSON_AddItemToObject(root, "features", features);
     cJSON* audio_params = cJSON_CreateObject();
     cJSON_AddStringToObject(audio_params, "format", "opus");
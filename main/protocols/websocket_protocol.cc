@@ -25,8 +25,14 @@ bool WebsocketProtocol::Start() {
     return true;
 }
 
+std::shared_ptr<WebSocket> WebsocketProtocol::GetWebSocket() const {
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    return websocket_;
+}
+
 bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
-    if (websocket_ == nullptr || !websocket_->IsConnected()) {
+    auto websocket = GetWebSocket();
+    if (websocket == nullptr || !websocket->IsConnected()) {
         return false;
     }
 
@@ -41,7 +47,8 @@ bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
         bp2->payload_size = htonl(packet->payload.size());
         memcpy(bp2->payload, packet->payload.data(), packet->payload.size());
 
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        std::lock_guard<std::mutex> send_lock(send_mutex_);
+        return websocket->Send(serialized.data(), serialized.size(), true);
     } else if (version_ == 3) {
         std::string serialized;
         serialized.resize(sizeof(BinaryProtocol3) + packet->payload.size());
@@ -51,18 +58,26 @@ bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
         bp3->payload_size = htons(packet->payload.size());
         memcpy(bp3->payload, packet->payload.data(), packet->payload.size());
 
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        std::lock_guard<std::mutex> send_lock(send_mutex_);
+        return websocket->Send(serialized.data(), serialized.size(), true);
     } else {
-        return websocket_->Send(packet->payload.data(), packet->payload.size(), true);
+        std::lock_guard<std::mutex> send_lock(send_mutex_);
+        return websocket->Send(packet->payload.data(), packet->payload.size(), true);
     }
 }
 
 bool WebsocketProtocol::SendText(const std::string& text) {
-    if (websocket_ == nullptr || !websocket_->IsConnected()) {
+    auto websocket = GetWebSocket();
+    if (websocket == nullptr || !websocket->IsConnected()) {
         return false;
     }
 
-    if (!websocket_->Send(text)) {
+    bool sent;
+    {
+        std::lock_guard<std::mutex> send_lock(send_mutex_);
+        sent = websocket->Send(text);
+    }
+    if (!sent) {
         ESP_LOGE(TAG, "Failed to send text: %s", text.c_str());
         SetError(Lang::Strings::SERVER_ERROR);
         return false;
@@ -72,11 +87,19 @@ bool WebsocketProtocol::SendText(const std::string& text) {
 }
 
 bool WebsocketProtocol::IsAudioChannelOpened() const {
-    return websocket_ != nullptr && websocket_->IsConnected() && !error_occurred_ && !IsTimeout();
+    auto websocket = GetWebSocket();
+    return websocket != nullptr && websocket->IsConnected() && !error_occurred_ && !IsTimeout();
 }
 
 void WebsocketProtocol::CloseAudioChannel() {
-    websocket_.reset();
+    std::shared_ptr<WebSocket> websocket;
+    {
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        websocket.swap(websocket_);
+    }
+    // Closed here unless the audio sender task is in the middle of a send,
+    // then its reference closes it as soon as that send returns
+    websocket.reset();
 }
 
 bool WebsocketProtocol::OpenAudioChannel() {
@@ -91,8 +114,16 @@ bool WebsocketProtocol::OpenAudioChannel() {
     error_occurred_ = false;
 
     auto network = Board::GetInstance().GetNetwork();
-    websocket_ = network->CreateWebSocket(1);
-    if (websocket_ == nullptr) {
+    std::shared_ptr<WebSocket> websocket = network->CreateWebSocket(1);
+    {
+        // The previous connection, if any, is closed outside the lock once its last sender lets go
+        std::shared_ptr<WebSocket> previous = websocket;
+        {
+            std::lock_guard<std::mutex> lock(channel_mutex_);
+            websocket_.swap(previous);
+        }
+    }
+    if (websocket == nullptr) {
         ESP_LOGE(TAG, "Failed to create websocket");
         return false;
     }
@@ -102,13 +133,13 @@ bool WebsocketProtocol::OpenAudioChannel() {
         if (token.find(" ") == std::string::npos) {
             token = "Bearer " + token;
         }
-        websocket_->SetHeader("Authorization", token.c_str());
+        websocket->SetHeader("Authorization", token.c_str());
     }
-    websocket_->SetHeader("Protocol-Version", std::to_string(version_).c_str());
-    websocket_->SetHeader("Device-Id", SystemInfo::GetMacAddress().c_str());
-    websocket_->SetHeader("Client-Id", Board::GetInstance().GetUuid().c_str());
+    websocket->SetHeader("Protocol-Version", std::to_string(version_).c_str());
+    websocket->SetHeader("Device-Id", SystemInfo::GetMacAddress().c_str());
+    websocket->SetHeader("Client-Id", Board::GetInstance().GetUuid().c_str());
 
-    websocket_->OnData([this](const char* data, size_t len, bool binary) {
+    websocket->OnData([this](const char* data, size_t len, bool binary) {
         if (binary) {
             if (on_incoming_audio_ != nullptr) {
                 if (version_ == 2) {
@@ -164,7 +195,7 @@ bool WebsocketProtocol::OpenAudioChannel() {
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
-    websocket_->OnDisconnected([this]() {
+    websocket->OnDisconnected([this]() {
         ESP_LOGI(TAG, "Websocket disconnected");
         if (on_audio_channel_closed_ != nullptr) {
             on_audio_channel_closed_();
@@ -172,7 +203,7 @@ bool WebsocketProtocol::OpenAudioChannel() {
     });
 
     ESP_LOGI(TAG, "Connecting to websocket server: %s with version: %d", url.c_str(), version_);
-    if (!websocket_->Connect(url.c_str())) {
+    if (!websocket->Connect(url.c_str())) {
         ESP_LOGE(TAG, "Failed to connect to websocket server");
         SetError(Lang::Strings::SERVER_NOT_CONNECTED);
         return false;
@@ -209,6 +240,10 @@ std::string WebsocketProtocol::GetHelloMessage() {
     cJSON_AddBoolToObject(features, "aec", true);
 #endif
     cJSON_AddBoolToObject(features, "mcp", true);
+#if CONFIG_USE_UPLINK_VAD_GATE
+    // Silence is not streamed outside realtime mode, gaps between audio frames are expected
+    cJSON_AddBoolToObject(features, "vad_gate", true);
+#endif
     cJSON_AddItemToObject(root, "features", features);
     cJSON_AddStringToObject(root, "transport", "websocket");
     cJSON* audio_params = cJSON_CreateObject();
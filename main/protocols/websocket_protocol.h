@@ -8,6 +8,9 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 
+#include <memory>
+#include <mutex>
+
 #define WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT (1 << 0)
 
 class WebsocketProtocol : public Protocol {
@@ -23,12 +26,19 @@ public:
 
 private:
     EventGroupHandle_t event_group_handle_;
-    std::unique_ptr<WebSocket> websocket_;
+    // Audio is sent from the audio sender task, text from the main loop. channel_mutex_ only
+    // guards swapping the pointer, senders keep their own reference while sending so
+    // closing the channel never waits for a slow uplink. send_mutex_ keeps the frames of
+    // the two senders from interleaving and is never taken by close.
+    std::shared_ptr<WebSocket> websocket_;
+    mutable std::mutex channel_mutex_;
+    std::mutex send_mutex_;
     int version_ = 1;
 
     void ParseServerHello(const cJSON* root);
     bool SendText(const std::string& text) override;
     std::string GetHelloMessage();
+    std::shared_ptr<WebSocket> GetWebSocket() const;
 };
 
 #endif
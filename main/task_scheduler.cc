@@ -0,0 +1,129 @@
+#include "task_scheduler.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "TaskScheduler"
+
+#define TASK_SCHEDULER_INITIAL_CAPACITY 16
+
+static const char* const PRIORITY_STRINGS[] = {
+    "state",
+    "ui",
+    "background",
+};
+
+void TaskScheduler::Ring::Grow() {
+    std::vector<Entry> grown(entries.empty() ? TASK_SCHEDULER_INITIAL_CAPACITY : entries.size() * 2);
+    for (size_t i = 0; i < count; ++i) {
+        grown[i] = std::move(at(i));
+    }
+    entries = std::move(grown);
+    head = 0;
+}
+
+TaskScheduler::TaskScheduler() {
+    for (auto& ring : rings_) {
+        ring.Grow();
+    }
+}
+
+bool TaskScheduler::Push(TaskPriority priority, InlineTask&& task, TaskCoalesceKey coalesce_key) {
+    int64_t now = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& ring = rings_[priority];
+    auto& stats = statistics_[priority];
+    stats.scheduled++;
+    if (!task.is_inline()) {
+        stats.heap_allocated++;
+    }
+
+    if (coalesce_key != kTaskCoalesceNone) {
+        for (size_t i = 0; i < ring.count; ++i) {
+            auto& entry = ring.at(i);
+            if (entry.coalesce_key == coalesce_key) {
+                // Keep the original position and enqueue time, only the latest content matters
+                entry.task = std::move(task);
+                stats.coalesced++;
+                return false;
+            }
+        }
+    }
+
+    if (ring.count == ring.entries.size()) {
+        ring.Grow();
+    }
+    auto& entry = ring.at(ring.count);
+    entry.task = std::move(task);
+    entry.enqueue_time_us = now;
+    entry.coalesce_key = coalesce_key;
+    ring.count++;
+    if (ring.count > stats.max_pending) {
+        stats.max_pending = ring.count;
+    }
+    return true;
+}
+
+bool TaskScheduler::Pop(InlineTask& task) {
+    int64_t now = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int priority = 0; priority < kTaskPriorityCount; ++priority) {
+        auto& ring = rings_[priority];
+        if (ring.count == 0) {
+            continue;
+        }
+
+        auto& entry = ring.at(0);
+        task = std::move(entry.task);
+        ring.head = (ring.head + 1) % ring.entries.size();
+        ring.count--;
+
+        auto& stats = statistics_[priority];
+        int64_t wait_us = now - entry.enqueue_time_us;
+        stats.executed++;
+        stats.total_wait_us += wait_us;
+        if (wait_us > stats.max_wait_us) {
+            stats.max_wait_us = wait_us;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool TaskScheduler::IsEmpty() {
+    return PendingCount() == 0;
+}
+
+size_t TaskScheduler::PendingCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (auto& ring : rings_) {
+        count += ring.count;
+    }
+    return count;
+}
+
+TaskSchedulerStatistics TaskScheduler::GetStatistics(TaskPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_[priority];
+}
+
+void TaskScheduler::ResetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& stats : statistics_) {
+        stats = TaskSchedulerStatistics();
+    }
+}
+
+void TaskScheduler::PrintStatistics() {
+    for (int priority = 0; priority < kTaskPriorityCount; ++priority) {
+        auto stats = GetStatistics(static_cast<TaskPriority>(priority));
+        if (stats.scheduled == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "%s: scheduled=%lu executed=%lu coalesced=%lu heap=%lu max_pending=%lu avg_wait=%lldus max_wait=%lldus",
+            PRIORITY_STRINGS[priority], (unsigned long)stats.scheduled, (unsigned long)stats.executed,
+            (unsigned long)stats.coalesced, (unsigned long)stats.heap_allocated, (unsigned long)stats.max_pending,
+            (long long)(stats.executed > 0 ? stats.total_wait_us / stats.executed : 0), (long long)stats.max_wait_us);
+    }
+}
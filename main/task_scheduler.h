@@ -0,0 +1,174 @@
+#ifndef _TASK_SCHEDULER_H_
+#define _TASK_SCHEDULER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Tasks scheduled to the main event loop are grouped into priority classes.
+ * The main loop always runs the most urgent pending task first, so a burst of
+ * UI updates can no longer delay AbortSpeaking or a state transition.
+ */
+enum TaskPriority {
+    kTaskPriorityState = 0,     // Device state transitions, protocol control, AbortSpeaking
+    kTaskPriorityUi,            // Display updates
+    kTaskPriorityBackground,    // MCP side effects, housekeeping
+    kTaskPriorityCount,
+};
+
+/*
+ * Tasks scheduled with the same non-zero coalesce key replace each other while
+ * still pending, so only the latest update in a burst reaches the display.
+ * Only for updates that replace what is shown, chat lines append to the history
+ * and must never be coalesced.
+ */
+enum TaskCoalesceKey : uint8_t {
+    kTaskCoalesceNone = 0,
+    kTaskCoalesceEmotion,
+};
+
+// A move-only void() callable that keeps small closures inline instead of on the heap
+class InlineTask {
+public:
+    static constexpr size_t kInlineSize = 48;
+
+    InlineTask() = default;
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineTask>>>
+    InlineTask(F&& callable) {
+        using T = std::decay_t<F>;
+        if constexpr (sizeof(T) <= kInlineSize && alignof(T) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<T>) {
+            new (storage_) T(std::forward<F>(callable));
+            ops_ = &kInlineOps<T>;
+        } else {
+            *reinterpret_cast<T**>(storage_) = new T(std::forward<F>(callable));
+            ops_ = &kHeapOps<T>;
+        }
+    }
+
+    InlineTask(InlineTask&& other) noexcept {
+        MoveFrom(other);
+    }
+
+    InlineTask& operator=(InlineTask&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    InlineTask(const InlineTask&) = delete;
+    InlineTask& operator=(const InlineTask&) = delete;
+
+    ~InlineTask() {
+        Reset();
+    }
+
+    void operator()() {
+        ops_->invoke(storage_);
+    }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+    bool is_inline() const { return ops_ != nullptr && ops_->is_inline; }
+
+    void Reset() {
+        if (ops_ != nullptr) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* storage);
+        bool is_inline;
+    };
+
+    template<typename T>
+    static constexpr Ops kInlineOps = {
+        [](void* storage) { (*static_cast<T*>(storage))(); },
+        [](void* dst, void* src) {
+            new (dst) T(std::move(*static_cast<T*>(src)));
+            static_cast<T*>(src)->~T();
+        },
+        [](void* storage) { static_cast<T*>(storage)->~T(); },
+        true,
+    };
+
+    template<typename T>
+    static constexpr Ops kHeapOps = {
+        [](void* storage) { (**static_cast<T**>(storage))(); },
+        [](void* dst, void* src) { *static_cast<T**>(dst) = *static_cast<T**>(src); },
+        [](void* storage) { delete *static_cast<T**>(storage); },
+        false,
+    };
+
+    void MoveFrom(InlineTask& other) {
+        ops_ = other.ops_;
+        if (ops_ != nullptr) {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+    const Ops* ops_ = nullptr;
+};
+
+struct TaskSchedulerStatistics {
+    uint32_t scheduled = 0;
+    uint32_t executed = 0;
+    uint32_t coalesced = 0;
+    uint32_t heap_allocated = 0;
+    uint32_t max_pending = 0;
+    int64_t total_wait_us = 0;
+    int64_t max_wait_us = 0;
+};
+
+class TaskScheduler {
+public:
+    TaskScheduler();
+
+    // Returns false if the task was merged into a pending task with the same coalesce key
+    bool Push(TaskPriority priority, InlineTask&& task, TaskCoalesceKey coalesce_key = kTaskCoalesceNone);
+    // Pops the most urgent pending task, returns false if there is nothing to run
+    bool Pop(InlineTask& task);
+    bool IsEmpty();
+    size_t PendingCount();
+
+    TaskSchedulerStatistics GetStatistics(TaskPriority priority);
+    void ResetStatistics();
+    void PrintStatistics();
+
+private:
+    struct Entry {
+        InlineTask task;
+        int64_t enqueue_time_us = 0;
+        TaskCoalesceKey coalesce_key = kTaskCoalesceNone;
+    };
+
+    // Ring buffer that only allocates when it has to grow beyond its high-water mark
+    struct Ring {
+        std::vector<Entry> entries;
+        size_t head = 0;
+        size_t count = 0;
+
+        Entry& at(size_t index) { return entries[(head + index) % entries.size()]; }
+        void Grow();
+    };
+
+    std::mutex mutex_;
+    Ring rings_[kTaskPriorityCount];
+    TaskSchedulerStatistics statistics_[kTaskPriorityCount];
+};
+
+#endif // _TASK_SCHEDULER_H_
@@ -0,0 +1,162 @@
+import argparse
+import glob
+import os
+import struct
+
+
+MERGE_SLACK_PIXELS = 512        # AAF_PLAYER_MERGE_SLACK_PIXELS
+TRANSACTION_OVERHEAD_US = 15    # Window commands and DMA setup of one esp_lcd_panel_draw_bitmap
+
+# Frame rates the HeySanta emotion map plays the assets at
+FPS = {
+    "Blinking": 20, "Whole_elf": 21, "bell": 25, "cookie": 24, "cross": 24, "cross2": 24,
+    "happy": 24, "happy2": 24, "heart": 25, "sleep": 24, "snowman": 25, "star": 25,
+}
+
+
+def load_frames(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    count = struct.unpack_from("<I", data, 0)[0]
+    base = 12 + count * 8
+    frames = []
+    for i in range(count):
+        size, offset = struct.unpack_from("<II", data, 12 + i * 8)
+        frame = data[base + offset:base + offset + size]
+        if frame[:4] != b"ZZ_S" or frame[11] != 8:
+            raise ValueError(f"{path}: frame {i} is not an 8 bit split image")
+        width, height, splits, split_height = struct.unpack_from("<HHHH", frame, 12)
+        lengths = struct.unpack_from(f"<{splits}H", frame, 20)
+        palette_offset = 20 + splits * 2
+        palette = frame[palette_offset:palette_offset + 1024]
+        blocks = []
+        offset = palette_offset + 1024
+        for length in lengths:
+            blocks.append(frame[offset:offset + length])
+            offset += length
+        frames.append((width, height, split_height, palette, blocks))
+    return frames
+
+
+def decode_block(block):
+    if block[0] != 0:
+        raise ValueError(f"unsupported block encoding {block[0]}")
+    indices = bytearray()
+    for i in range(1, len(block) - 1, 2):
+        indices += bytes([block[i + 1]]) * block[i]
+    return indices
+
+
+def palette_colors(palette):
+    return [((palette[i + 2] & 0xF8) << 8) | ((palette[i + 1] & 0xFC) << 3) | (palette[i] >> 3)
+            for i in range(0, 1024, 4)]
+
+
+'''
+  Replays an animation the way AafPlayer renders it at the nominal frame rate:
+  bands whose compressed data did not change are skipped, changed bands are
+  compared with the screen, and the dirty bands merge into rectangles while
+  that wastes fewer than MERGE_SLACK_PIXELS. Returns the flushed rectangles per frame.
+'''
+def replay(frames, loops):
+    width, height = frames[0][0], frames[0][1]
+    screen = None
+    shown_blocks = None
+    shown_palette = None
+    result = []
+    for frame_index in range(len(frames) * loops):
+        _, _, split_height, palette, blocks = frames[frame_index % len(frames)]
+        colors = palette_colors(palette)
+        can_skip = screen is not None and palette == shown_palette
+        if screen is None:
+            screen = [[None] * width for _ in range(height)]
+        rects = []
+        pending = None
+        for i, block in enumerate(blocks):
+            y = i * split_height
+            rows = min(split_height, height - y)
+            if rows <= 0:
+                break
+            if can_skip and shown_blocks[i] == block:
+                continue
+            indices = decode_block(block)
+            x_start, x_end = width, -1
+            for row in range(rows):
+                line = screen[y + row]
+                source = indices[row * width:(row + 1) * width]
+                for x in range(width):
+                    color = colors[source[x]]
+                    if line[x] != color:
+                        line[x] = color
+                        x_start = min(x_start, x)
+                        x_end = max(x_end, x)
+            if x_end < x_start:
+                continue
+            rect = [x_start, y, x_end, y + rows - 1]
+            if pending and pending[3] + 1 == rect[1]:
+                merged = [min(pending[0], rect[0]), pending[1], max(pending[2], rect[2]), rect[3]]
+                area = lambda r: (r[2] - r[0] + 1) * (r[3] - r[1] + 1)
+                if area(merged) - area(pending) - area(rect) <= MERGE_SLACK_PIXELS:
+                    pending = merged
+                    continue
+            if pending:
+                rects.append(pending)
+            pending = rect
+        if pending:
+            rects.append(pending)
+        shown_blocks = blocks
+        shown_palette = palette
+        result.append(rects)
+    return result
+
+
+def transfers(rect, max_transfer_pixels):
+    width = rect[2] - rect[0] + 1
+    rows = rect[3] - rect[1] + 1
+    per_transfer = max(1, max_transfer_pixels // width)
+    return (rows + per_transfer - 1) // per_transfer
+
+
+'''
+  Decodes the .aaf assets and reports the LCD traffic of full frame flushes
+  against AafPlayer's dirty rectangles, and the frame rate the SPI bus can sustain.
+'''
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark dirty rectangle flushing of .aaf animations")
+    parser.add_argument("files", nargs="*", help=".aaf files, defaults to the repository emoji directory")
+    parser.add_argument("--pclk", type=float, default=80, help="SPI clock in MHz")
+    parser.add_argument("--transfer-rows", type=int, default=16, help="rows per transfer buffer at full width")
+    parser.add_argument("--loops", type=int, default=2, help="times each animation is played")
+    args = parser.parse_args()
+
+    files = args.files or sorted(glob.glob(os.path.join(os.path.dirname(__file__), "..", "emoji", "*.aaf")))
+    bytes_per_us = args.pclk / 8
+    print(f"{'file':<12}{'fps':>5}{'full B/s':>12}{'dirty B/s':>12}{'ratio':>8}{'flush/s':>9}{'max fps':>9}")
+    total_full = total_dirty = 0
+    for path in files:
+        name = os.path.splitext(os.path.basename(path))[0]
+        fps = FPS.get(name, 25)
+        frames = load_frames(path)
+        width, height = frames[0][0], frames[0][1]
+        rects = replay(frames, args.loops)
+
+        # The first frame is a full redraw either way, measure the steady state
+        steady = rects[1:]
+        dirty_bytes = sum((r[2] - r[0] + 1) * (r[3] - r[1] + 1) * 2 for frame in steady for r in frame)
+        flushes = sum(transfers(r, width * args.transfer_rows) for frame in steady for r in frame)
+        worst_us = max(sum((r[2] - r[0] + 1) * (r[3] - r[1] + 1) * 2 / bytes_per_us +
+                           transfers(r, width * args.transfer_rows) * TRANSACTION_OVERHEAD_US for r in frame)
+                       for frame in steady)
+        full = width * height * 2 * fps
+        dirty = dirty_bytes * fps / len(steady)
+        total_full += full
+        total_dirty += dirty
+        max_fps = 1e6 / worst_us if worst_us > 0 else float("inf")
+        print(f"{name:<12}{fps:>5}{full:>12.0f}{dirty:>12.0f}{100 * dirty / full:>7.1f}%"
+              f"{flushes * fps / len(steady):>9.0f}{max_fps:>9.1f}")
+    print(f"total: full {total_full / 1e6:.1f} MB/s, dirty {total_dirty / 1e6:.1f} MB/s, "
+          f"SPI at {args.pclk:.0f} MHz carries {bytes_per_us:.1f} MB/s")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,140 @@
+import argparse
+import asyncio
+import struct
+import time
+
+from bleak import BleakClient, BleakScanner
+
+
+AUDIO_CHARACTERISTIC_UUID = "8116d8c2-d45d-4fdf-998e-33ab8c471d59"
+
+TYPE_OPUS = 0
+TYPE_CREDIT = 1
+TYPE_END = 2
+
+FRAME_DURATION_MS = 60
+
+
+'''
+  Stand-in for the phone side of the BLE audio relay.
+  Records the uplink Opus frames to a P3 file and optionally streams a P3 file
+  as downlink audio, honouring the credits granted by the device.
+  Prints goodput and credit queue depth once per second.
+'''
+class Relay:
+    def __init__(self, client, window):
+        self.client = client
+        self.window = window
+        self.downlink_credits = 0
+        self.credit_event = asyncio.Event()
+        self.uplink_frames = []
+        self.uplink_bytes = 0
+        self.downlink_bytes = 0
+        self.max_downlink_wait = 0
+        self.pending_uplink = 0
+
+    async def write(self, packet_type, reserved, payload=b""):
+        packet = struct.pack('>BBH', packet_type, reserved, len(payload)) + payload
+        await self.client.write_gatt_char(AUDIO_CHARACTERISTIC_UUID, packet, response=False)
+
+    def on_notify(self, _, data):
+        packet_type, reserved, size = struct.unpack('>BBH', data[:4])
+        if packet_type == TYPE_CREDIT:
+            self.downlink_credits += reserved
+            self.credit_event.set()
+        elif packet_type == TYPE_OPUS:
+            self.uplink_frames.append(bytes(data[4:4 + size]))
+            self.uplink_bytes += size
+            self.pending_uplink += 1
+
+    async def grant_uplink_credits(self):
+        # A real relay returns credits as its upstream socket drains, here frames are consumed immediately
+        await self.write(TYPE_CREDIT, self.window)
+        while True:
+            await asyncio.sleep(FRAME_DURATION_MS / 1000)
+            if self.pending_uplink > 0:
+                credits, self.pending_uplink = min(self.pending_uplink, 255), 0
+                await self.write(TYPE_CREDIT, credits)
+
+    async def stream_downlink(self, filename):
+        with open(filename, 'rb') as f:
+            data = f.read()
+        offset = 0
+        start = time.monotonic()
+        frames = 0
+        while offset + 4 <= len(data):
+            _, _, size = struct.unpack('>BBH', data[offset:offset + 4])
+            payload = data[offset + 4:offset + 4 + size]
+            offset += 4 + size
+            while self.downlink_credits == 0:
+                wait_start = time.monotonic()
+                self.credit_event.clear()
+                await self.credit_event.wait()
+                self.max_downlink_wait = max(self.max_downlink_wait, time.monotonic() - wait_start)
+            self.downlink_credits -= 1
+            await self.write(TYPE_OPUS, 0, payload)
+            self.downlink_bytes += size
+            frames += 1
+            # Pace at real time, the credit window absorbs jitter
+            delay = start + frames * FRAME_DURATION_MS / 1000 - time.monotonic()
+            if delay > 0:
+                await asyncio.sleep(delay)
+        await self.write(TYPE_END, 0)
+        print(f"Downlink finished: {frames} frames")
+
+    async def report(self):
+        start = time.monotonic()
+        while True:
+            await asyncio.sleep(1)
+            elapsed = time.monotonic() - start
+            print(f"{elapsed:6.1f}s uplink {self.uplink_bytes * 8 / elapsed:7.0f} bps ({len(self.uplink_frames)} frames), "
+                  f"downlink {self.downlink_bytes * 8 / elapsed:7.0f} bps, device credits {self.downlink_credits}, "
+                  f"max credit wait {self.max_downlink_wait * 1000:.0f} ms")
+
+    def save(self, filename):
+        with open(filename, 'wb') as f:
+            for frame in self.uplink_frames:
+                f.write(struct.pack('>BBH', 0, 0, len(frame)) + frame)
+        print(f"Saved {len(self.uplink_frames)} uplink frames to {filename}")
+
+
+async def main(name, play, record, window, duration):
+    device = await BleakScanner.find_device_by_name(name)
+    if device is None:
+        print(f"Device {name} not found")
+        return
+
+    async with BleakClient(device) as client:
+        relay = Relay(client, window)
+        await client.start_notify(AUDIO_CHARACTERISTIC_UUID, relay.on_notify)
+        print(f"Relay connected to {device.address}, MTU {client.mtu_size}")
+
+        tasks = [asyncio.create_task(relay.grant_uplink_credits()), asyncio.create_task(relay.report())]
+        try:
+            if play:
+                await relay.stream_downlink(play)
+            await asyncio.sleep(duration)
+        except KeyboardInterrupt:
+            pass
+        finally:
+            for task in tasks:
+                task.cancel()
+            await client.stop_notify(AUDIO_CHARACTERISTIC_UUID)
+            relay.save(record)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='BLE audio relay stand-in, records uplink and plays downlink P3 audio')
+    parser.add_argument('--name', '-n', default='Santa-Bot',
+                        help='BLE device name (default: Santa-Bot)')
+    parser.add_argument('--play', '-p',
+                        help='P3 file streamed to the device as downlink audio')
+    parser.add_argument('--record', '-r', default='uplink.p3',
+                        help='P3 file for the uplink audio (default: uplink.p3)')
+    parser.add_argument('--window', '-w', type=int, default=8,
+                        help='Uplink credits granted up front (default: 8)')
+    parser.add_argument('--duration', '-d', type=float, default=10,
+                        help='Seconds to keep relaying after the downlink (default: 10)')
+
+    args = parser.parse_args()
+    asyncio.run(main(args.name, args.play, args.record, args.window, args.duration))
@@ -0,0 +1,203 @@
+import argparse
+import binascii
+import os
+import struct
+import sys
+import time
+
+
+MAGIC = b"XZAB"
+VERSION = 1
+HEADER_SIZE = 32
+ENTRY_SIZE = 16
+ALIGNMENT = 16      # Blob alignment, keeps 32 bit reads aligned in the mapped partition
+
+
+'''
+  Asset bundle layout, all fields little endian (see main/asset_bundle.h):
+    header:  "XZAB", version (u16), header size (u16), entry count (u32), bucket count (u32),
+             total size (u32), CRC32 of everything after the header (u32), 8 reserved bytes
+    buckets: bucket count u16 entry numbers, 0 marks an empty bucket, linear probing
+    entries: name hash (u32), name offset (u32), data offset (u32), data size (u32)
+    names:   NUL terminated UTF-8
+    blobs:   aligned to 16 bytes
+'''
+def name_hash(name):
+    # FNV-1a, 32 bit
+    h = 0x811C9DC5
+    for byte in name.encode("utf-8"):
+        h = ((h ^ byte) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def align(value):
+    return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1)
+
+
+def collect(paths):
+    files = {}
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, names in os.walk(path):
+                for name in sorted(names):
+                    full = os.path.join(root, name)
+                    files[os.path.relpath(full, path).replace(os.sep, "/")] = full
+        else:
+            files[os.path.basename(path)] = path
+    return files
+
+
+def build(files):
+    names = sorted(files)
+    if len(names) >= 0xFFFF:
+        raise ValueError("too many assets")
+    bucket_count = 1
+    while bucket_count < len(names) * 2:
+        bucket_count *= 2
+
+    buckets = [0] * bucket_count
+    for number, name in enumerate(names, 1):
+        index = name_hash(name) & (bucket_count - 1)
+        while buckets[index]:
+            index = (index + 1) & (bucket_count - 1)
+        buckets[index] = number
+
+    entries_offset = HEADER_SIZE + bucket_count * 2
+    names_offset = entries_offset + len(names) * ENTRY_SIZE
+    name_table = bytearray()
+    name_offsets = []
+    for name in names:
+        name_offsets.append(names_offset + len(name_table))
+        name_table += name.encode("utf-8") + b"\0"
+
+    blobs = bytearray()
+    blob_base = align(names_offset + len(name_table))
+    entries = bytearray()
+    for name, name_offset in zip(names, name_offsets):
+        with open(files[name], "rb") as f:
+            data = f.read()
+        blobs += b"\0" * (align(len(blobs)) - len(blobs))
+        entries += struct.pack("<IIII", name_hash(name), name_offset, blob_base + len(blobs), len(data))
+        blobs += data
+
+    body = struct.pack(f"<{bucket_count}H", *buckets) + entries + name_table
+    body += b"\0" * (blob_base - HEADER_SIZE - len(body)) + blobs
+    total_size = HEADER_SIZE + len(body)
+    header = MAGIC + struct.pack("<HHIIII8x", VERSION, HEADER_SIZE, len(names), bucket_count, total_size,
+                                 binascii.crc32(body))
+    return header + body
+
+
+class Bundle:
+    def __init__(self, data):
+        if data[:4] != MAGIC:
+            raise ValueError("not an asset bundle")
+        (self.version, header_size, self.count, self.bucket_count, self.total_size,
+         self.crc) = struct.unpack_from("<HHIIII", data, 4)
+        if self.version != VERSION or header_size != HEADER_SIZE:
+            raise ValueError(f"unsupported bundle version {self.version}")
+        if self.total_size > len(data):
+            raise ValueError(f"bundle is truncated, {len(data)} of {self.total_size} bytes")
+        self.data = data[:self.total_size]
+        self.buckets = struct.unpack_from(f"<{self.bucket_count}H", self.data, HEADER_SIZE)
+        self.entries_offset = HEADER_SIZE + self.bucket_count * 2
+
+    def entry(self, number):
+        return struct.unpack_from("<IIII", self.data, self.entries_offset + (number - 1) * ENTRY_SIZE)
+
+    def name(self, offset):
+        return self.data[offset:self.data.index(b"\0", offset)].decode("utf-8")
+
+    def find(self, name):
+        # Same probe sequence as AssetBundle::Get()
+        h = name_hash(name)
+        index = h & (self.bucket_count - 1)
+        probes = 1
+        while self.buckets[index]:
+            entry_hash, name_offset, offset, size = self.entry(self.buckets[index])
+            if entry_hash == h and self.name(name_offset) == name:
+                return self.data[offset:offset + size], probes
+            index = (index + 1) & (self.bucket_count - 1)
+            probes += 1
+        return None, probes
+
+    def names(self):
+        return [self.name(self.entry(number)[1]) for number in range(1, self.count + 1)]
+
+
+def verify(bundle, files):
+    errors = []
+    if binascii.crc32(bundle.data[HEADER_SIZE:]) != bundle.crc:
+        errors.append("CRC mismatch")
+    for number in range(1, bundle.count + 1):
+        _, _, offset, size = bundle.entry(number)
+        if offset % ALIGNMENT or offset + size > bundle.total_size:
+            errors.append(f"entry {number} is misplaced")
+    for name in bundle.names():
+        data, _ = bundle.find(name)
+        if data is None:
+            errors.append(f"{name} is not reachable through the hash table")
+        elif name in files:
+            with open(files[name], "rb") as f:
+                if f.read() != data:
+                    errors.append(f"{name} differs from {files[name]}")
+    for name in files:
+        if bundle.find(name)[0] is None:
+            errors.append(f"{name} is missing")
+    return errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build and check asset bundles for the assets partition")
+    subparsers = parser.add_subparsers(dest="command", required=True)
+    build_parser = subparsers.add_parser("build", help="pack files and directories into a bundle")
+    build_parser.add_argument("inputs", nargs="+", help="files are named by their base name, directories by relative path")
+    build_parser.add_argument("-o", "--output", required=True)
+    build_parser.add_argument("--partition-size", type=lambda s: int(s, 0), help="fail if the bundle does not fit")
+    verify_parser = subparsers.add_parser("verify", help="check the CRC, alignment and every lookup")
+    verify_parser.add_argument("bundle")
+    verify_parser.add_argument("inputs", nargs="*", help="compare entries with these files")
+    bench_parser = subparsers.add_parser("bench", help="list entries and measure lookups")
+    bench_parser.add_argument("bundle")
+    args = parser.parse_args()
+
+    if args.command == "build":
+        data = build(collect(args.inputs))
+        if args.partition_size is not None and len(data) > args.partition_size:
+            sys.exit(f"bundle is {len(data)} bytes, the partition holds {args.partition_size}")
+        with open(args.output, "wb") as f:
+            f.write(data)
+        print(f"{args.output}: {len(collect(args.inputs))} assets, {len(data)} bytes")
+        return
+
+    with open(args.bundle, "rb") as f:
+        bundle = Bundle(f.read())
+
+    if args.command == "verify":
+        errors = verify(bundle, collect(args.inputs))
+        for error in errors:
+            print(error)
+        print(f"{args.bundle}: {bundle.count} assets, {bundle.total_size} bytes, "
+              f"{'OK' if not errors else f'{len(errors)} errors'}")
+        sys.exit(1 if errors else 0)
+
+    names = bundle.names()
+    probes = [bundle.find(name)[1] for name in names]
+    for name in names:
+        data, probe = bundle.find(name)
+        print(f"{len(data):>10}  {probe}  {name}")
+    rounds = 1000
+    start = time.perf_counter()
+    for _ in range(rounds):
+        for name in names:
+            bundle.find(name)
+    elapsed = time.perf_counter() - start
+    payload = sum(len(bundle.find(name)[0]) for name in names)
+    print(f"{bundle.count} assets in {bundle.bucket_count} buckets, {payload} bytes of data, "
+          f"{bundle.total_size - payload} bytes of index and padding")
+    print(f"probes per lookup: average {sum(probes) / len(probes):.2f}, worst {max(probes)}; "
+          f"{elapsed / (rounds * len(names)) * 1e6:.2f} us per lookup in Python")
+
+
+if __name__ == "__main__":
+    main()
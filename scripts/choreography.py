@@ -0,0 +1,141 @@
+import argparse
+import base64
+import json
+import struct
+import sys
+
+
+MAGIC = b"CHR1"
+MAX_CHANNELS = 7
+FLAG_LOOP = 0x01
+MASK_STEP = 0x80
+TICK_MS = 20
+
+
+'''
+  Compiles a JSON choreography into the CHR1 stream played by the robots'
+  dance tools (main/boards/common/choreography.h).
+
+  {
+    "channels": 6,
+    "loop": false,
+    "keyframes": [
+      {"t": 0,    "pose": [90, 90, 90, 90, 90, 90]},
+      {"t": 400,  "pose": [120, null, 60, null, null, null]},
+      {"t": 800,  "pose": [90, null, 90, null, null, null], "step": true}
+    ]
+  }
+
+  "t" is absolute in ms, counted from the start of speech when the tool syncs
+  to it. null keeps a channel's previous value. Channels ramp linearly to each
+  keyframe unless "step" makes them jump when it is reached.
+'''
+def compile_choreography(spec):
+    channels = spec["channels"]
+    if not 1 <= channels <= MAX_CHANNELS:
+        raise ValueError(f"channels must be 1..{MAX_CHANNELS}")
+
+    body = bytearray()
+    previous_time = 0
+    current = [None] * channels
+    keyframes = spec["keyframes"]
+    for index, keyframe in enumerate(keyframes):
+        time = keyframe["t"]
+        delta = time - previous_time
+        if delta < 0 or delta > 0xFFFF:
+            raise ValueError(f"keyframe {index}: time step {delta} ms out of range 0..65535")
+        pose = keyframe["pose"]
+        if len(pose) != channels:
+            raise ValueError(f"keyframe {index}: pose needs {channels} values")
+
+        mask = MASK_STEP if keyframe.get("step") else 0
+        values = bytearray()
+        for channel, value in enumerate(pose):
+            # Channels that did not change are left out of the stream
+            if value is None or value == current[channel]:
+                continue
+            if not 0 <= value <= 255:
+                raise ValueError(f"keyframe {index}: value {value} out of range 0..255")
+            mask |= 1 << channel
+            values.append(value)
+            current[channel] = value
+        body += struct.pack('<HB', delta, mask) + values
+        previous_time = time
+
+    flags = FLAG_LOOP if spec.get("loop") else 0
+    return MAGIC + struct.pack('<BBH', channels, flags, len(keyframes)) + bytes(body)
+
+
+def decode(data):
+    if data[:4] != MAGIC:
+        raise ValueError("not a CHR1 stream")
+    channels, flags, count = struct.unpack_from('<BBH', data, 4)
+    offset = 8
+    keyframes = []
+    for _ in range(count):
+        delta, mask = struct.unpack_from('<HB', data, offset)
+        offset += 3
+        values = {}
+        for channel in range(channels):
+            if mask & (1 << channel):
+                values[channel] = data[offset]
+                offset += 1
+        keyframes.append((delta, bool(mask & MASK_STEP), values))
+    return channels, bool(flags & FLAG_LOOP), keyframes
+
+
+'''
+  Samples the stream every servo tick the same way Choreography::Evaluate()
+  does, starting from the given pose. Loops are played once.
+'''
+def simulate(data, start_pose):
+    channels, _, keyframes = decode(data)
+    samples = []
+    previous = list(start_pose[:channels])
+    previous_time = 0
+    time = 0
+    for delta, step, values in keyframes:
+        following = list(previous)
+        for channel, value in values.items():
+            following[channel] = value
+        next_time = previous_time + delta
+        while time < next_time:
+            if step:
+                samples.append((time, list(previous)))
+            else:
+                fraction = time - previous_time
+                samples.append((time, [p + int((n - p) * fraction / delta) for p, n in zip(previous, following)]))
+            time += TICK_MS
+        previous = following
+        previous_time = next_time
+    samples.append((time, previous))
+    return samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile a JSON choreography to CHR1")
+    parser.add_argument("input", help="JSON choreography")
+    parser.add_argument("-o", "--output", help="write the binary stream to this file")
+    parser.add_argument("--simulate", action="store_true", help="print the sampled servo angles as CSV")
+    parser.add_argument("--start", type=int, default=90, help="start pose used by --simulate")
+    args = parser.parse_args()
+
+    with open(args.input) as f:
+        spec = json.load(f)
+    data = compile_choreography(spec)
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(data)
+
+    if args.simulate:
+        for time, pose in simulate(data, [args.start] * spec["channels"]):
+            print(",".join(str(v) for v in [time] + pose))
+        return
+
+    duration = sum(delta for delta, _, _ in decode(data)[2])
+    print(f"{len(spec['keyframes'])} keyframes, {duration} ms, {len(data)} bytes", file=sys.stderr)
+    print(base64.b64encode(data).decode())
+
+
+if __name__ == "__main__":
+    main()
@@ -7,7 +7,7 @@ HEADER_TEMPLATE = """// Auto-generated language config
 #pragma once
 
 #include <string_view>
-
+{includes}
 #ifndef {lang_code_for_font}
     #define {lang_code_for_font}  // Default language
 #endif
@@ -28,7 +28,7 @@ namespace Lang {{
 }}
 """
 
-def generate_header(input_path, output_path):
+def generate_header(input_path, output_path, bundle=False):
     with open(input_path, 'r', encoding='utf-8') as f:
         data = json.load(f)
 
@@ -45,22 +45,16 @@ def generate_header(input_path, output_path):
         value = value.replace('"', '\\"')
         strings.append(f'        constexpr const char* {key.upper()} = "{value}";')
 
-    # Generate sound effect constants
-    for file in os.listdir(os.path.dirname(input_path)):
-        if file.endswith('.p3'):
-            base_name = os.path.splitext(file)[0]
+    # Generate sound effect constants, language sounds first, then common sound effects
+    sound_files = [file for file in os.listdir(os.path.dirname(input_path)) if file.endswith('.p3')]
+    sound_files += [file for file in os.listdir(os.path.join(os.path.dirname(output_path), 'common')) if file.endswith('.p3')]
+    for file in sound_files:
+        base_name = os.path.splitext(file)[0]
+        if bundle:
+            # Looked up by file name in the assets partition, see scripts/build_assets.py
             sounds.append(f'''
-        extern const char p3_{base_name}_start[] asm("_binary_{base_name}_p3_start");
-        extern const char p3_{base_name}_end[] asm("_binary_{base_name}_p3_end");
-        static const std::string_view P3_{base_name.upper()} {{
-        static_cast<const char*>(p3_{base_name}_start),
-        static_cast<size_t>(p3_{base_name}_end - p3_{base_name}_start)
-        }};''')
-    
-    # Generate common sound effects
-    for file in os.listdir(os.path.join(os.path.dirname(output_path), 'common')):
-        if file.endswith('.p3'):
-            base_name = os.path.splitext(file)[0]
+        static const AssetRef P3_{base_name.upper()} {{"{file}"}};''')
+        else:
             sounds.append(f'''
         extern const char p3_{base_name}_start[] asm("_binary_{base_name}_p3_start");
         extern const char p3_{base_name}_end[] asm("_binary_{base_name}_p3_end");
@@ -71,6 +65,7 @@ def generate_header(input_path, output_path):
 
     # Fill template
     content = HEADER_TEMPLATE.format(
+        includes='#include "asset_bundle.h"\n' if bundle else '',
         lang_code=lang_code,
         lang_code_for_font=lang_code.replace('-', '_').lower(),
         strings="\n".join(sorted(strings)),
@@ -86,6 +81,7 @@ if __name__ == "__main__":
     parser = argparse.ArgumentParser()
     parser.add_argument("--input", required=True, help="Input JSON file path")
     parser.add_argument("--output", required=True, help="Output header file path")
+    parser.add_argument("--bundle", action="store_true", help="Reference sounds in the asset bundle instead of embedded files")
     args = parser.parse_args()
 
-    generate_header(args.input, args.output)
\ No newline at end of file
+    generate_header(args.input, args.output, args.bundle)
\ No newline at end of file
@@ -0,0 +1,178 @@
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+OSCILLATOR_DIR = os.path.join(REPO_ROOT, "main", "boards", "common")
+
+# Just enough of ESP-IDF for main/boards/common/oscillator.cc to compile on the host
+STUBS = {
+    "esp_err.h": """
+#pragma once
+typedef int esp_err_t;
+#define ESP_ERROR_CHECK(x) do { (void)(x); } while (0)
+""",
+    "esp_log.h": """
+#pragma once
+#include <cstdio>
+#define ESP_LOGI(tag, fmt, ...) printf("I %s: " fmt "\\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW ESP_LOGI
+#define ESP_LOGE ESP_LOGI
+""",
+    "esp_timer.h": """
+#pragma once
+#include <chrono>
+#include <cstdint>
+inline int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+""",
+    "freertos/FreeRTOS.h": """
+#pragma once
+#include <cstdint>
+typedef uint32_t TickType_t;
+""",
+    "freertos/task.h": """
+#pragma once
+#include "FreeRTOS.h"
+""",
+    "driver/ledc.h": """
+#pragma once
+#include <cstdint>
+#include "esp_err.h"
+typedef int ledc_channel_t;
+typedef int ledc_mode_t;
+enum { LEDC_LOW_SPEED_MODE = 0, LEDC_TIMER_13_BIT = 13, LEDC_TIMER_1 = 1, LEDC_AUTO_CLK = 0, LEDC_INTR_DISABLE = 0 };
+struct ledc_timer_config_t { int speed_mode; int duty_resolution; int timer_num; int freq_hz; int clk_cfg; };
+struct ledc_channel_config_t { int gpio_num; int speed_mode; ledc_channel_t channel; int intr_type; int timer_sel; uint32_t duty; int hpoint; };
+inline esp_err_t ledc_timer_config(const ledc_timer_config_t*) { return 0; }
+inline esp_err_t ledc_channel_config(const ledc_channel_config_t*) { return 0; }
+inline esp_err_t ledc_set_duty(ledc_mode_t, ledc_channel_t, uint32_t) { return 0; }
+inline esp_err_t ledc_update_duty(ledc_mode_t, ledc_channel_t) { return 0; }
+inline esp_err_t ledc_stop(ledc_mode_t, ledc_channel_t, uint32_t) { return 0; }
+""",
+}
+
+HARNESS = r"""
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "oscillator.h"
+
+// The double precision Oscillator::Refresh() and AngleToCompare() this replaced
+static int ReferenceSample(unsigned int amplitude, int offset, double phase0, double phase) {
+    return (int)std::round(amplitude * std::sin(phase + phase0) + offset) + 90;
+}
+
+static uint32_t ReferenceDuty(int angle) {
+    angle = std::min(std::max(angle, 0), 180);
+    return (uint32_t)(((angle / 180.0) * 2.0 + 0.5) * 8191 / 20.0);
+}
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? atoi(argv[1]) : 20000000;
+    int failures = 0;
+
+    // Every amplitude and offset the gaits use, at the gait phases and at random ones
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> any_phase(-4 * M_PI, 4 * M_PI);
+    long compared = 0, differ = 0;
+    int worst = 0;
+    Oscillator osc;
+    for (int amplitude = 0; amplitude <= 90; amplitude++) {
+        for (int offset = -90; offset <= 90; offset += 3) {
+            for (int p = 0; p < 24; p++) {
+                double phase0 = p < 8 ? DEG2RAD(p * 45 - 180) : (p == 8 ? 90.0 : any_phase(rng));
+                osc.SetA(amplitude);
+                osc.SetO(offset);
+                osc.SetPh(phase0);
+                const int samples = 25;
+                for (int k = 0; k < 3 * samples; k++) {
+                    int d = abs(osc.Sample(OSCILLATOR_PHASE(k, samples)) -
+                                ReferenceSample(amplitude, offset, phase0, 2 * M_PI * k / samples));
+                    compared++;
+                    differ += d != 0;
+                    worst = std::max(worst, d);
+                }
+            }
+        }
+    }
+    printf("Sample: %ld points, %ld differ (%.2f%%), worst %d degree\n", compared, differ, 100.0 * differ / compared, worst);
+    failures += worst > 1;
+
+    // Refresh() accumulates the phase, 20 periods of 2000 ms sampled every 30 ms
+    const int samples_per_period = 2000 / 30;
+    double reference_phase = 0;
+    oscillator_phase_t phase = 0;
+    osc.SetA(45);
+    osc.SetO(10);
+    osc.SetPh(DEG2RAD(-90));
+    int drift = 0;
+    for (int i = 0; i < 20 * samples_per_period; i++) {
+        drift = std::max(drift, abs(osc.Sample(phase) - ReferenceSample(45, 10, DEG2RAD(-90), reference_phase)));
+        reference_phase += 2 * M_PI / samples_per_period;
+        phase += OSCILLATOR_PHASE(1, samples_per_period);
+    }
+    printf("Accumulated phase: worst %d degree over %d samples\n", drift, 20 * samples_per_period);
+    failures += drift > 1;
+
+    int duty_mismatches = 0;
+    for (int angle = -30; angle <= 210; angle++) {
+        duty_mismatches += Oscillator::AngleToDuty(angle) != ReferenceDuty(angle);
+    }
+    printf("Duty table: %d mismatches over -30..210 degrees\n", duty_mismatches);
+    failures += duty_mismatches > 0;
+
+    volatile int sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += ReferenceSample(30, 5, 1.0, i * 0.001) + ReferenceDuty(i % 181);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += osc.Sample((oscillator_phase_t)i * 68719u) + Oscillator::AngleToDuty(i % 181);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    printf("Sample+duty: double %.1f ns, fixed point %.1f ns\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations,
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations);
+    return failures == 0 ? 0 : 1;
+}
+"""
+
+
+'''
+  Builds main/boards/common/oscillator.cc for the host and compares it with the double
+  precision implementation it replaced, then times both. Exits non-zero if any sample is
+  more than one degree off or the duty table differs.
+'''
+def main():
+    parser = argparse.ArgumentParser(description="Oscillator waveform comparison and host benchmark")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"), help="host C++ compiler")
+    parser.add_argument("--iterations", type=int, default=20000000, help="benchmark iterations")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as work_dir:
+        for name, content in STUBS.items():
+            path = os.path.join(work_dir, "stub", name)
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            with open(path, "w") as f:
+                f.write(content.lstrip())
+        harness = os.path.join(work_dir, "oscillator_bench.cc")
+        with open(harness, "w") as f:
+            f.write(HARNESS)
+        binary = os.path.join(work_dir, "oscillator_bench")
+        subprocess.run([args.cxx, "-std=c++17", "-O2", "-I", os.path.join(work_dir, "stub"), "-I", OSCILLATOR_DIR,
+                        harness, os.path.join(OSCILLATOR_DIR, "oscillator.cc"), "-o", binary], check=True)
+        return subprocess.run([binary, str(args.iterations)]).returncode
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,248 @@
+import argparse
+import math
+import random
+import struct
+import wave
+
+
+SAMPLE_RATE = 16000
+CHUNK_SAMPLES = 512         # Feed size of the AFE wake word, WakeNet alone takes 480
+PRE_ROLL_MS = 320           # WAKE_WORD_PRE_ROLL_MS
+HANGOVER_MS = 2000          # WAKE_WORD_HANGOVER_MS
+ONSET_MARGIN_MS = 100       # Audio before a labelled wake word the model should still see
+
+# Constants of main/audio/processors/pre_vad.cc
+FLOOR_MIN_DB = -75.0
+FLOOR_RISE_DB_PER_S = 3.0
+FLOOR_FALL = 0.3
+FRICATIVE_ZCR = 0.3
+
+
+'''
+  Same decisions as PreVad::Process() in main/audio/processors/pre_vad.cc,
+  starting from Reset(). Returns which chunks reach the wake word model.
+'''
+def run_pre_vad(samples, threshold_db, pre_roll_ms, hangover_ms):
+    pre_roll_samples = pre_roll_ms * SAMPLE_RATE // 1000
+    hangover_samples = hangover_ms * SAMPLE_RATE // 1000
+    hangover_left = hangover_samples
+    floor = None
+    pre_roll = []
+    fed = []
+    wake_ups = 0
+    for start in range(0, len(samples) - CHUNK_SAMPLES + 1, CHUNK_SAMPLES):
+        chunk = samples[start:start + CHUNK_SAMPLES]
+        energy = sum(s * s for s in chunk)
+        crossings = sum(1 for a, b in zip([chunk[0]] + chunk[:-1], chunk) if (a ^ b) < 0)
+        db = 10 * math.log10(energy / CHUNK_SAMPLES / (32768.0 * 32768.0) + 1e-10)
+        if floor is None:
+            floor = max(db, FLOOR_MIN_DB)
+        zcr = crossings / CHUNK_SAMPLES
+        loud = db > floor + threshold_db or (zcr > FRICATIVE_ZCR and db > floor + threshold_db / 2)
+        if db < floor:
+            floor += (db - floor) * FLOOR_FALL
+        else:
+            floor += min(db - floor, FLOOR_RISE_DB_PER_S * CHUNK_SAMPLES / SAMPLE_RATE)
+        floor = max(floor, FLOOR_MIN_DB)
+
+        index = len(fed)
+        fed.append(False)
+        if loud:
+            if hangover_left <= 0:
+                wake_ups += 1
+            hangover_left = hangover_samples + CHUNK_SAMPLES
+        if hangover_left > 0:
+            hangover_left = max(0, hangover_left - CHUNK_SAMPLES)
+            for held in pre_roll:
+                fed[held] = True
+            pre_roll = []
+            fed[index] = True
+            continue
+        pre_roll.append(index)
+        while pre_roll and (len(pre_roll) - 1) * CHUNK_SAMPLES >= pre_roll_samples:
+            pre_roll.pop(0)
+    return fed, wake_ups
+
+
+def read_wav(path):
+    with wave.open(path, "rb") as f:
+        if f.getsampwidth() != 2 or f.getframerate() != SAMPLE_RATE:
+            raise ValueError(f"{path}: expected 16 bit PCM at {SAMPLE_RATE} Hz")
+        channels = f.getnchannels()
+        raw = f.readframes(f.getnframes())
+    return list(struct.unpack(f"<{len(raw) // 2}h", raw)[::channels])
+
+
+def write_wav(path, samples):
+    with wave.open(path, "wb") as f:
+        f.setnchannels(1)
+        f.setsampwidth(2)
+        f.setframerate(SAMPLE_RATE)
+        f.writeframes(struct.pack(f"<{len(samples)}h", *samples))
+
+
+def read_labels(path):
+    # Audacity label track: start and end in seconds, tab separated
+    segments = []
+    with open(path) as f:
+        for line in f:
+            fields = line.split("\t")
+            if len(fields) >= 2 and fields[0].strip() and fields[0][0] != "\\":
+                segments.append((float(fields[0]), float(fields[1]), None))
+    return segments
+
+
+'''
+  Ambient recording of a room with a steady noise floor, an appliance that
+  switches on and off, knocks, distant speech, and wake words spoken at
+  different distances. Each wake word starts with a soft fricative like
+  "xiao" before its voiced syllables. Returns the samples and the labelled wake words.
+'''
+def synthesize(seconds, seed):
+    rng = random.Random(seed)
+    total = seconds * SAMPLE_RATE
+    noise_level = rng.choice([8, 30, 120])
+    out = [0.0] * total
+    state = 0.0
+    appliance_on = False
+    appliance_state = 0.0
+    for i in range(total):
+        if i % SAMPLE_RATE == 0 and rng.random() < 0.03:
+            appliance_on = not appliance_on
+        state = state * 0.95 + rng.gauss(0, noise_level)
+        out[i] = state
+        if appliance_on:
+            appliance_state = appliance_state * 0.5 + rng.gauss(0, noise_level * 3)
+            out[i] += appliance_state + noise_level * 4 * math.sin(2 * math.pi * 100 * i / SAMPLE_RATE)
+
+    def add(start, signal):
+        for j, value in enumerate(signal):
+            if start + j < total:
+                out[start + j] += value
+
+    # Knocks and clatter
+    for _ in range(seconds // 20):
+        start = rng.randrange(total)
+        level = rng.uniform(2000, 12000)
+        add(start, [level * math.exp(-j / 300) * rng.uniform(-1, 1) for j in range(2400)])
+
+    # Distant speech from another room, quiet and muffled
+    for _ in range(seconds // 30):
+        start = rng.randrange(total)
+        pitch = rng.uniform(90, 220)
+        level = noise_level * rng.uniform(2, 6)
+        length = int(rng.uniform(1, 4) * SAMPLE_RATE)
+        add(start, [level * max(0.0, math.sin(math.pi * 4 * j / SAMPLE_RATE)) * math.sin(2 * math.pi * pitch * j / SAMPLE_RATE)
+                    for j in range(length)])
+
+    # Wake words every 10 to 30 seconds
+    segments = []
+    position = int(rng.uniform(3, 10) * SAMPLE_RATE)
+    while position < total - SAMPLE_RATE:
+        # Level over the steady noise, whose RMS is noise_level / sqrt(1 - 0.95^2)
+        snr_db = rng.uniform(0, 30)
+        level = noise_level * 3.2 * 10 ** (snr_db / 20) * 1.6
+        fricative_length = int(rng.uniform(0.06, 0.12) * SAMPLE_RATE)
+        previous = 0.0
+        signal = []
+        for j in range(fricative_length):
+            white = rng.gauss(0, 1)
+            # First difference pushes the noise up in frequency, like "x" or "s"
+            signal.append(level * 0.25 * min(1.0, j / (0.03 * SAMPLE_RATE)) * (white - previous))
+            previous = white
+        pitch = rng.uniform(110, 250)
+        voiced_length = int(rng.uniform(0.5, 0.8) * SAMPLE_RATE)
+        phase = 0.0
+        for j in range(voiced_length):
+            t = j / SAMPLE_RATE
+            envelope = max(0.0, math.sin(math.pi * t / (voiced_length / SAMPLE_RATE) * 2)) ** 0.5
+            phase += 2 * math.pi * pitch * (1 - 0.15 * t) / SAMPLE_RATE
+            signal.append(level * envelope * sum(math.sin(k * phase) / k for k in range(1, 5)))
+        add(position, signal)
+        segments.append((position / SAMPLE_RATE, (position + len(signal)) / SAMPLE_RATE, snr_db))
+        position += len(signal) + int(rng.uniform(10, 30) * SAMPLE_RATE)
+
+    samples = [max(-32768, min(32767, int(v))) for v in out]
+    return samples, segments
+
+
+def evaluate(name, samples, segments, args):
+    fed, wake_ups = run_pre_vad(samples, args.threshold, args.pre_roll, args.hangover)
+    rejected = 0
+    quiet = 0
+    quiet_rejected = 0
+    onset_margins = []
+    for start, end, snr_db in segments:
+        first = max(0, int((start - ONSET_MARGIN_MS / 1000) * SAMPLE_RATE) // CHUNK_SAMPLES)
+        last = min(len(fed) - 1, int(end * SAMPLE_RATE) // CHUNK_SAMPLES)
+        lost = not all(fed[first:last + 1])
+        # Synthetic wake words below 10 dB SNR are counted apart, that is near the limit of the wake word models
+        if snr_db is not None and snr_db < 10:
+            quiet += 1
+            quiet_rejected += lost
+            continue
+        rejected += lost
+        if lost:
+            continue
+        # How far back before the wake word the model saw continuous audio
+        chunk = int(start * SAMPLE_RATE) // CHUNK_SAMPLES
+        margin = 0
+        while chunk - margin - 1 >= 0 and fed[chunk - margin - 1]:
+            margin += 1
+        onset_margins.append(margin * CHUNK_SAMPLES * 1000 // SAMPLE_RATE)
+    if args.dump:
+        with open(args.dump, "w") as f:
+            f.write("".join("1" if v else "0" for v in fed) + "\n")
+    return {
+        "name": name, "chunks": len(fed), "fed": sum(fed), "wake_ups": wake_ups,
+        "wake_words": len(segments) - quiet, "rejected": rejected, "quiet": quiet, "quiet_rejected": quiet_rejected,
+        "min_margin": min(onset_margins) if onset_margins else 0,
+    }
+
+
+'''
+  Replays ambient recordings through the pre-VAD and reports how many wake words
+  lose audio the model needs (false rejects caused by the pre-VAD alone) and the
+  share of model invocations skipped, which is the CPU the AFE or WakeNet saves.
+'''
+def main():
+    parser = argparse.ArgumentParser(description="Evaluate the wake word pre-VAD on ambient recordings")
+    parser.add_argument("recordings", nargs="*",
+                        help="16 kHz 16 bit WAV files, wake words are read from an Audacity label file "
+                             "with the same name and a .txt extension")
+    parser.add_argument("--synthetic", type=int, default=0, help="also evaluate this many synthetic recordings")
+    parser.add_argument("--seconds", type=int, default=180, help="length of each synthetic recording")
+    parser.add_argument("--threshold", type=int, default=6, help="CONFIG_WAKE_WORD_PRE_VAD_THRESHOLD_DB")
+    parser.add_argument("--pre-roll", type=int, default=PRE_ROLL_MS)
+    parser.add_argument("--hangover", type=int, default=HANGOVER_MS)
+    parser.add_argument("--save", help="write the last synthetic recording to this WAV file")
+    parser.add_argument("--dump", help="write which chunks of the last input were fed")
+    args = parser.parse_args()
+
+    results = []
+    for path in args.recordings:
+        results.append(evaluate(path, read_wav(path), read_labels(path.rsplit(".", 1)[0] + ".txt"), args))
+    for seed in range(args.synthetic):
+        samples, segments = synthesize(args.seconds, seed)
+        if args.save:
+            write_wav(args.save, samples)
+        results.append(evaluate(f"synthetic-{seed}", samples, segments, args))
+    if not results:
+        parser.error("no recordings, pass WAV files or --synthetic N")
+
+    print(f"{'input':<24}{'chunks':>8}{'fed':>8}{'skipped':>9}{'wake-ups':>9}{'rejects':>10}{'<10 dB':>10}{'margin':>8}")
+    for r in results:
+        print(f"{r['name'][-24:]:<24}{r['chunks']:>8}{r['fed']:>8}{100 - 100 * r['fed'] / r['chunks']:>8.1f}%"
+              f"{r['wake_ups']:>9}{r['rejected']:>5}/{r['wake_words']:<4}{r['quiet_rejected']:>5}/{r['quiet']:<4}"
+              f"{r['min_margin']:>6}ms")
+    chunks = sum(r["chunks"] for r in results)
+    fed = sum(r["fed"] for r in results)
+    print(f"total: {100 - 100 * fed / chunks:.1f}% of wake word model runs skipped, "
+          f"{sum(r['rejected'] for r in results)} of {sum(r['wake_words'] for r in results)} wake words lost audio, "
+          f"{sum(r['quiet_rejected'] for r in results)} of {sum(r['quiet'] for r in results)} below 10 dB SNR")
+    print(f"rejects: wake words with any chunk from {ONSET_MARGIN_MS} ms before the label to its end not fed; "
+          "margin: least continuous audio fed ahead of a detected wake word")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,217 @@
+import argparse
+import math
+import random
+import struct
+import wave
+
+
+SAMPLE_RATE = 16000
+FRAME_SAMPLES = 960         # OPUS_FRAME_DURATION_MS at 16 kHz, the unit the gate works on
+CHUNK_SAMPLES = 512         # AFE fetch chunk, the VAD state changes at this granularity
+VAD_MIN_SPEECH_MS = 128     # AFE default, speech must last this long before VAD_SPEECH
+VAD_MIN_NOISE_MS = 100      # afe_config->vad_min_noise_ms in AfeAudioProcessor
+
+
+'''
+  Same decisions as UplinkGate::Process() in main/audio/processors/uplink_gate.cc.
+  Returns the indices of the sent frames in send order and how many were keepalive frames.
+'''
+def run_gate(vad, pre_roll_frames, hangover_frames, keepalive_frames):
+    sent = []
+    pre_roll = []
+    hangover_left = 0
+    closed_frames = 0
+    keepalive = 0
+    for index, speech in enumerate(vad):
+        if speech or hangover_left > 0:
+            sent += pre_roll
+            pre_roll = []
+            hangover_left = hangover_frames if speech else hangover_left - 1
+            closed_frames = 0
+            sent.append(index)
+            continue
+        closed_frames += 1
+        is_keepalive = keepalive_frames > 0 and closed_frames >= keepalive_frames
+        if is_keepalive:
+            closed_frames = 0
+            keepalive += 1
+        if pre_roll_frames == 0 or (is_keepalive and not pre_roll):
+            if is_keepalive:
+                sent.append(index)
+            continue
+        # The keepalive is the oldest pre-roll frame
+        if len(pre_roll) >= pre_roll_frames or is_keepalive:
+            oldest = pre_roll.pop(0)
+            if is_keepalive:
+                sent.append(oldest)
+        pre_roll.append(index)
+    return sent, keepalive
+
+
+def frames_for(duration_ms):
+    return 0 if duration_ms <= 0 else (duration_ms * SAMPLE_RATE // 1000 + FRAME_SAMPLES - 1) // FRAME_SAMPLES
+
+
+def read_wav(path):
+    with wave.open(path, "rb") as f:
+        if f.getsampwidth() != 2 or f.getframerate() != SAMPLE_RATE:
+            raise ValueError(f"{path}: expected 16 bit PCM at {SAMPLE_RATE} Hz")
+        channels = f.getnchannels()
+        raw = f.readframes(f.getnframes())
+    samples = struct.unpack(f"<{len(raw) // 2}h", raw)
+    return list(samples[::channels])
+
+
+def read_labels(path):
+    # Audacity label track: start and end in seconds, tab separated
+    segments = []
+    with open(path) as f:
+        for line in f:
+            fields = line.split("\t")
+            if len(fields) >= 2 and fields[0].strip() and fields[0][0] != "\\":
+                segments.append((float(fields[0]), float(fields[1])))
+    return segments
+
+
+def chunk_db(samples):
+    energy = sum(s * s for s in samples) / max(1, len(samples))
+    return 10 * math.log10(energy + 1)
+
+
+'''
+  Stand-in for the AFE VAD: an energy detector over a tracked noise floor with
+  the AFE's minimum speech and noise durations. The state seen by the gate is
+  the one of the last fetch that completed a frame, as in AfeAudioProcessor.
+'''
+def simulate_vad(samples, threshold_db):
+    min_speech = math.ceil(VAD_MIN_SPEECH_MS * SAMPLE_RATE / 1000 / CHUNK_SAMPLES)
+    min_noise = math.ceil(VAD_MIN_NOISE_MS * SAMPLE_RATE / 1000 / CHUNK_SAMPLES)
+    floor = None
+    state = False
+    run = 0
+    chunk_states = []
+    for start in range(0, len(samples) - CHUNK_SAMPLES + 1, CHUNK_SAMPLES):
+        db = chunk_db(samples[start:start + CHUNK_SAMPLES])
+        floor = db if floor is None else (min(db, floor + 0.05) if db > floor else floor + (db - floor) * 0.2)
+        loud = db > floor + threshold_db
+        run = run + 1 if loud != state else 0
+        if run >= (min_noise if state else min_speech):
+            state = loud
+            run = 0
+        chunk_states.append(state)
+
+    vad = []
+    for frame in range(len(samples) // FRAME_SAMPLES):
+        last_chunk = ((frame + 1) * FRAME_SAMPLES) // CHUNK_SAMPLES - 1
+        vad.append(chunk_states[min(last_chunk, len(chunk_states) - 1)] if chunk_states else False)
+    return vad
+
+
+def truth_frames(segments, frame_count):
+    truth = [False] * frame_count
+    for start, end in segments:
+        first = int(start * SAMPLE_RATE) // FRAME_SAMPLES
+        last = min(frame_count - 1, int(end * SAMPLE_RATE) // FRAME_SAMPLES)
+        for frame in range(first, last + 1):
+            truth[frame] = True
+    return truth
+
+
+'''
+  A conversation-like recording: room noise, utterances of voiced syllables with
+  pitch drift, and pauses that range from breaths to long turns. Returns the
+  samples and the labelled utterances.
+'''
+def synthesize(seconds, seed):
+    rng = random.Random(seed)
+    total = seconds * SAMPLE_RATE
+    samples = []
+    segments = []
+    low = 0.0
+    while len(samples) < total:
+        pause = rng.choice([rng.uniform(0.15, 0.5), rng.uniform(0.8, 2.5), rng.uniform(3, 8)])
+        for _ in range(int(pause * SAMPLE_RATE)):
+            low = low * 0.98 + rng.gauss(0, 30)
+            samples.append(low)
+        start = len(samples)
+        length = int(rng.uniform(0.4, 4.0) * SAMPLE_RATE)
+        pitch = rng.uniform(100, 240)
+        syllable_rate = rng.uniform(3.5, 6)
+        loudness = rng.uniform(1500, 6000)
+        phase = 0.0
+        for i in range(length):
+            t = i / SAMPLE_RATE
+            envelope = max(0.0, math.sin(math.pi * syllable_rate * t)) ** 0.6
+            # Soft onset, speech starts quietly before the first syllable peaks
+            envelope *= min(1.0, t / 0.08) * min(1.0, (length - i) / (0.1 * SAMPLE_RATE))
+            phase += 2 * math.pi * pitch * (1 + 0.08 * math.sin(2 * math.pi * 0.7 * t)) / SAMPLE_RATE
+            voiced = sum(math.sin(k * phase) / k for k in range(1, 6))
+            low = low * 0.98 + rng.gauss(0, 30)
+            samples.append(loudness * envelope * voiced + low)
+        segments.append((start / SAMPLE_RATE, len(samples) / SAMPLE_RATE))
+    samples = [max(-32768, min(32767, int(s))) for s in samples[:total]]
+    return samples, [(s, min(e, seconds)) for s, e in segments if s < seconds]
+
+
+def evaluate(name, samples, segments, args):
+    vad = simulate_vad(samples, args.threshold)
+    truth = truth_frames(segments, len(vad))
+    sent, keepalive = run_gate(vad, frames_for(args.pre_roll), frames_for(args.hangover), frames_for(args.keepalive))
+    sent_set = set(sent)
+    speech_frames = [i for i, t in enumerate(truth) if t]
+    clipped = [i for i in speech_frames if i not in sent_set]
+    onsets = [i for i, t in enumerate(truth) if t and (i == 0 or not truth[i - 1])]
+    clipped_onsets = [i for i in onsets if i not in sent_set]
+    if args.dump:
+        with open(args.dump, "w") as f:
+            f.write("".join("1" if v else "0" for v in vad) + "\n")
+            f.write(" ".join(str(i) for i in sent) + "\n")
+    return {
+        "name": name, "frames": len(vad), "sent": len(sent), "keepalive": keepalive,
+        "speech": len(speech_frames), "clipped": len(clipped),
+        "utterances": len(onsets), "clipped_onsets": len(clipped_onsets),
+    }
+
+
+'''
+  Replays recordings through a simulated AFE VAD and the uplink gate, and reports
+  the share of frames that are no longer encoded and sent, and how much labelled
+  speech the gate cuts off.
+'''
+def main():
+    parser = argparse.ArgumentParser(description="Evaluate the VAD-gated uplink on recorded conversations")
+    parser.add_argument("recordings", nargs="*",
+                        help="16 kHz 16 bit WAV files, speech labels are read from an Audacity label file "
+                             "with the same name and a .txt extension")
+    parser.add_argument("--synthetic", type=int, default=0, help="also evaluate this many synthetic conversations")
+    parser.add_argument("--seconds", type=int, default=120, help="length of each synthetic conversation")
+    parser.add_argument("--pre-roll", type=int, default=300, help="CONFIG_UPLINK_VAD_PRE_ROLL_MS")
+    parser.add_argument("--hangover", type=int, default=600, help="CONFIG_UPLINK_VAD_HANGOVER_MS")
+    parser.add_argument("--keepalive", type=int, default=1200, help="CONFIG_UPLINK_VAD_KEEPALIVE_MS")
+    parser.add_argument("--threshold", type=float, default=9, help="simulated VAD threshold over the noise floor in dB")
+    parser.add_argument("--dump", help="write the VAD states and sent frame indices of the last input")
+    args = parser.parse_args()
+
+    results = []
+    for path in args.recordings:
+        label_path = path.rsplit(".", 1)[0] + ".txt"
+        results.append(evaluate(path, read_wav(path), read_labels(label_path), args))
+    for seed in range(args.synthetic):
+        samples, segments = synthesize(args.seconds, seed)
+        results.append(evaluate(f"synthetic-{seed}", samples, segments, args))
+    if not results:
+        parser.error("no recordings, pass WAV files or --synthetic N")
+
+    print(f"{'input':<24}{'frames':>8}{'sent':>7}{'saved':>8}{'keepalive':>10}{'clipped':>9}{'onsets':>10}")
+    for r in results + [{
+        "name": "total", **{key: sum(r[key] for r in results) for key in
+                            ("frames", "sent", "keepalive", "speech", "clipped", "utterances", "clipped_onsets")}}]:
+        print(f"{r['name'][-24:]:<24}{r['frames']:>8}{r['sent']:>7}{100 - 100 * r['sent'] / r['frames']:>7.1f}%"
+              f"{r['keepalive']:>10}{100 * r['clipped'] / max(1, r['speech']):>8.2f}%"
+              f"{r['clipped_onsets']:>5}/{r['utterances']:<4}")
+    print("saved: frames neither encoded nor sent; clipped: labelled speech frames not sent; "
+          "onsets: utterances whose first frame was not sent")
+
+
+if __name__ == "__main__":
+    main()